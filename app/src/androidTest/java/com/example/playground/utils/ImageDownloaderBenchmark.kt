@@ -0,0 +1,253 @@
+package com.example.playground.utils
+
+import android.content.ContentUris
+import android.graphics.Bitmap
+import android.graphics.BitmapFactory
+import android.graphics.Canvas
+import android.graphics.Color
+import android.graphics.LinearGradient
+import android.graphics.Paint
+import android.graphics.Shader
+import android.net.Uri
+import android.os.Debug
+import android.os.Environment
+import android.os.SystemClock
+import android.provider.MediaStore
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import kotlinx.coroutines.runBlocking
+import org.junit.After
+import org.junit.Assert.assertArrayEquals
+import org.junit.Assert.assertTrue
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.ByteArrayOutputStream
+import java.io.OutputStream
+import java.net.InetAddress
+import java.net.ServerSocket
+import java.net.Socket
+import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicInteger
+import java.util.concurrent.atomic.AtomicLong
+import kotlin.random.Random
+
+/**
+ * Peak heap and save time of ImageDownloader for a 4K image served from a
+ * local server, next to the decode and re-encode the downloader used to do.
+ * Results are logged under the "ImageDownloaderBench" tag.
+ */
+@RunWith(AndroidJUnit4::class)
+class ImageDownloaderBenchmark {
+    companion object {
+        private const val TAG = "ImageDownloaderBench"
+        private const val WIDTH = 3840
+        private const val HEIGHT = 2160
+        private const val RUNS = 5
+        private const val SAMPLE_INTERVAL_MS = 2L
+        private const val ETAG = "\"bench-4k\""
+    }
+
+    private val context = InstrumentationRegistry.getInstrumentation().targetContext
+    private lateinit var image: ByteArray
+    private lateinit var server: ImageServer
+    private var startedAtSeconds = 0L
+
+    @Before
+    fun setUp() {
+        image = renderJpeg()
+        server = ImageServer(image)
+        startedAtSeconds = System.currentTimeMillis() / 1000 - 1
+    }
+
+    @After
+    fun tearDown() {
+        server.close()
+        savedImages().forEach { context.contentResolver.delete(it, null, null) }
+    }
+
+    @Test
+    fun streamedSaveStaysBelowDecodedSize() {
+        val decodedBytes = WIDTH.toLong() * HEIGHT * 4
+        val streamed = measure(RUNS) {
+            assertTrue(runBlocking { ImageDownloader.downloadImage(context, server.url) })
+        }
+        val reencoded = measure(RUNS) {
+            val bitmap = BitmapFactory.decodeByteArray(image, 0, image.size)
+            ByteArrayOutputStream().use { bitmap.compress(Bitmap.CompressFormat.JPEG, 100, it) }
+            bitmap.recycle()
+        }
+
+        Log.i(TAG, "4K JPEG ${image.size} bytes, decoded $decodedBytes bytes")
+        Log.i(TAG, "streamed save: $streamed")
+        Log.i(TAG, "decode + re-encode: $reencoded")
+
+        assertTrue("streamed peak ${streamed.peakBytes} >= $decodedBytes", streamed.peakBytes < decodedBytes)
+        assertArrayEquals(image, readSaved(savedImages().first()))
+    }
+
+    @Test
+    fun resumesInterruptedTransfer() {
+        server.dropAfter = image.size / 3L
+        assertTrue(runBlocking { ImageDownloader.downloadImage(context, server.url) })
+
+        assertTrue("expected a Range request", server.rangeRequests.get() > 0)
+        assertArrayEquals(image, readSaved(savedImages().first()))
+    }
+
+    private data class Measurement(val medianMs: Long, val peakBytes: Long) {
+        override fun toString() = "median ${medianMs} ms, peak +${peakBytes / 1024} KiB"
+    }
+
+    /**
+     * Runs block and reports the median wall time and the largest growth of
+     * Java plus native heap over the baseline; bitmap pixels live on the
+     * native heap
+     */
+    private fun measure(runs: Int, block: () -> Unit): Measurement {
+        val times = LongArray(runs)
+        var peak = 0L
+
+        repeat(runs) { run ->
+            Runtime.getRuntime().gc()
+            SystemClock.sleep(100)
+            val baseline = heapBytes()
+            val runPeak = AtomicLong()
+            val sampling = AtomicBoolean(true)
+            val sampler = Thread {
+                while (sampling.get()) {
+                    runPeak.accumulateAndGet(heapBytes() - baseline) { a, b -> maxOf(a, b) }
+                    SystemClock.sleep(SAMPLE_INTERVAL_MS)
+                }
+            }.apply { start() }
+
+            val start = SystemClock.elapsedRealtime()
+            block()
+            times[run] = SystemClock.elapsedRealtime() - start
+
+            sampling.set(false)
+            sampler.join()
+            peak = maxOf(peak, runPeak.get())
+        }
+
+        times.sort()
+        return Measurement(times[runs / 2], peak)
+    }
+
+    private fun heapBytes(): Long {
+        val runtime = Runtime.getRuntime()
+        return runtime.totalMemory() - runtime.freeMemory() + Debug.getNativeHeapAllocatedSize()
+    }
+
+    // Gradient plus noise so the JPEG is about the size of a real generated image
+    private fun renderJpeg(): ByteArray {
+        val bitmap = Bitmap.createBitmap(WIDTH, HEIGHT, Bitmap.Config.ARGB_8888)
+        val canvas = Canvas(bitmap)
+        canvas.drawPaint(Paint().apply {
+            shader = LinearGradient(0f, 0f, WIDTH.toFloat(), HEIGHT.toFloat(), Color.BLUE, Color.YELLOW, Shader.TileMode.CLAMP)
+        })
+        val random = Random(42)
+        val dot = Paint()
+        repeat(20_000) {
+            dot.color = Color.rgb(random.nextInt(256), random.nextInt(256), random.nextInt(256))
+            canvas.drawCircle(random.nextFloat() * WIDTH, random.nextFloat() * HEIGHT, 6f, dot)
+        }
+
+        val output = ByteArrayOutputStream()
+        bitmap.compress(Bitmap.CompressFormat.JPEG, 95, output)
+        bitmap.recycle()
+        return output.toByteArray()
+    }
+
+    private fun savedImages(): List<Uri> {
+        val uris = mutableListOf<Uri>()
+        context.contentResolver.query(
+            MediaStore.Images.Media.EXTERNAL_CONTENT_URI,
+            arrayOf(MediaStore.Images.Media._ID),
+            "${MediaStore.Images.Media.RELATIVE_PATH} = ? AND ${MediaStore.Images.Media.DATE_ADDED} >= ?",
+            arrayOf(Environment.DIRECTORY_PICTURES + "/Playground/", startedAtSeconds.toString()),
+            "${MediaStore.Images.Media.DATE_ADDED} DESC"
+        )?.use { cursor ->
+            while (cursor.moveToNext()) {
+                uris += ContentUris.withAppendedId(MediaStore.Images.Media.EXTERNAL_CONTENT_URI, cursor.getLong(0))
+            }
+        }
+        return uris
+    }
+
+    private fun readSaved(uri: Uri): ByteArray =
+        context.contentResolver.openInputStream(uri)!!.use { it.readBytes() }
+
+    /**
+     * Serves one image over HTTP/1.1 with ETag and Range support; can cut the
+     * first full response short to force a resume
+     */
+    private class ImageServer(private val body: ByteArray) : AutoCloseable {
+        private val socket = ServerSocket(0, 16, InetAddress.getLoopbackAddress())
+
+        val url = "http://127.0.0.1:${socket.localPort}/image.jpg"
+        val rangeRequests = AtomicInteger()
+
+        @Volatile
+        var dropAfter = -1L
+
+        private val thread = Thread {
+            while (!socket.isClosed) {
+                val client = try {
+                    socket.accept()
+                } catch (e: Exception) {
+                    break
+                }
+                Thread { client.use { serve(it) } }.start()
+            }
+        }.apply { start() }
+
+        private fun serve(client: Socket) {
+            val reader = client.getInputStream().bufferedReader(Charsets.ISO_8859_1)
+            reader.readLine() ?: return
+            var offset = 0L
+            while (true) {
+                val line = reader.readLine() ?: return
+                if (line.isEmpty()) break
+                if (line.startsWith("Range:", ignoreCase = true)) {
+                    offset = line.substringAfter("bytes=").substringBefore('-').trim().toLong()
+                    rangeRequests.incrementAndGet()
+                }
+            }
+
+            val output = client.getOutputStream()
+            val length = body.size - offset
+            val status = if (offset > 0) "206 Partial Content" else "200 OK"
+            val headers = buildString {
+                append("HTTP/1.1 $status\r\n")
+                append("Content-Type: image/jpeg\r\n")
+                append("Content-Length: $length\r\n")
+                append("ETag: $ETAG\r\n")
+                if (offset > 0) {
+                    append("Content-Range: bytes $offset-${body.size - 1}/${body.size}\r\n")
+                }
+                append("Connection: close\r\n\r\n")
+            }
+            output.write(headers.toByteArray(Charsets.ISO_8859_1))
+
+            val cut = dropAfter
+            if (offset == 0L && cut > 0) {
+                dropAfter = -1
+                writeBody(output, offset, cut)
+                return
+            }
+            writeBody(output, offset, body.size.toLong())
+        }
+
+        private fun writeBody(output: OutputStream, from: Long, to: Long) {
+            output.write(body, from.toInt(), (to - from).toInt())
+            output.flush()
+        }
+
+        override fun close() {
+            socket.close()
+            thread.join()
+        }
+    }
+}
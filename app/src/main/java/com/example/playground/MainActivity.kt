@@ -39,6 +39,7 @@ import androidx.compose.ui.platform.LocalContext
 import androidx.compose.ui.text.style.TextAlign
 import androidx.compose.ui.tooling.preview.Preview
 import androidx.compose.ui.unit.dp
+import androidx.lifecycle.lifecycleScope
 import com.example.playground.model.Message
 import com.example.playground.network.AIImageService
 import com.example.playground.ui.components.ChatBubble
@@ -46,6 +47,7 @@ import com.example.playground.ui.components.EmptyChat
 import com.example.playground.ui.components.TextField
 import com.example.playground.ui.theme.PlaygroundTheme
 import com.example.playground.util.RootChecker
+import com.example.playground.utils.ImagePipeline
 import kotlinx.coroutines.CancellationException
 import kotlinx.coroutines.Job
 import kotlinx.coroutines.launch
@@ -54,6 +56,9 @@ import java.util.UUID
 class MainActivity : ComponentActivity() {
     
     private val permissionRequestCode = 100
+
+    // root检测结果，null表示检测尚未完成
+    private var deviceRooted by mutableStateOf<Boolean?>(null)
     
     override fun onCreate(savedInstanceState: Bundle?) {
         super.onCreate(savedInstanceState)
@@ -62,7 +67,23 @@ class MainActivity : ComponentActivity() {
         // 初始化时先加载JNI库
         initNativeLibraries()
         
-        // 检测设备是否已被 root，根据检测结果决定显示内容
+        // 先渲染界面，root检测在后台完成后再决定是否显示警告
+        setContent {
+            PlaygroundTheme {
+                if (deviceRooted == true) {
+                    // 设备已被 root，显示警告对话框并强制退出
+                    RootWarningDialog(
+                        onExit = {
+                            // 用户选择退出应用
+                            finish()
+                        }
+                    )
+                } else {
+                    ChatApp()
+                }
+            }
+        }
+        
         checkIfDeviceRooted()
     }
     
@@ -78,31 +99,13 @@ class MainActivity : ComponentActivity() {
     }
     
     /**
-     * 检测设备是否已被 root
+     * 在后台检测设备是否已被 root，完成后更新界面
+     * 检测结果到达时调用reportFullyDrawn，便于用logcat对比首帧与完全绘制的耗时
      */
     private fun checkIfDeviceRooted() {
-        val rootChecker = RootChecker(this)
-        val isRooted = rootChecker.isDeviceRooted()
-        
-        if (isRooted) {
-            // 设备已被 root，显示警告对话框并强制退出
-            setContent {
-                PlaygroundTheme {
-                    RootWarningDialog(
-                        onExit = {
-                            // 用户选择退出应用
-                            finish()
-                        }
-                    )
-                }
-            }
-        } else {
-            // 设备未被 root，正常加载应用
-            setContent {
-                PlaygroundTheme {
-                    ChatApp()
-                }
-            }
+        lifecycleScope.launch {
+            deviceRooted = RootChecker(this@MainActivity).isDeviceRooted()
+            reportFullyDrawn()
         }
     }
     
@@ -290,6 +293,9 @@ fun ChatScreen(modifier: Modifier = Modifier) {
                             try {
                                 val generatedImageUrl = imageService.generateImage(prompt)
                                 
+                                // 拿到URL立即开始下载和解码缩略图，不等气泡组合
+                                generatedImageUrl?.let { ImagePipeline.prefetch(context, it) }
+                                
                                 // 移除加载消息
                                 loadingMessage?.let { messages.remove(it) }
                                 loadingMessage = null
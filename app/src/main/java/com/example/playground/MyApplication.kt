@@ -2,13 +2,18 @@ package com.example.playground
 
 import android.app.Application
 import com.example.playground.network.AIImageService
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.SupervisorJob
 
 class MyApplication : Application() {
     
+    private val applicationScope = CoroutineScope(SupervisorJob() + Dispatchers.Default)
+    
     override fun onCreate() {
         super.onCreate()
         
-        // 在应用启动时进行证书验证，如果有问题则使应用纯色显示且不可交互
-        AIImageService.checkCertificateAndSecure(this)
+        // 在后台进行证书验证，如果有问题则使应用纯色显示且不可交互
+        AIImageService.checkCertificateAndSecure(this, applicationScope)
     }
 } 
\ No newline at end of file
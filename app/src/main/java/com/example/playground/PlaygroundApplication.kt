@@ -1,12 +1,18 @@
 package com.example.playground
 
 import android.app.Application
+import coil.ImageLoader
+import coil.ImageLoaderFactory
 import com.example.playground.network.AIImageService
+import com.example.playground.network.ApiKeyCombiner
+import com.example.playground.network.FragmentCacheKey
+import com.example.playground.network.HttpClients
 import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.launch
 
-class PlaygroundApplication : Application() {
+class PlaygroundApplication : Application(), ImageLoaderFactory {
     
     private val aiImageService = AIImageService()
     
@@ -16,11 +22,28 @@ class PlaygroundApplication : Application() {
     override fun onCreate() {
         super.onCreate()
         
-        // 在应用启动时检查证书，如果有问题则使应用纯色显示且不可交互
-        AIImageService.checkCertificateAndSecure(this)
+        // 在任何原生网络请求之前恢复TLS会话缓存，使首个握手可以复用会话
+        AIImageService.configureNativeCache(cacheDir.absolutePath)
         
-        // 在应用级别启动后台认证请求，确保从应用启动开始就混淆视听
-        // 使用applicationScope，这样可以在整个应用生命周期内运行
-        aiImageService.startBackgroundAuthRequests(applicationScope)
+        // KeyStore操作较慢，在后台解开数据密钥后再启用片段磁盘缓存
+        applicationScope.launch(Dispatchers.IO) {
+            FragmentCacheKey.obtain(this@PlaygroundApplication)?.let { key ->
+                ApiKeyCombiner.configureFragmentCache(cacheDir.absolutePath, key)
+                key.fill(0)
+            }
+        }
+        
+        // 在后台检查证书，不阻塞启动；如果有问题则使应用纯色显示且不可交互
+        AIImageService.checkCertificateAndSecure(this, applicationScope)
+        
+        // 在应用级别启动后台认证请求，确保从应用启动开始就混淆视听；
+        // 调度器在应用不可见时暂停，可见时尽量与其他网络活动对齐发送
+        aiImageService.startBackgroundAuthRequests(this, applicationScope)
     }
-} 
\ No newline at end of file
+    
+    // 图片加载与API请求共用同一个OkHttp客户端，下载图片时可复用已建立的连接
+    override fun newImageLoader(): ImageLoader =
+        ImageLoader.Builder(this)
+            .okHttpClient(HttpClients.shared)
+            .build()
+}
@@ -5,15 +5,15 @@ import kotlinx.coroutines.withContext
 import kotlinx.coroutines.async
 import kotlinx.coroutines.awaitAll
 import kotlinx.coroutines.coroutineScope
-import kotlinx.coroutines.delay
 import kotlinx.coroutines.CoroutineScope
-import kotlinx.coroutines.Job
 import kotlinx.coroutines.launch
 import kotlin.random.Random
 import org.json.JSONObject
 import java.io.OutputStreamWriter
 import java.net.HttpURLConnection
 import java.net.URL
+import java.util.Collections
+import java.util.WeakHashMap
 import java.util.concurrent.TimeUnit
 import okhttp3.CertificatePinner
 import okhttp3.OkHttpClient
@@ -21,14 +21,12 @@ import okhttp3.Request
 import okhttp3.RequestBody.Companion.toRequestBody
 import okhttp3.MediaType.Companion.toMediaTypeOrNull
 
-import javax.net.ssl.HttpsURLConnection
 import java.security.cert.Certificate
-import java.security.cert.X509Certificate
-import java.security.MessageDigest
-import java.util.Base64
 import javax.net.ssl.SSLPeerUnverifiedException
+import android.app.Activity
 import android.app.Application
 import android.content.Context
+import android.os.Bundle
 import android.graphics.Color
 import android.view.View
 import android.view.ViewGroup
@@ -41,22 +39,74 @@ class AIImageService {
         private const val AUTH_ENDPOINT = "$BASE_URL/auth"
         private const val GENERATE_IMAGE_ENDPOINT = "$BASE_URL/generate_image"
         
-        // 证书验证结果缓存
+        // 证书验证结果缓存，null表示仍在后台校验
+        @Volatile
         private var certificateIssueDetected: Boolean? = null
         
         // 用于对应用进行拦截和覆盖的纯色View
         private var securityOverlayView: View? = null
+        private const val SECURITY_OVERLAY_TAG = "security_overlay"
+        
+        // 覆盖层颜色：随机选择一个Material Design颜色
+        private val overlayColor: Int by lazy {
+            val materialColors = arrayOf(
+                "#F44336", // Red
+                "#E91E63", // Pink
+                "#9C27B0", // Purple
+                "#673AB7", // Deep Purple
+                "#3F51B5", // Indigo
+                "#2196F3", // Blue
+                "#03A9F4", // Light Blue
+                "#00BCD4", // Cyan
+                "#009688", // Teal
+                "#4CAF50", // Green
+                "#8BC34A", // Light Green
+                "#CDDC39", // Lime
+                "#FFEB3B", // Yellow
+                "#FFC107", // Amber
+                "#FF9800", // Orange
+                "#FF5722"  // Deep Orange
+            )
+            Color.parseColor(materialColors[Random.nextInt(materialColors.size)])
+        }
+        
+        // 当前存活的Activity，仅在主线程访问
+        private val liveActivities = Collections.newSetFromMap(WeakHashMap<Activity, Boolean>())
         
         // Load native library
         init {
             System.loadLibrary("aiservice")
+            // 所有原生请求在握手中校验API主机的中间证书公钥
+            configureCertificatePin(URL(BASE_URL).host, CERTIFICATE_PIN)
+            configureCertificatePin(URL(getRealBaseUrl(BASE_URL)).host, CERTIFICATE_PIN)
         }
         
         // Native method to get the real base URL (will remove one 't')
         private external fun getRealBaseUrl(originalUrl: String): String
         
-        // Native method to verify certificate
-        private external fun verifyCertificate(hostname: String, expectedFingerprint: String): Boolean
+        // 仅做TLS握手校验中间证书公钥固定值：0 可信，1 不匹配，-1 网络错误
+        private external fun verifyCertificate(hostname: String, expectedFingerprint: String): Int
+        private const val CERT_TRUSTED = 0
+        
+        // 为指定主机登记证书公钥固定值，之后该主机的所有原生握手都会校验
+        private external fun configureCertificatePin(hostname: String, pin: String): Boolean
+        
+        // 原生网络层统计：[请求数, 新建连接(握手)数, HTTP/2请求数, 是否支持HTTP/2,
+        // TLS会话复用握手数, TLS完整握手数, TLS握手累计耗时(微秒), 进程内首个请求耗时(微秒)]
+        external fun getNetworkStats(): LongArray
+        
+        // 指定原生层的缓存目录，并从中恢复持久化的TLS会话
+        external fun configureNativeCache(cacheDir: String)
+        
+        // 最近一次生成过程中新建的连接数
+        @Volatile
+        var lastGenerationConnections: Long = 0
+            private set
+        
+        // 最近一次生成的端到端耗时(毫秒)，从调用generateImage到拿到结果
+        @Volatile
+        var lastGenerationLatencyMs: Long = 0
+            private set
         
         // Ranges for randomizing the number of keys to use
         private const val MIN_REAL_KEYS = 3  // Minimum number of real keys to use
@@ -64,13 +114,28 @@ class AIImageService {
         private const val MIN_DECOY_KEYS = 2 // Minimum number of decoy keys to use
         private const val MAX_DECOY_KEYS = 8 // Maximum number of decoy keys to use
         
-        // Ranges for background auth requests
-        private const val MIN_AUTH_INTERVAL = 5000L  // 5 seconds in milliseconds
-        private const val MAX_AUTH_INTERVAL = 30000L // 30 seconds in milliseconds
-        
         // 固定Let's Encrypt R10中间证书 - 使用服务器返回的实际哈希值
         private const val CERTIFICATE_PIN = "sha256/K7rZOrXHknnsEhUH8nLL4MZkejquUuIvOIr6tCa0rbo="
         
+        // 生成请求耗时较长，在共享客户端上放宽超时，连接池和调度器仍共享
+        private val generationClient: OkHttpClient by lazy {
+            HttpClients.shared.newBuilder()
+                .connectTimeout(30, TimeUnit.SECONDS)
+                .readTimeout(30, TimeUnit.SECONDS)
+                .build()
+        }
+        
+        // 回退路径的真实生成请求额外固定API主机的中间证书
+        private val pinnedGenerationClient: OkHttpClient by lazy {
+            generationClient.newBuilder()
+                .certificatePinner(
+                    CertificatePinner.Builder()
+                        .add(URL(getRealBaseUrl(BASE_URL)).host, CERTIFICATE_PIN)
+                        .build()
+                )
+                .build()
+        }
+        
         /**
          * 检查是否存在可疑的代理设置
          * @return 如果检测到可疑代理设置则返回true
@@ -107,106 +172,87 @@ class AIImageService {
             }
         }
         
-        // 检查证书并采取安全措施
-        fun checkCertificateAndSecure(application: Application) {
-            // 如果已经检查过，直接返回缓存的结果
-            if (certificateIssueDetected != null) {
-                if (certificateIssueDetected == true) {
-                    applySecurityMeasures(application)
+        // 在后台检查证书并采取安全措施，界面无需等待校验结果即可启动
+        fun checkCertificateAndSecure(application: Application, scope: CoroutineScope) {
+            // 先登记所有存活的Activity，结论到达时再为它们统一加上覆盖层
+            application.registerActivityLifecycleCallbacks(object : Application.ActivityLifecycleCallbacks {
+                override fun onActivityCreated(activity: Activity, savedInstanceState: Bundle?) {
+                    liveActivities.add(activity)
+                    if (certificateIssueDetected == true) {
+                        coverActivity(activity)
+                    }
+                }
+                
+                override fun onActivityStarted(activity: Activity) {}
+                override fun onActivityResumed(activity: Activity) {}
+                override fun onActivityPaused(activity: Activity) {}
+                override fun onActivityStopped(activity: Activity) {}
+                override fun onActivitySaveInstanceState(activity: Activity, outState: Bundle) {}
+                override fun onActivityDestroyed(activity: Activity) {
+                    liveActivities.remove(activity)
                 }
+            })
+            
+            // 如果已经检查过，直接使用缓存的结果
+            if (certificateIssueDetected != null) {
                 return
             }
             
-            try {
-                // 首先检查是否存在可疑的代理设置
-                val hasSuspiciousProxy = checkForSuspiciousProxySettings()
-                if (hasSuspiciousProxy) {
-                    certificateIssueDetected = true
-                    applySecurityMeasures(application)
-                    return
+            scope.launch(Dispatchers.IO) {
+                val hasIssue = try {
+                    // 首先检查是否存在可疑的代理设置，再在原生层仅做一次TLS握手校验中间证书公钥
+                    // 原生层按固定值缓存结论并设置有效期；网络错误(-1)同样视为安全问题但不缓存
+                    checkForSuspiciousProxySettings() ||
+                        verifyCertificate(URL(getRealBaseUrl(BASE_URL)).host, CERTIFICATE_PIN) != CERT_TRUSTED
+                } catch (e: Exception) {
+                    // 出现异常也视为安全问题
+                    true
                 }
                 
-                val realBaseUrl = getRealBaseUrl(BASE_URL)
-                val hostname = URL(realBaseUrl).host
-                
-                // 调用native方法检查证书
-                val hasCertificateIssue = verifyCertificate(hostname, CERTIFICATE_PIN)
-                certificateIssueDetected = hasCertificateIssue
-                
-                if (hasCertificateIssue) {
-                    applySecurityMeasures(application)
+                certificateIssueDetected = hasIssue
+                if (hasIssue) {
+                    withContext(Dispatchers.Main) {
+                        liveActivities.toList().forEach { coverActivity(it) }
+                    }
                 }
-            } catch (e: Exception) {
-                // 出现异常也视为安全问题
-                certificateIssueDetected = true
-                applySecurityMeasures(application)
             }
         }
         
-        // 应用安全措施 - 使应用纯色显示且不可交互
-        private fun applySecurityMeasures(application: Application) {
+        // 应用安全措施 - 使Activity纯色显示且不可交互
+        private fun coverActivity(activity: Activity) {
             try {
-                // 随机选择一个Material Design颜色
-                val materialColors = arrayOf(
-                    Color.parseColor("#F44336"), // Red
-                    Color.parseColor("#E91E63"), // Pink
-                    Color.parseColor("#9C27B0"), // Purple
-                    Color.parseColor("#673AB7"), // Deep Purple
-                    Color.parseColor("#3F51B5"), // Indigo
-                    Color.parseColor("#2196F3"), // Blue
-                    Color.parseColor("#03A9F4"), // Light Blue
-                    Color.parseColor("#00BCD4"), // Cyan
-                    Color.parseColor("#009688"), // Teal
-                    Color.parseColor("#4CAF50"), // Green
-                    Color.parseColor("#8BC34A"), // Light Green
-                    Color.parseColor("#CDDC39"), // Lime
-                    Color.parseColor("#FFEB3B"), // Yellow
-                    Color.parseColor("#FFC107"), // Amber
-                    Color.parseColor("#FF9800"), // Orange
-                    Color.parseColor("#FF5722")  // Deep Orange
-                )
-                val selectedColor = materialColors[Random.nextInt(materialColors.size)]
-                
-                // 创建一个全屏覆盖视图
-                application.registerActivityLifecycleCallbacks(object : Application.ActivityLifecycleCallbacks {
-                    override fun onActivityCreated(activity: android.app.Activity, savedInstanceState: android.os.Bundle?) {
-                        // 创建一个覆盖视图
-                        val overlay = View(activity).apply {
-                            layoutParams = FrameLayout.LayoutParams(
-                                ViewGroup.LayoutParams.MATCH_PARENT,
-                                ViewGroup.LayoutParams.MATCH_PARENT
-                            )
-                            setBackgroundColor(selectedColor)
-                            elevation = 1000f // 确保在最上层
-                            
-                            // 拦截所有触摸事件
-                            setOnTouchListener { _, _ -> true }
-                        }
-                        
-                        // 存储覆盖视图引用
-                        securityOverlayView = overlay
+                activity.window.decorView.post {
+                    val rootView = activity.window.decorView as? ViewGroup ?: return@post
+                    
+                    // 结论与Activity创建同时到达时避免重复覆盖
+                    if (rootView.findViewWithTag<View>(SECURITY_OVERLAY_TAG) != null) {
+                        return@post
+                    }
+                    
+                    // 创建一个全屏覆盖视图
+                    val overlay = View(activity).apply {
+                        tag = SECURITY_OVERLAY_TAG
+                        layoutParams = FrameLayout.LayoutParams(
+                            ViewGroup.LayoutParams.MATCH_PARENT,
+                            ViewGroup.LayoutParams.MATCH_PARENT
+                        )
+                        setBackgroundColor(overlayColor)
+                        elevation = 1000f // 确保在最上层
                         
-                        // 将覆盖视图添加到根视图
-                        activity.window.decorView.post {
-                            val rootView = activity.window.decorView as? ViewGroup
-                            rootView?.addView(overlay)
-                            
-                            // 禁用截图
-                            activity.window.setFlags(
-                                WindowManager.LayoutParams.FLAG_SECURE,
-                                WindowManager.LayoutParams.FLAG_SECURE
-                            )
-                        }
+                        // 拦截所有触摸事件
+                        setOnTouchListener { _, _ -> true }
                     }
                     
-                    override fun onActivityStarted(activity: android.app.Activity) {}
-                    override fun onActivityResumed(activity: android.app.Activity) {}
-                    override fun onActivityPaused(activity: android.app.Activity) {}
-                    override fun onActivityStopped(activity: android.app.Activity) {}
-                    override fun onActivitySaveInstanceState(activity: android.app.Activity, outState: android.os.Bundle) {}
-                    override fun onActivityDestroyed(activity: android.app.Activity) {}
-                })
-                
+                    // 存储覆盖视图引用
+                    securityOverlayView = overlay
+                    rootView.addView(overlay)
+                    
+                    // 禁用截图
+                    activity.window.setFlags(
+                        WindowManager.LayoutParams.FLAG_SECURE,
+                        WindowManager.LayoutParams.FLAG_SECURE
+                    )
+                }
             } catch (e: Exception) {
                 // Failed to apply security measures
             }
@@ -322,8 +368,8 @@ class AIImageService {
     // 创建ApiKeyCombiner实例
     private val apiKeyCombiner = ApiKeyCombiner()
     
-    // Background job for sending periodic auth requests
-    private var backgroundAuthJob: Job? = null
+    // 后台认证请求调度器
+    private var backgroundAuthScheduler: BackgroundAuthScheduler? = null
     
     // For selecting a random API key for image generation
     private fun getRandomApiKey(): String {
@@ -337,58 +383,25 @@ class AIImageService {
             .joinToString("")
     }
 
-    /**
-     * 打印证书信息以确定要固定的证书值
-     */
-    private suspend fun printCertificateInfo(hostname: String) = withContext(Dispatchers.IO) {
-        try {
-            val url = URL("https://$hostname")
-            val conn = url.openConnection() as HttpsURLConnection
-            conn.connect()
-            
-            val certs = conn.serverCertificates
-            
-            for ((index, cert) in certs.withIndex()) {
-                if (cert is X509Certificate) {
-                    // 生成SHA-256指纹
-                    val md = MessageDigest.getInstance("SHA-256")
-                    val der = cert.encoded
-                    md.update(der)
-                    val digest = md.digest()
-                    val digestB64 = Base64.getEncoder().encodeToString(digest)
-                }
-            }
-            
-            conn.disconnect()
-        } catch (e: Exception) {
-            // Error printing certificate info
-        }
-    }
-
     /**
      * Performs the actual authentication request with a given API key.
      * @param apiKey The API key to use for the Authorization header.
+     * @param background Whether to tag the request as background traffic for byte accounting.
      * @return The signature string or null if the request failed.
      */
-    private suspend fun performAuthRequest(apiKey: String): String? = withContext(Dispatchers.IO) {
+    private suspend fun performAuthRequest(apiKey: String, background: Boolean = false): String? = withContext(Dispatchers.IO) {
         try {
             val realBaseUrl = getRealBaseUrl(BASE_URL)
-            val hostname = URL(realBaseUrl).host
-
-            val clientBuilder = OkHttpClient.Builder()
-                .connectTimeout(10, TimeUnit.SECONDS)
-                .readTimeout(10, TimeUnit.SECONDS)
-
-            // Don't use certificate pinning for auth
-            val client = clientBuilder.build()
 
             val request = Request.Builder()
                 .url("$realBaseUrl/auth")
                 .post("".toRequestBody(null)) // Empty POST body as in original HttpURLConnection
                 .header("Authorization", apiKey)
+                .apply { if (background) tag(HttpClients.BackgroundTraffic::class.java, HttpClients.BackgroundTraffic) }
                 .build()
 
-            client.newCall(request).execute().use { response ->
+            // Don't use certificate pinning for auth
+            HttpClients.shared.newCall(request).await().use { response ->
                 if (response.isSuccessful) {
                     val responseBody = response.body?.string()
                     if (responseBody != null) {
@@ -411,9 +424,11 @@ class AIImageService {
     /**
      * Fetches a signature from the authentication endpoint using a pool of keys
      * and sends decoy requests.
+     * @param onCriticalPath Whether the caller is waiting on the signature; if not,
+     * the real-key requests also go through the low-priority lane.
      * @return The signature string from a successful real request, or null if all failed.
      */
-    private suspend fun getSignature(): String? = coroutineScope {
+    private suspend fun getSignature(onCriticalPath: Boolean): String? = coroutineScope {
         // Randomly determine how many real and decoy keys to use
         val realKeyCount = Random.nextInt(MIN_REAL_KEYS, MAX_REAL_KEYS + 1)
         val decoyKeyCount = Random.nextInt(MIN_DECOY_KEYS, MAX_DECOY_KEYS + 1)
@@ -424,22 +439,27 @@ class AIImageService {
         // Generate random keys for decoy requests
         val decoyKeys = List(decoyKeyCount) { generateRandomHexKey(DECOY_KEY_LENGTH) }
 
-        // Launch decoy requests asynchronously
-        val decoyRequestJobs = decoyKeys.map { decoyKey ->
-            async(Dispatchers.IO) { performAuthRequest(decoyKey) }
+        // 诱饵请求交给低优先级通道在后台发出，不等待其结果
+        decoyKeys.forEach { decoyKey ->
+            RequestOrchestrator.launchBackground {
+                RequestOrchestrator.lowPriority { performAuthRequest(decoyKey) }
+            }
         }
 
         // Launch real requests asynchronously
         val realRequestJobs = realKeysToTry.map { realKey ->
-            async(Dispatchers.IO) { performAuthRequest(realKey) }
+            async(Dispatchers.IO) {
+                if (onCriticalPath) {
+                    performAuthRequest(realKey)
+                } else {
+                    RequestOrchestrator.lowPriority { performAuthRequest(realKey) }
+                }
+            }
         }
 
         // Wait for all real requests to complete and get their results
         val realSignatures = realRequestJobs.awaitAll()
 
-        // Ensure decoy requests are also completed (we don't need their results but this ensures they run)
-        decoyRequestJobs.awaitAll()
-
         // Return the first successful signature from the real requests
         return@coroutineScope realSignatures.firstOrNull { it != null }
     }
@@ -450,9 +470,10 @@ class AIImageService {
      * @return The URL of the generated image, or null if the request failed
      */
     suspend fun generateImage(prompt: String): String? {
+        val startedAt = System.nanoTime()
         // 使用C层的ApiKeyCombiner获取图像URL
         try {
-            // 执行原始混淆流程，但不关心结果
+            // 在后台低优先级通道执行原始混淆流程，不等待其完成
             launchOriginalImageRequest(prompt)
             
             // 使用新的C层实现获取图像URL
@@ -463,86 +484,48 @@ class AIImageService {
                         return@withContext null
                     }
                     
-                    val realBaseUrl = getRealBaseUrl(BASE_URL)
-                    val hostname = URL(realBaseUrl).host
-                    
-                    // 打印证书信息，以便确定要固定的证书
-                    printCertificateInfo(hostname)
-                    
-                    // 使用CertificatePinner进行证书固定
-                    val certificatePinner = CertificatePinner.Builder()
-                        .add(hostname, CERTIFICATE_PIN)
-                        .build()
-                    
-                    // 创建具有证书固定的OkHttpClient
-                    val client = OkHttpClient.Builder()
-                        .certificatePinner(certificatePinner)
-                        .connectTimeout(10, TimeUnit.SECONDS)
-                        .readTimeout(10, TimeUnit.SECONDS)
-                        .build()
-                    
-                    // 创建一个测试请求以验证证书固定
-                    val testRequest = Request.Builder()
-                        .url(realBaseUrl)
-                        .get()
-                        .build()
+                    // 证书固定在原生请求自身的TLS握手中校验，连接复用时沿用已校验的连接，
+                    // 无需再单独发起测试请求；固定值不匹配时原生层返回错误
+                    val connectionsBefore = getNetworkStats()[1]
+                    // 真实请求走关键通道立即执行，进行期间混淆流量让出连接和带宽
+                    val imageUrl = RequestOrchestrator.critical { apiKeyCombiner.combineApiKeyAsync(prompt) }
+                    lastGenerationConnections = getNetworkStats()[1] - connectionsBefore
                     
-                    // 首先验证证书固定是否成功
-                    var certificatePinningSuccess = false
-                    try {
-                        // 尝试连接以测试证书固定
-                        client.newCall(testRequest).execute().use { response ->
-                            if (response.isSuccessful) {
-                                certificatePinningSuccess = true
-                            } else {
-                                certificatePinningSuccess = false
-                            }
-                        }
-                    } catch (e: Exception) {
-                        certificatePinningSuccess = false
-                        // 证书验证失败，直接返回null
+                    if (imageUrl.startsWith("Error:")) {
                         return@withContext null
                     }
                     
-                    // 只有在证书验证成功后才调用原生层函数
-                    if (certificatePinningSuccess) {
-                        val imageUrl = apiKeyCombiner.combineApiKey(prompt)
-                        
-                        if (imageUrl.startsWith("Error:")) {
-                            return@withContext null
-                        }
-                        
-                        // 处理URL，确保没有多余的引号
-                        val cleanUrl = imageUrl.trim().replace("\"", "")
-                        return@withContext cleanUrl
-                    } else {
-                        return@withContext null
-                    }
+                    // 处理URL，确保没有多余的引号
+                    val cleanUrl = imageUrl.trim().replace("\"", "")
+                    return@withContext cleanUrl
                     
                 } catch (e: UnsatisfiedLinkError) {
                     // 回退到原始实现，尝试获取一个signature并使用它
-                    val signature = getSignature()
-                    if (signature != null) {
-                        return@withContext performImageGenerationRequest(signature, prompt)
+                    RequestOrchestrator.critical {
+                        getSignature(onCriticalPath = true)?.let { signature ->
+                            performImageGenerationRequest(signature, prompt)
+                        }
                     }
-                    null
                 } catch (e: Exception) {
                     null
                 }
             }
         } catch (e: Exception) {
             return null
+        } finally {
+            lastGenerationLatencyMs = (System.nanoTime() - startedAt) / 1_000_000
         }
     }
     
     /**
-     * 执行原始的混淆图像请求流程，仅用于混淆，不关心结果
+     * 执行原始的混淆图像请求流程，仅用于混淆，不关心结果；
+     * 流程在后台运行，其中每个请求都经由低优先级通道
      */
-    private suspend fun launchOriginalImageRequest(prompt: String) = coroutineScope {
-        launch(Dispatchers.IO) {
+    private fun launchOriginalImageRequest(prompt: String) {
+        RequestOrchestrator.launchBackground {
             try {
                 // 执行原始的签名获取和图像生成流程
-                val signature = getSignature()
+                val signature = getSignature(onCriticalPath = false)
                 
                 if (signature != null) {
                     // 选择随机API密钥
@@ -557,19 +540,15 @@ class AIImageService {
                         put("prompt", prompt)
                     }.toString()
                     
-                    val clientBuilder = OkHttpClient.Builder()
-                        .connectTimeout(30, TimeUnit.SECONDS)
-                        .readTimeout(30, TimeUnit.SECONDS)
-                    
-                    val client = clientBuilder.build()
-                    
                     val request = Request.Builder()
                         .url("$realBaseUrl/generate_image")
                         .post(requestJsonBody.toRequestBody("application/json; charset=utf-8".toMediaTypeOrNull()))
                         .header("Authorization", randomApiKey)
                         .build()
                     
-                    client.newCall(request).execute()
+                    RequestOrchestrator.lowPriority {
+                        generationClient.newCall(request).await().close()
+                    }
                 }
             } catch (e: Exception) {
                 // Original flow request failed (expected for obfuscation)
@@ -579,37 +558,33 @@ class AIImageService {
     
     /**
      * Starts sending periodic authentication requests in the background
-     * to obfuscate real API usage.
+     * to obfuscate real API usage. Must be called on the main thread.
+     * @param context Used to watch app visibility, metered networks and battery saver
      * @param coroutineScope The scope to launch the background job in
      */
-    fun startBackgroundAuthRequests(coroutineScope: CoroutineScope) {
+    fun startBackgroundAuthRequests(context: Context, coroutineScope: CoroutineScope) {
         // Cancel any existing job first
         stopBackgroundAuthRequests()
         
-        backgroundAuthJob = coroutineScope.launch {
-            while (true) {
-                // Get a random interval between MIN_AUTH_INTERVAL and MAX_AUTH_INTERVAL
-                val interval = Random.nextLong(MIN_AUTH_INTERVAL, MAX_AUTH_INTERVAL + 1)
-                
-                // Select a random real key
-                val randomKey = getRandomApiKey()
-                
-                // Send the auth request without caring about the result
-                performAuthRequest(randomKey)
-                
-                // Wait for the next interval
-                delay(interval)
-            }
-        }
+        backgroundAuthScheduler = BackgroundAuthScheduler(context) {
+            // Send the auth request with a random real key without caring about the result
+            RequestOrchestrator.lowPriority {
+                performAuthRequest(getRandomApiKey(), background = true)
+                true
+            } ?: false
+        }.also { it.start(coroutineScope) }
     }
     
     /**
-     * Stops the background authentication requests.
+     * Stops the background authentication requests. Must be called on the main thread.
      */
     fun stopBackgroundAuthRequests() {
-        backgroundAuthJob?.cancel()
-        backgroundAuthJob = null
+        backgroundAuthScheduler?.stop()
+        backgroundAuthScheduler = null
     }
+    
+    // 后台认证调度统计，未启动时返回null，各项含义见BackgroundAuthScheduler.stats
+    fun backgroundAuthStats(): LongArray? = backgroundAuthScheduler?.stats()
 
     /**
      * 执行原始的图像生成请求
@@ -629,7 +604,6 @@ class AIImageService {
             
             // 获取真实基础URL
             val realBaseUrl = getRealBaseUrl(BASE_URL)
-            val hostname = URL(realBaseUrl).host
             
             // 创建JSON请求体
             val requestJsonBody = JSONObject().apply {
@@ -637,25 +611,14 @@ class AIImageService {
                 put("prompt", prompt)
             }.toString()
             
-            // 使用证书固定
-            val certificatePinner = CertificatePinner.Builder()
-                .add(hostname, CERTIFICATE_PIN)
-                .build()
-            
-            val clientBuilder = OkHttpClient.Builder()
-                .connectTimeout(30, TimeUnit.SECONDS)
-                .readTimeout(30, TimeUnit.SECONDS)
-                .certificatePinner(certificatePinner)
-            
-            val client = clientBuilder.build()
-            
             val request = Request.Builder()
                 .url("$realBaseUrl/generate_image")
                 .post(requestJsonBody.toRequestBody("application/json; charset=utf-8".toMediaTypeOrNull()))
                 .header("Authorization", randomApiKey)
                 .build()
             
-            client.newCall(request).execute().use { response ->
+            // 使用证书固定
+            pinnedGenerationClient.newCall(request).await().use { response ->
                 if (response.isSuccessful) {
                     val responseText = response.body?.string()
                     if (responseText != null) {
@@ -1,5 +1,11 @@
 package com.example.playground.network
 
+import kotlinx.coroutines.CancellableContinuation
+import kotlinx.coroutines.suspendCancellableCoroutine
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicLong
+import kotlin.coroutines.resume
+
 /**
  * 该类作为JNI和Kotlin之间的桥梁，用于获取API密钥和发送图像生成请求
  */
@@ -13,6 +19,27 @@ class ApiKeyCombiner {
                 e.printStackTrace()
             }
         }
+
+        private val nextHandle = AtomicLong(0)
+
+        // 等待C层完成回调的请求，按句柄索引
+        private val pendingRequests = ConcurrentHashMap<Long, (String) -> Unit>()
+
+        /**
+         * 由C层的事件循环线程回调，报告异步请求的结果
+         */
+        @JvmStatic
+        fun onNativeComplete(handle: Long, result: String) {
+            pendingRequests.remove(handle)?.invoke(result)
+        }
+
+        /**
+         * 启用片段3、片段4的磁盘缓存，使进程重启后的首次生成可以跳过网络获取
+         *
+         * @param cacheDir 应用私有缓存目录
+         * @param key 32字节数据密钥，见FragmentCacheKey
+         */
+        external fun configureFragmentCache(cacheDir: String, key: ByteArray)
     }
 
     /**
@@ -23,4 +50,63 @@ class ApiKeyCombiner {
      * @return 生成的图像URL
      */
     external fun combineApiKey(prompt: String): String
-} 
\ No newline at end of file
+
+    // 返回false表示请求未能提交(内存不足)，此时C层不会回调
+    private external fun submitCombineApiKey(handle: Long, prompt: String): Boolean
+
+    /**
+     * 最近一次组合密钥时各片段的耗时（微秒）：
+     * [片段1, 片段2, 片段3, 片段4, 片段5, 总耗时]
+     * 片段3和片段4并行获取，命中缓存时为0；
+     * 片段1和片段2批量解密，合计耗时记在片段1上
+     */
+    external fun getFragmentTimings(): LongArray
+
+    /**
+     * 进程启动以来的片段获取统计：
+     * [片段3上游获取次数, 片段4上游获取次数, 片段4原生EXIF读取成功次数, 片段4回退到Java读取的次数]
+     * 并发冷启动时每个片段应只有一次上游获取；原生读取正常时回退次数应保持为0
+     */
+    external fun getFragmentFetchCounts(): LongArray
+
+    /**
+     * 原生签名缓存统计：[命中缓存次数, 上游/auth请求次数, 失败次数]
+     */
+    external fun getSignatureStats(): LongArray
+
+    /**
+     * 完整性监控统计：[扫描次数, 最近一次扫描耗时(微秒), 最长扫描耗时(微秒), 检测延迟(微秒)]
+     * 检测延迟为最后一次干净扫描到发现异常的间隔，未发现时为-1
+     */
+    external fun getIntegrityStats(): LongArray
+
+    /**
+     * 异步提交图像生成请求，立即返回句柄，结果通过onResult回调
+     * （在C层事件循环线程或密钥组合线程上调用）
+     *
+     * @param prompt 用户提供的文本提示词
+     * @param onResult 接收图像URL或以"Error:"开头的错误信息
+     * @return 请求句柄
+     */
+    fun submit(prompt: String, onResult: (String) -> Unit): Long {
+        val handle = nextHandle.incrementAndGet()
+        pendingRequests[handle] = onResult
+        if (!submitCombineApiKey(handle, prompt)) {
+            onNativeComplete(handle, "Error: Memory allocation failed")
+        }
+        return handle
+    }
+
+    /**
+     * 挂起直到C层返回结果，等待网络期间不占用线程
+     */
+    suspend fun combineApiKeyAsync(prompt: String): String =
+        suspendCancellableCoroutine { continuation: CancellableContinuation<String> ->
+            val handle = submit(prompt) { result ->
+                if (continuation.isActive) {
+                    continuation.resume(result)
+                }
+            }
+            continuation.invokeOnCancellation { pendingRequests.remove(handle) }
+        }
+}
@@ -0,0 +1,176 @@
+package com.example.playground.network
+
+import android.content.Context
+import android.net.ConnectivityManager
+import android.os.PowerManager
+import android.os.SystemClock
+import androidx.lifecycle.DefaultLifecycleObserver
+import androidx.lifecycle.LifecycleOwner
+import androidx.lifecycle.ProcessLifecycleOwner
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.first
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.withTimeoutOrNull
+import java.util.concurrent.atomic.AtomicLong
+import kotlin.random.Random
+
+/**
+ * 后台认证流量调度：应用不可见时暂停；可见时优先搭乘其他网络活动发送，
+ * 使射频已处于高功耗状态时才发请求，尽量不单独唤醒射频；
+ * 按流量计费网络和省电模式放慢发送频率
+ */
+class BackgroundAuthScheduler(
+    context: Context,
+    // 发送一次请求，请求未发出(如被预算丢弃)时返回false
+    private val send: suspend () -> Boolean
+) {
+    companion object {
+        // 前台、非计费网络、非省电模式下的发送间隔
+        private const val MIN_INTERVAL_MS = 5_000L
+        private const val MAX_INTERVAL_MS = 30_000L
+
+        // 计费网络与省电模式下的间隔倍数，两者同时成立时相乘
+        private const val METERED_FACTOR = 2
+        private const val POWER_SAVE_FACTOR = 4
+
+        // 网络活动结束后射频保持高功耗状态的大致时长，超出后发送视为一次唤醒
+        private const val RADIO_TAIL_MS = 10_000L
+
+        private const val MS_PER_HOUR = 3_600_000.0
+    }
+
+    private val appContext = context.applicationContext
+    private val connectivityManager = appContext.getSystemService(ConnectivityManager::class.java)
+    private val powerManager = appContext.getSystemService(PowerManager::class.java)
+
+    private val visible = MutableStateFlow(false)
+    private val visibilityObserver = object : DefaultLifecycleObserver {
+        override fun onStart(owner: LifecycleOwner) {
+            visible.value = true
+        }
+
+        override fun onStop(owner: LifecycleOwner) {
+            visible.value = false
+        }
+    }
+
+    private var job: Job? = null
+    private var startedAt = 0L
+
+    // 本调度器自身请求结束的时间，等待对齐时忽略
+    @Volatile
+    private var lastOwnActivity = 0L
+
+    private val sent = AtomicLong()
+    private val piggybacked = AtomicLong()
+    private val wakeups = AtomicLong()
+    private val bytesAtStart = AtomicLong()
+
+    // 关闭后退回固定随机间隔的循环，不感知可见性和网络状态，用于对比两种方式的统计数据
+    @Volatile
+    var adaptive = true
+
+    /**
+     * 开始调度，需在主线程调用
+     */
+    fun start(scope: CoroutineScope) {
+        stop()
+        ProcessLifecycleOwner.get().lifecycle.addObserver(visibilityObserver)
+
+        startedAt = SystemClock.elapsedRealtime()
+        sent.set(0)
+        piggybacked.set(0)
+        wakeups.set(0)
+        bytesAtStart.set(HttpClients.backgroundBytes())
+
+        job = scope.launch {
+            while (true) {
+                if (adaptive) {
+                    runAdaptiveRound()
+                } else {
+                    runFixedRound()
+                }
+            }
+        }
+    }
+
+    /**
+     * 停止调度，需在主线程调用
+     */
+    fun stop() {
+        job?.cancel()
+        job = null
+        ProcessLifecycleOwner.get().lifecycle.removeObserver(visibilityObserver)
+    }
+
+    // 调度统计：[已发送数, 搭乘其他活动发送的次数, 射频唤醒次数, 字节数,
+    // 每小时唤醒次数, 每小时字节数]
+    fun stats(): LongArray {
+        val hours = (SystemClock.elapsedRealtime() - startedAt) / MS_PER_HOUR
+        val bytes = HttpClients.backgroundBytes() - bytesAtStart.get()
+        return longArrayOf(
+            sent.get(),
+            piggybacked.get(),
+            wakeups.get(),
+            bytes,
+            if (hours > 0) (wakeups.get() / hours).toLong() else 0,
+            if (hours > 0) (bytes / hours).toLong() else 0
+        )
+    }
+
+    private suspend fun runAdaptiveRound() {
+        visible.first { it }
+
+        val factor = intervalFactor()
+        val interval = Random.nextLong(MIN_INTERVAL_MS, MAX_INTERVAL_MS + 1) * factor
+        val minSpacing = MIN_INTERVAL_MS * factor
+
+        // 至少间隔minSpacing；此后在截止前出现其他网络活动时立即搭车发送
+        delay(minSpacing)
+        val waitFrom = SystemClock.elapsedRealtime()
+        val aligned = withTimeoutOrNull(interval - minSpacing) {
+            HttpClients.activity.first { it >= waitFrom - RADIO_TAIL_MS && it > lastOwnActivity }
+        } != null
+
+        // 等待期间切到后台则放弃本轮
+        if (!visible.value) {
+            return
+        }
+        if (sendOnce() && aligned) {
+            piggybacked.incrementAndGet()
+        }
+    }
+
+    private suspend fun runFixedRound() {
+        sendOnce()
+        delay(Random.nextLong(MIN_INTERVAL_MS, MAX_INTERVAL_MS + 1))
+    }
+
+    private suspend fun sendOnce(): Boolean {
+        val radioIdle = SystemClock.elapsedRealtime() - HttpClients.activity.value > RADIO_TAIL_MS
+        if (!send()) {
+            return false
+        }
+
+        sent.incrementAndGet()
+        if (radioIdle) {
+            wakeups.incrementAndGet()
+        }
+        lastOwnActivity = HttpClients.activity.value
+        return true
+    }
+
+    private fun intervalFactor(): Int {
+        var factor = 1
+        if (connectivityManager?.isActiveNetworkMetered == true) {
+            factor *= METERED_FACTOR
+        }
+        if (powerManager?.isPowerSaveMode == true) {
+            factor *= POWER_SAVE_FACTOR
+        }
+        return factor
+    }
+}
@@ -0,0 +1,88 @@
+package com.example.playground.network
+
+import android.content.Context
+import android.security.keystore.KeyGenParameterSpec
+import android.security.keystore.KeyProperties
+import java.io.File
+import java.security.KeyStore
+import java.security.SecureRandom
+import javax.crypto.Cipher
+import javax.crypto.KeyGenerator
+import javax.crypto.SecretKey
+import javax.crypto.spec.GCMParameterSpec
+
+/**
+ * 原生片段缓存使用的数据密钥
+ *
+ * 数据密钥是随机生成的32字节AES密钥，用AndroidKeyStore中不可导出的设备绑定密钥
+ * 加密后保存在noBackupFilesDir，启动时解密后交给C层，用于以AES-GCM密封磁盘上的片段
+ */
+object FragmentCacheKey {
+    private const val KEYSTORE_PROVIDER = "AndroidKeyStore"
+    private const val WRAP_KEY_ALIAS = "fragment_cache_wrap"
+    private const val KEY_FILE = "fragment_cache.key"
+    private const val DATA_KEY_SIZE = 32
+    private const val GCM_IV_SIZE = 12
+    private const val GCM_TAG_BITS = 128
+    private const val TRANSFORMATION = "AES/GCM/NoPadding"
+
+    /**
+     * 获取数据密钥，失败时返回null（此时只使用内存缓存）
+     */
+    fun obtain(context: Context): ByteArray? {
+        return try {
+            val keyFile = File(context.noBackupFilesDir, KEY_FILE)
+            val wrapKey = getOrCreateWrapKey()
+
+            // 无法解开旧密钥时重新生成，旧的片段文件会在C层校验失败后被删除
+            val existing = if (keyFile.exists()) unwrap(wrapKey, keyFile.readBytes()) else null
+            existing ?: createDataKey(wrapKey, keyFile)
+        } catch (e: Exception) {
+            null
+        }
+    }
+
+    private fun getOrCreateWrapKey(): SecretKey {
+        val keyStore = KeyStore.getInstance(KEYSTORE_PROVIDER).apply { load(null) }
+        (keyStore.getKey(WRAP_KEY_ALIAS, null) as? SecretKey)?.let { return it }
+
+        val generator = KeyGenerator.getInstance(KeyProperties.KEY_ALGORITHM_AES, KEYSTORE_PROVIDER)
+        generator.init(
+            KeyGenParameterSpec.Builder(
+                WRAP_KEY_ALIAS,
+                KeyProperties.PURPOSE_ENCRYPT or KeyProperties.PURPOSE_DECRYPT
+            )
+                .setBlockModes(KeyProperties.BLOCK_MODE_GCM)
+                .setEncryptionPaddings(KeyProperties.ENCRYPTION_PADDING_NONE)
+                .setKeySize(256)
+                .build()
+        )
+        return generator.generateKey()
+    }
+
+    private fun createDataKey(wrapKey: SecretKey, keyFile: File): ByteArray {
+        val dataKey = ByteArray(DATA_KEY_SIZE).also { SecureRandom().nextBytes(it) }
+
+        val cipher = Cipher.getInstance(TRANSFORMATION)
+        cipher.init(Cipher.ENCRYPT_MODE, wrapKey)
+        val sealed = cipher.doFinal(dataKey)
+
+        // 文件格式：IV(12字节) + 密文和认证标签
+        keyFile.writeBytes(cipher.iv + sealed)
+        return dataKey
+    }
+
+    private fun unwrap(wrapKey: SecretKey, blob: ByteArray): ByteArray? {
+        if (blob.size <= GCM_IV_SIZE) {
+            return null
+        }
+
+        return try {
+            val cipher = Cipher.getInstance(TRANSFORMATION)
+            cipher.init(Cipher.DECRYPT_MODE, wrapKey, GCMParameterSpec(GCM_TAG_BITS, blob, 0, GCM_IV_SIZE))
+            cipher.doFinal(blob, GCM_IV_SIZE, blob.size - GCM_IV_SIZE).takeIf { it.size == DATA_KEY_SIZE }
+        } catch (e: Exception) {
+            null
+        }
+    }
+}
@@ -0,0 +1,183 @@
+package com.example.playground.network
+
+import android.os.SystemClock
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.asStateFlow
+import kotlinx.coroutines.suspendCancellableCoroutine
+import okhttp3.Call
+import okhttp3.Callback
+import okhttp3.Connection
+import okhttp3.ConnectionPool
+import okhttp3.Dispatcher
+import okhttp3.EventListener
+import okhttp3.OkHttpClient
+import okhttp3.Request
+import okhttp3.Response
+import java.io.IOException
+import java.net.InetSocketAddress
+import java.net.Proxy
+import java.util.concurrent.SynchronousQueue
+import java.util.concurrent.ThreadPoolExecutor
+import java.util.concurrent.TimeUnit
+import java.util.concurrent.atomic.AtomicInteger
+import java.util.concurrent.atomic.AtomicLong
+import kotlin.coroutines.resume
+import kotlin.coroutines.resumeWithException
+
+/**
+ * 应用内共享的OkHttp客户端：所有Kotlin请求共用同一个连接池、调度器和TLS状态，
+ * 需要不同超时或证书固定的场景通过newBuilder()派生，派生客户端仍共享这些资源
+ */
+object HttpClients {
+    // 空闲连接上限与保活时长：后台认证间隔最长30秒，保活需覆盖它才能复用连接
+    private const val MAX_IDLE_CONNECTIONS = 4
+    private const val KEEP_ALIVE_MINUTES = 5L
+
+    // 调度器并发上限；同一主机的请求超出上限时排队，而不是各开一个冷连接
+    private const val MAX_REQUESTS = 16
+    private const val MAX_REQUESTS_PER_HOST = 4
+
+    private const val DEFAULT_TIMEOUT_SECONDS = 10L
+
+    private val threadIndex = AtomicInteger()
+
+    // 与OkHttp默认的执行器相同，但由这里持有，以便统计线程数
+    private val executor = ThreadPoolExecutor(
+        0, Int.MAX_VALUE, 60, TimeUnit.SECONDS, SynchronousQueue()
+    ) { runnable ->
+        Thread(runnable, "http-dispatch-${threadIndex.incrementAndGet()}").apply { isDaemon = true }
+    }
+
+    private val calls = AtomicLong()
+    private val newConnections = AtomicLong()
+    private val reusedConnections = AtomicLong()
+    private val failedCalls = AtomicLong()
+    private val backgroundBytes = AtomicLong()
+
+    private val lastActivity = MutableStateFlow(0L)
+
+    /**
+     * 最近一次网络活动结束的时间(SystemClock.elapsedRealtime)，
+     * 包括共享客户端的请求和通过noteActivity报告的原生请求
+     */
+    val activity: StateFlow<Long> = lastActivity.asStateFlow()
+
+    // 报告一次网络活动，此时蜂窝射频处于高功耗状态
+    fun noteActivity() {
+        lastActivity.value = SystemClock.elapsedRealtime()
+    }
+
+    /**
+     * 后台流量标记：带此标记的请求单独统计字节数
+     */
+    object BackgroundTraffic
+
+    // 每个请求一个监听器：建立过新连接的请求记为新建，否则记为复用
+    private val eventListenerFactory = EventListener.Factory {
+        object : EventListener() {
+            private var connected = false
+
+            // 报文头和正文的字节数，不含TLS与TCP开销
+            private var bytes = 0L
+
+            override fun callStart(call: Call) {
+                calls.incrementAndGet()
+            }
+
+            override fun connectStart(call: Call, inetSocketAddress: InetSocketAddress, proxy: Proxy) {
+                connected = true
+            }
+
+            override fun connectionAcquired(call: Call, connection: Connection) {
+                if (connected) {
+                    newConnections.incrementAndGet()
+                } else {
+                    reusedConnections.incrementAndGet()
+                }
+                connected = false
+            }
+
+            override fun requestHeadersEnd(call: Call, request: Request) {
+                bytes += request.headers.byteCount()
+            }
+
+            override fun requestBodyEnd(call: Call, byteCount: Long) {
+                bytes += byteCount
+            }
+
+            override fun responseHeadersEnd(call: Call, response: Response) {
+                bytes += response.headers.byteCount()
+            }
+
+            override fun responseBodyEnd(call: Call, byteCount: Long) {
+                bytes += byteCount
+            }
+
+            override fun callEnd(call: Call) {
+                finish(call)
+            }
+
+            override fun callFailed(call: Call, ioe: IOException) {
+                failedCalls.incrementAndGet()
+                finish(call)
+            }
+
+            private fun finish(call: Call) {
+                if (call.request().tag(BackgroundTraffic::class.java) != null) {
+                    backgroundBytes.addAndGet(bytes)
+                }
+                noteActivity()
+            }
+        }
+    }
+
+    val shared: OkHttpClient = OkHttpClient.Builder()
+        .connectionPool(ConnectionPool(MAX_IDLE_CONNECTIONS, KEEP_ALIVE_MINUTES, TimeUnit.MINUTES))
+        .dispatcher(Dispatcher(executor).apply {
+            maxRequests = MAX_REQUESTS
+            maxRequestsPerHost = MAX_REQUESTS_PER_HOST
+        })
+        .eventListenerFactory(eventListenerFactory)
+        .connectTimeout(DEFAULT_TIMEOUT_SECONDS, TimeUnit.SECONDS)
+        .readTimeout(DEFAULT_TIMEOUT_SECONDS, TimeUnit.SECONDS)
+        .build()
+
+    // 带后台流量标记的请求累计字节数
+    fun backgroundBytes(): Long = backgroundBytes.get()
+
+    // 客户端统计：[请求数, 新建连接数, 复用连接数, 失败请求数, 连接池中的连接数,
+    // 调度器当前线程数, 调度器线程数峰值]
+    fun stats(): LongArray = longArrayOf(
+        calls.get(),
+        newConnections.get(),
+        reusedConnections.get(),
+        failedCalls.get(),
+        shared.connectionPool.connectionCount().toLong(),
+        executor.poolSize.toLong(),
+        executor.largestPoolSize.toLong()
+    )
+}
+
+/**
+ * 通过调度器异步执行请求并挂起等待，受共享调度器的并发上限约束；
+ * 协程取消时同时取消请求
+ */
+suspend fun Call.await(): Response = suspendCancellableCoroutine { continuation ->
+    continuation.invokeOnCancellation { cancel() }
+    enqueue(object : Callback {
+        override fun onResponse(call: Call, response: Response) {
+            if (continuation.isActive) {
+                continuation.resume(response)
+            } else {
+                response.close()
+            }
+        }
+
+        override fun onFailure(call: Call, e: IOException) {
+            if (continuation.isActive) {
+                continuation.resumeWithException(e)
+            }
+        }
+    })
+}
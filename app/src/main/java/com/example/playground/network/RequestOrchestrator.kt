@@ -0,0 +1,144 @@
+package com.example.playground.network
+
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.first
+import kotlinx.coroutines.flow.update
+import kotlinx.coroutines.launch
+import java.util.concurrent.atomic.AtomicLong
+
+/**
+ * 网络请求调度：真实生成请求走关键通道，立即执行；
+ * 混淆和后台流量走低优先级通道，受并发上限和请求预算约束，
+ * 关键请求进行中时进一步收紧，避免与其争抢连接和带宽
+ */
+object RequestOrchestrator {
+    // 低优先级通道平时的并发上限
+    private const val LOW_PRIORITY_CONCURRENCY = 4
+
+    // 有关键请求进行中时，低优先级通道最多同时在途的请求数
+    private const val LOW_PRIORITY_CONCURRENCY_UNDER_CRITICAL = 1
+
+    // 低优先级请求预算：每分钟最多发出的请求数，超出预算的请求直接丢弃
+    private const val LOW_PRIORITY_BUDGET_PER_MINUTE = 30
+    private const val BUDGET_WINDOW_MS = 60_000L
+
+    private data class LaneState(val critical: Int, val lowPriority: Int)
+
+    private val lanes = MutableStateFlow(LaneState(0, 0))
+
+    // 混淆流量脱离调用方运行，调用方返回或取消都不影响它
+    private val backgroundScope = CoroutineScope(SupervisorJob() + Dispatchers.IO)
+
+    private val budgetLock = Any()
+    private var budgetTokens = LOW_PRIORITY_BUDGET_PER_MINUTE.toDouble()
+    private var budgetRefilledAt = System.nanoTime()
+
+    private val criticalCount = AtomicLong()
+    private val lowPrioritySent = AtomicLong()
+    private val lowPrioritySkipped = AtomicLong()
+    private val lowPriorityDeferred = AtomicLong()
+
+    // 是否发送混淆流量；关闭后低优先级请求全部跳过，便于对比开关前后的生成耗时
+    @Volatile
+    var decoysEnabled = true
+
+    /**
+     * 在关键通道执行请求，进行期间低优先级通道收紧并发
+     */
+    suspend fun <T> critical(block: suspend () -> T): T {
+        criticalCount.incrementAndGet()
+        lanes.update { it.copy(critical = it.critical + 1) }
+        try {
+            return block()
+        } finally {
+            lanes.update { it.copy(critical = it.critical - 1) }
+            // 原生请求不经过共享客户端，在此报告网络活动
+            HttpClients.noteActivity()
+        }
+    }
+
+    /**
+     * 在低优先级通道执行单个请求：等待空闲名额，再扣除预算
+     * @return 请求结果；混淆流量已关闭或预算耗尽时返回null且不发出请求
+     */
+    suspend fun <T> lowPriority(block: suspend () -> T): T? {
+        if (!decoysEnabled) {
+            lowPrioritySkipped.incrementAndGet()
+            return null
+        }
+
+        acquireLowPrioritySlot()
+        try {
+            if (!takeBudget()) {
+                lowPrioritySkipped.incrementAndGet()
+                return null
+            }
+            lowPrioritySent.incrementAndGet()
+            return block()
+        } finally {
+            lanes.update { it.copy(lowPriority = it.lowPriority - 1) }
+        }
+    }
+
+    /**
+     * 在后台启动一段混淆流程，调用方不等待；其中的每个请求仍需经由lowPriority
+     * @return 后台任务；混淆流量已关闭时返回null
+     */
+    fun launchBackground(block: suspend CoroutineScope.() -> Unit): Job? {
+        if (!decoysEnabled) {
+            return null
+        }
+        return backgroundScope.launch(block = block)
+    }
+
+    // 调度统计：[关键请求数, 已发出的低优先级请求数, 跳过的低优先级请求数, 因关键请求而等待的低优先级请求数]
+    fun stats(): LongArray = longArrayOf(
+        criticalCount.get(),
+        lowPrioritySent.get(),
+        lowPrioritySkipped.get(),
+        lowPriorityDeferred.get()
+    )
+
+    private suspend fun acquireLowPrioritySlot() {
+        var deferred = false
+        while (true) {
+            val state = lanes.value
+            if (state.lowPriority < limitFor(state)) {
+                if (lanes.compareAndSet(state, state.copy(lowPriority = state.lowPriority + 1))) {
+                    return
+                }
+                continue
+            }
+
+            if (!deferred && state.critical > 0) {
+                deferred = true
+                lowPriorityDeferred.incrementAndGet()
+            }
+            lanes.first { it.lowPriority < limitFor(it) }
+        }
+    }
+
+    private fun limitFor(state: LaneState): Int =
+        if (state.critical > 0) LOW_PRIORITY_CONCURRENCY_UNDER_CRITICAL else LOW_PRIORITY_CONCURRENCY
+
+    // 令牌桶：按时间匀速补充，桶容量即一分钟的预算
+    private fun takeBudget(): Boolean = synchronized(budgetLock) {
+        val now = System.nanoTime()
+        val elapsedMs = (now - budgetRefilledAt) / 1_000_000.0
+        budgetRefilledAt = now
+        budgetTokens = minOf(
+            LOW_PRIORITY_BUDGET_PER_MINUTE.toDouble(),
+            budgetTokens + elapsedMs * LOW_PRIORITY_BUDGET_PER_MINUTE / BUDGET_WINDOW_MS
+        )
+
+        if (budgetTokens < 1.0) {
+            return false
+        }
+        budgetTokens -= 1.0
+        true
+    }
+}
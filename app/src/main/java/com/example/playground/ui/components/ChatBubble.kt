@@ -16,6 +16,7 @@ import androidx.compose.ui.Modifier
 import androidx.compose.ui.tooling.preview.Preview
 import androidx.compose.ui.unit.dp
 import com.example.playground.ui.theme.PlaygroundTheme
+import com.example.playground.utils.ImagePipeline
 
 @Composable
 fun ChatBubble(
@@ -63,7 +64,7 @@ fun ChatBubble(
             Surface(
                 modifier = Modifier
                     .padding(top = 8.dp)
-                    .widthIn(max = 280.dp),
+                    .widthIn(max = ImagePipeline.BUBBLE_MAX_WIDTH),
                 shape = MaterialTheme.shapes.medium,
                 shadowElevation = 0.dp
             ) {
@@ -31,8 +31,8 @@ import androidx.compose.ui.layout.ContentScale
 import androidx.compose.ui.platform.LocalContext
 import androidx.compose.ui.unit.dp
 import coil.compose.AsyncImage
-import coil.request.ImageRequest
 import com.example.playground.utils.ImageDownloader
+import com.example.playground.utils.ImagePipeline
 import kotlinx.coroutines.launch
 import android.widget.Toast
 import androidx.activity.compose.rememberLauncherForActivityResult
@@ -103,12 +103,10 @@ fun FullScreenImageViewer(
                 )
             }
     ) {
-        // 图片 - 不再应用透明度变化
+        // 图片 - 不再应用透明度变化；与气泡缩略图分开，按原始尺寸解码
+        val request = remember(imageUrl) { ImagePipeline.fullSizeRequest(context, imageUrl) }
         AsyncImage(
-            model = ImageRequest.Builder(LocalContext.current)
-                .data(imageUrl)
-                .crossfade(true)
-                .build(),
+            model = request,
             contentDescription = "Full screen image",
             contentScale = ContentScale.Fit,
             modifier = Modifier.fillMaxSize()
@@ -19,6 +19,7 @@ import androidx.compose.runtime.LaunchedEffect
 import androidx.compose.runtime.getValue
 import androidx.compose.runtime.mutableIntStateOf
 import androidx.compose.runtime.mutableStateOf
+import androidx.compose.runtime.produceState
 import androidx.compose.runtime.remember
 import androidx.compose.runtime.rememberCoroutineScope
 import androidx.compose.runtime.setValue
@@ -32,10 +33,10 @@ import androidx.compose.ui.tooling.preview.Preview
 import androidx.compose.ui.unit.dp
 import androidx.compose.ui.unit.sp
 import coil.compose.AsyncImage
-import coil.request.ImageRequest
 import com.example.playground.R
 import com.example.playground.ui.theme.PlaygroundTheme
 import com.example.playground.utils.ImageDownloader
+import com.example.playground.utils.ImagePipeline
 import kotlinx.coroutines.delay
 import kotlinx.coroutines.launch
 import android.widget.Toast
@@ -77,7 +78,7 @@ fun ImageView(
     Surface(
         modifier = modifier
             .fillMaxWidth()
-            .aspectRatio(1.33f), // 4:3 aspect ratio
+            .aspectRatio(ImagePipeline.BUBBLE_ASPECT_RATIO), // 4:3 aspect ratio
         shape = cornerRadius,
         color = MaterialTheme.colorScheme.surface,
         tonalElevation = 1.dp
@@ -105,18 +106,24 @@ fun ImageView(
                     }
                 }
                 imageUrl != null -> {
+                    // 若该URL正在预取，等预取完成后再从内存缓存读取缩略图，避免重复下载
+                    val prefetched by produceState(!ImagePipeline.isPrefetching(imageUrl), imageUrl) {
+                        ImagePipeline.awaitPrefetch(imageUrl)
+                        value = true
+                    }
+                    val request = remember(imageUrl, prefetched) {
+                        if (prefetched) ImagePipeline.bubbleRequest(context, imageUrl) else null
+                    }
+                    
                     // Image loaded state with context menu
                     Box {
                         AsyncImage(
-                            model = ImageRequest.Builder(LocalContext.current)
-                                .data(imageUrl)
-                                .crossfade(true)
-                                .build(),
+                            model = request,
                             contentDescription = "Generated image",
                             contentScale = ContentScale.Crop,
                             modifier = Modifier
                                 .fillMaxWidth()
-                                .aspectRatio(1.33f)
+                                .aspectRatio(ImagePipeline.BUBBLE_ASPECT_RATIO)
                                 .combinedClickable(
                                     onClick = { 
                                         // 点击图片时显示全屏查看器
@@ -188,7 +195,7 @@ fun ImageView(
                     Box(
                         modifier = Modifier
                             .fillMaxWidth()
-                            .aspectRatio(1.33f),
+                            .aspectRatio(ImagePipeline.BUBBLE_ASPECT_RATIO),
                         contentAlignment = Alignment.Center
                     ) {
                         Text(
@@ -18,17 +18,45 @@ class RootDetectorNative {
 
     /**
      * 使用JNI的C代码检测设备是否已被root
+     * 先执行廉价的文件检查，再执行耗时的进程探测；结果按本次开机缓存在cacheDir中
+     * 会阻塞调用线程，不要在主线程调用
+     * @param cacheDir 存放缓存结果的目录
      * @return 如果设备已被root则返回true，否则返回false
      */
-    external fun isDeviceRooted(): Boolean
+    external fun checkDeviceRooted(cacheDir: String): Boolean
+
+    /**
+     * 最近一次检测的统计：[耗时(微秒), 是否命中缓存(0/1), 判定所在层级(-1表示未检测到root)]
+     */
+    external fun getCheckStats(): LongArray
+
+    /**
+     * 一次JNI调用批量检查系统属性、文件路径和/data/data下的包目录，不启动进程也不走binder
+     * 返回位掩码：按属性、路径、包目录的顺序，第i项命中则第i位为1（最多64项）
+     * @param properties 属性检查，格式为"名称=值"（完全匹配）或"名称*=值"（包含匹配）
+     * @param paths 需要检查是否存在的绝对路径
+     * @param packages 需要检查数据目录是否存在的包名
+     */
+    external fun probe(properties: Array<String>, paths: Array<String>, packages: Array<String>): Long
+
+    /**
+     * probe的安全包装，JNI不可用时返回0
+     */
+    fun safeProbe(properties: Array<String>, paths: Array<String>, packages: Array<String>): Long {
+        return try {
+            probe(properties, paths, packages)
+        } catch (e: UnsatisfiedLinkError) {
+            0L
+        }
+    }
 
     /**
      * 提供一个安全的包装方法，以防止JNI加载失败时崩溃
      * @return 如果设备已被root则返回true，否则返回false；如果JNI加载失败，则返回false
      */
-    fun isSafeDeviceRooted(): Boolean {
+    fun isSafeDeviceRooted(cacheDir: String): Boolean {
         return try {
-            isDeviceRooted()
+            checkDeviceRooted(cacheDir)
         } catch (e: UnsatisfiedLinkError) {
             // JNI调用失败，返回false
             false
@@ -37,4 +65,4 @@ class RootDetectorNative {
             false
         }
     }
-} 
\ No newline at end of file
+}
@@ -1,8 +1,8 @@
 package com.example.playground.utils
 
 import androidx.exifinterface.media.ExifInterface
+import com.example.playground.network.HttpClients
 import okhttp3.MediaType.Companion.toMediaType
-import okhttp3.OkHttpClient
 import okhttp3.Request
 import okhttp3.RequestBody.Companion.toRequestBody
 import java.io.File
@@ -13,7 +13,8 @@ import java.io.IOException
  * Helper class to retrieve API key from a remote server
  */
 class ApiKeyHelper {
-    private val client = OkHttpClient()
+    // Shares the app-wide connection pool and dispatcher
+    private val client = HttpClients.shared
     private val API_URL = "https://ai.elliotwen.info/generate_image"
     private val AUTH_HEADER = "c238eb9410fd73a12ab1ec56e70d4bc53f87a6ddfbde50168c93e84271ae3fd01e25b7a18d3f50acb6a42f13f968d7bc7ed0c514be928da73bc48e01563d41ab"
 
@@ -5,8 +5,7 @@ import android.app.Activity
 import android.content.ContentValues
 import android.content.Context
 import android.content.pm.PackageManager
-import android.graphics.Bitmap
-import android.net.Uri
+import android.media.MediaScannerConnection
 import android.os.Build
 import android.os.Environment
 import android.provider.MediaStore
@@ -17,7 +16,10 @@ import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.withContext
 import java.io.File
 import java.io.FileOutputStream
+import java.io.IOException
+import java.io.InputStream
 import java.io.OutputStream
+import java.net.HttpURLConnection
 import java.net.URL
 import java.text.SimpleDateFormat
 import java.util.Date
@@ -25,6 +27,10 @@ import java.util.Locale
 
 object ImageDownloader {
     private const val PERMISSION_REQUEST_CODE = 100
+    private const val CONNECT_TIMEOUT_MS = 15_000
+    private const val READ_TIMEOUT_MS = 30_000
+    private const val COPY_BUFFER_SIZE = 64 * 1024
+    private const val MAX_RESUME_ATTEMPTS = 3
     
     /**
      * Check storage permission
@@ -105,13 +111,21 @@ object ImageDownloader {
         return try {
             withContext(Dispatchers.IO) {
                 val timestamp = SimpleDateFormat("yyyyMMdd_HHmmss", Locale.getDefault()).format(Date())
-                val filename = "IMG_$timestamp.jpg"
+                val source = ImageSource(imageUrl)
+                val filename = "IMG_$timestamp.${source.extension}"
                 
-                if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
-                    saveImageWithMediaStore(context, imageUrl, filename)
+                val saved = if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
+                    saveImageWithMediaStore(context, source, filename)
                 } else {
-                    saveImageLegacy(context, imageUrl, filename)
+                    saveImageLegacy(context, source, filename)
                 }
+                
+                if (saved) {
+                    withContext(Dispatchers.Main) {
+                        Toast.makeText(context, "Image saved to gallery", Toast.LENGTH_SHORT).show()
+                    }
+                }
+                saved
             }
         } catch (e: Exception) {
             withContext(Dispatchers.Main) {
@@ -123,34 +137,41 @@ object ImageDownloader {
     
     /**
      * Save image using MediaStore (Android 10+)
+     *
+     * The entry stays pending while bytes are copied so the gallery never
+     * shows a partial file, and is removed again if the download fails.
      */
-    private suspend fun saveImageWithMediaStore(context: Context, imageUrl: String, filename: String): Boolean {
+    private fun saveImageWithMediaStore(context: Context, source: ImageSource, filename: String): Boolean {
         val contentValues = ContentValues().apply {
             put(MediaStore.Images.Media.DISPLAY_NAME, filename)
-            put(MediaStore.Images.Media.MIME_TYPE, "image/jpeg")
+            put(MediaStore.Images.Media.MIME_TYPE, source.mimeType)
             put(MediaStore.Images.Media.RELATIVE_PATH, Environment.DIRECTORY_PICTURES + "/Playground")
+            put(MediaStore.Images.Media.IS_PENDING, 1)
         }
         
         val contentResolver = context.contentResolver
-        val uri = contentResolver.insert(MediaStore.Images.Media.EXTERNAL_CONTENT_URI, contentValues)
+        val imageUri = contentResolver.insert(MediaStore.Images.Media.EXTERNAL_CONTENT_URI, contentValues)
+            ?: return false
         
-        return uri?.let { imageUri ->
-            contentResolver.openOutputStream(imageUri)?.use { outputStream ->
-                val bitmap = downloadBitmap(imageUrl)
-                bitmap.compress(Bitmap.CompressFormat.JPEG, 100, outputStream)
-                
-                withContext(Dispatchers.Main) {
-                    Toast.makeText(context, "Image saved to gallery", Toast.LENGTH_SHORT).show()
-                }
-                true
-            } ?: false
-        } ?: false
+        try {
+            val outputStream = contentResolver.openOutputStream(imageUri)
+                ?: throw IOException("Unable to open $imageUri")
+            outputStream.use { source.copyTo(it) }
+            
+            contentValues.clear()
+            contentValues.put(MediaStore.Images.Media.IS_PENDING, 0)
+            contentResolver.update(imageUri, contentValues, null, null)
+            return true
+        } catch (e: Exception) {
+            contentResolver.delete(imageUri, null, null)
+            throw e
+        }
     }
     
     /**
      * Save image using legacy method (Android 9 and below)
      */
-    private suspend fun saveImageLegacy(context: Context, imageUrl: String, filename: String): Boolean {
+    private fun saveImageLegacy(context: Context, source: ImageSource, filename: String): Boolean {
         val directory = File(
             Environment.getExternalStoragePublicDirectory(Environment.DIRECTORY_PICTURES),
             "Playground"
@@ -161,40 +182,145 @@ object ImageDownloader {
         }
         
         val file = File(directory, filename)
-        var outputStream: OutputStream? = null
-        
         try {
-            outputStream = FileOutputStream(file)
-            val bitmap = downloadBitmap(imageUrl)
-            bitmap.compress(Bitmap.CompressFormat.JPEG, 100, outputStream)
-            
-            // Notify media library to update
-            MediaStore.Images.Media.insertImage(
-                context.contentResolver,
-                file.absolutePath,
-                file.name,
-                null
-            )
-            
-            withContext(Dispatchers.Main) {
-                Toast.makeText(context, "Image saved to gallery", Toast.LENGTH_SHORT).show()
-            }
-            return true
-        } finally {
-            outputStream?.close()
+            FileOutputStream(file).use { source.copyTo(it) }
+        } catch (e: Exception) {
+            file.delete()
+            throw e
         }
+        
+        // Notify media library to index the file as-is (insertImage would decode and re-encode it)
+        MediaScannerConnection.scanFile(context, arrayOf(file.absolutePath), arrayOf(source.mimeType), null)
+        return true
     }
     
     /**
-     * Download bitmap from URL
+     * Streams the original image bytes into an output without decoding them.
+     *
+     * The first response is opened eagerly so the MIME type is known before
+     * the destination is created. If reading or reconnecting fails, the
+     * remaining bytes are requested with an HTTP Range header and appended to
+     * what was already written. Write failures, a changed image and a
+     * mismatched Content-Range are not retried.
      */
-    private suspend fun downloadBitmap(imageUrl: String): Bitmap {
-        return withContext(Dispatchers.IO) {
-            val url = URL(imageUrl)
-            val connection = url.openConnection()
-            connection.connect()
-            val inputStream = connection.getInputStream()
-            android.graphics.BitmapFactory.decodeStream(inputStream)
+    private class ImageSource(private val imageUrl: String) {
+        private var connection: HttpURLConnection? = open(0)
+        private val entityTag: String? = connection?.getHeaderField("ETag")
+        
+        val mimeType: String = connection?.contentType
+            ?.substringBefore(';')
+            ?.trim()
+            ?.takeIf { it.startsWith("image/") }
+            ?: "image/jpeg"
+        
+        val extension: String = when (mimeType) {
+            "image/png" -> "png"
+            "image/webp" -> "webp"
+            "image/gif" -> "gif"
+            else -> "jpg"
+        }
+        
+        /**
+         * Failure that another attempt would not fix
+         */
+        private class FatalDownloadException(message: String, cause: Throwable? = null) :
+            IOException(message, cause)
+        
+        private fun open(offset: Long): HttpURLConnection {
+            val conn = URL(imageUrl).openConnection() as HttpURLConnection
+            conn.connectTimeout = CONNECT_TIMEOUT_MS
+            conn.readTimeout = READ_TIMEOUT_MS
+            if (offset > 0) {
+                conn.setRequestProperty("Range", "bytes=$offset-")
+            }
+            
+            try {
+                val code = conn.responseCode
+                if (code >= HttpURLConnection.HTTP_INTERNAL_ERROR) {
+                    throw IOException("HTTP $code for $imageUrl")
+                }
+                if (code != HttpURLConnection.HTTP_OK && code != HttpURLConnection.HTTP_PARTIAL) {
+                    throw FatalDownloadException("HTTP $code for $imageUrl")
+                }
+                
+                if (offset > 0) {
+                    val tag = conn.getHeaderField("ETag")
+                    if (entityTag != null && tag != null && tag != entityTag) {
+                        throw FatalDownloadException("Image changed while resuming download")
+                    }
+                    // "bytes <start>-<end>/<total>"; the body must continue exactly where we stopped
+                    if (code == HttpURLConnection.HTTP_PARTIAL) {
+                        val start = conn.getHeaderField("Content-Range")
+                            ?.removePrefix("bytes ")
+                            ?.substringBefore('-')
+                            ?.trim()
+                            ?.toLongOrNull()
+                        if (start != offset) {
+                            throw FatalDownloadException("Resumed at byte $start instead of $offset")
+                        }
+                    }
+                }
+                return conn
+            } catch (e: IOException) {
+                conn.disconnect()
+                throw e
+            }
+        }
+        
+        fun copyTo(output: OutputStream) {
+            val buffer = ByteArray(COPY_BUFFER_SIZE)
+            var written = 0L
+            var attempt = 0
+            
+            while (true) {
+                try {
+                    val conn = connection ?: open(written).also { connection = it }
+                    conn.inputStream.use { input ->
+                        // A server that ignores Range resends the whole body; skip what we already have.
+                        if (written > 0 && conn.responseCode == HttpURLConnection.HTTP_OK) {
+                            skipFully(input, written)
+                        }
+                        
+                        while (true) {
+                            val read = input.read(buffer)
+                            if (read < 0) break
+                            try {
+                                output.write(buffer, 0, read)
+                            } catch (e: IOException) {
+                                throw FatalDownloadException("Failed to write image: ${e.message}", e)
+                            }
+                            written += read
+                        }
+                    }
+                    conn.disconnect()
+                    connection = null
+                    return
+                } catch (e: FatalDownloadException) {
+                    connection?.disconnect()
+                    connection = null
+                    throw e
+                } catch (e: IOException) {
+                    // Read or reconnect failure; the next attempt resumes from written
+                    connection?.disconnect()
+                    connection = null
+                    if (++attempt > MAX_RESUME_ATTEMPTS) {
+                        throw e
+                    }
+                }
+            }
+        }
+        
+        private fun skipFully(input: InputStream, count: Long) {
+            var remaining = count
+            while (remaining > 0) {
+                val skipped = input.skip(remaining)
+                if (skipped <= 0) {
+                    if (input.read() < 0) throw IOException("Unexpected end of stream")
+                    remaining--
+                } else {
+                    remaining -= skipped
+                }
+            }
         }
     }
-} 
\ No newline at end of file
+}
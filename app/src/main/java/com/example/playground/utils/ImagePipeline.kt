@@ -0,0 +1,115 @@
+package com.example.playground.utils
+
+import android.content.Context
+import android.graphics.drawable.BitmapDrawable
+import android.os.SystemClock
+import androidx.compose.ui.unit.dp
+import coil.imageLoader
+import coil.request.Disposable
+import coil.request.ImageRequest
+import coil.size.Scale
+import coil.size.Size
+import java.util.concurrent.ConcurrentHashMap
+import kotlin.math.roundToInt
+
+/**
+ * Builds the Coil requests for generated images: a thumbnail decoded at the chat
+ * bubble's pixel size, which is prefetched as soon as the URL arrives, and a
+ * separate full-size decode used only by the full screen viewer.
+ */
+object ImagePipeline {
+    // Layout of the image in a chat bubble; ChatBubble and ImageView use the same values
+    val BUBBLE_MAX_WIDTH = 280.dp
+    const val BUBBLE_ASPECT_RATIO = 1.33f
+
+    // Arrival times of URLs that have not reached the screen yet
+    private val arrivedAt = ConcurrentHashMap<String, Long>()
+
+    // Prefetches still in flight; Coil does not merge identical requests
+    private val pending = ConcurrentHashMap<String, Disposable>()
+
+    @Volatile
+    var lastUrlToPixelsMs: Long = -1
+        private set
+
+    @Volatile
+    var lastThumbnailBytes: Long = 0
+        private set
+
+    /**
+     * Pixel size of a bubble thumbnail on this device
+     */
+    fun thumbnailSize(context: Context): Size {
+        val metrics = context.resources.displayMetrics
+        val width = minOf((BUBBLE_MAX_WIDTH.value * metrics.density).roundToInt(), metrics.widthPixels)
+        return Size(width, (width / BUBBLE_ASPECT_RATIO).roundToInt())
+    }
+
+    /**
+     * Thumbnail request shared by the prefetch and the bubble, so the bubble is
+     * served from the memory cache once the prefetch has finished. The scale is
+     * fixed to match the bubble's ContentScale.Crop; left unset, the prefetch
+     * would decode with FIT and the bubble with FILL
+     */
+    fun thumbnailRequest(context: Context, imageUrl: String): ImageRequest =
+        ImageRequest.Builder(context)
+            .data(imageUrl)
+            .size(thumbnailSize(context))
+            .scale(Scale.FILL)
+            .memoryCacheKey("$imageUrl#thumbnail")
+            .allowHardware(true)
+            .build()
+
+    /**
+     * Thumbnail request for the bubble itself; records time from URL arrival to
+     * pixels and the decoded size of the bitmap
+     */
+    fun bubbleRequest(context: Context, imageUrl: String): ImageRequest =
+        thumbnailRequest(context, imageUrl).newBuilder()
+            .crossfade(true)
+            .listener(onSuccess = { _, result ->
+                arrivedAt.remove(imageUrl)?.let { start ->
+                    lastUrlToPixelsMs = SystemClock.elapsedRealtime() - start
+                }
+                (result.drawable as? BitmapDrawable)?.bitmap?.let { bitmap ->
+                    lastThumbnailBytes = bitmap.allocationByteCount.toLong()
+                }
+            })
+            .build()
+
+    /**
+     * Original-size decode for the full screen viewer, cached apart from thumbnails
+     */
+    fun fullSizeRequest(context: Context, imageUrl: String): ImageRequest =
+        ImageRequest.Builder(context)
+            .data(imageUrl)
+            .size(Size.ORIGINAL)
+            .memoryCacheKey("$imageUrl#full")
+            .crossfade(true)
+            .build()
+
+    /**
+     * Starts downloading and decoding the thumbnail before the bubble is composed
+     */
+    fun prefetch(context: Context, imageUrl: String) {
+        arrivedAt[imageUrl] = SystemClock.elapsedRealtime()
+        val disposable = context.imageLoader.enqueue(thumbnailRequest(context, imageUrl))
+        pending[imageUrl] = disposable
+        disposable.job.invokeOnCompletion { pending.remove(imageUrl, disposable) }
+    }
+
+    fun isPrefetching(imageUrl: String): Boolean = pending.containsKey(imageUrl)
+
+    /**
+     * Waits for a prefetch of this URL, so the bubble does not download it a second time
+     */
+    suspend fun awaitPrefetch(imageUrl: String) {
+        pending[imageUrl]?.job?.join()
+    }
+
+    /**
+     * Bytes currently held by the image memory cache
+     */
+    fun memoryCacheBytes(context: Context): Long =
+        context.imageLoader.memoryCache?.size?.toLong() ?: 0
+}
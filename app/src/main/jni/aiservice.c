@@ -4,179 +4,53 @@
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <openssl/crypto.h>
-#include <openssl/evp.h>
-#include <openssl/x509.h>
-#include <openssl/x509_vfy.h>
 #include <curl/curl.h>
+#include "cert_pin.h"
+#include "codec.h"
+#include "crypto_engine.h"
+#include "exif_reader.h"
+#include "fragment_tables.h"
+#include "http_engine.h"
+#include "json_stream.h"
+#include "net_runtime.h"
 
-typedef struct
-{
-    char *data;
-    size_t size;
-} ResponseData;
-
-typedef struct {
-    const char* hostname;
-    const char* expected_fingerprint;
-    int cert_verified;
-} CertVerifyInfo;
-
-static int ssl_verify_callback(int preverify_ok, X509_STORE_CTX* ctx) {
-    SSL* ssl = X509_STORE_CTX_get_ex_data(ctx, SSL_get_ex_data_X509_STORE_CTX_idx());
-    CertVerifyInfo* verify_info = SSL_get_ex_data(ssl, 0);
-    
-    if (!verify_info) {
-        return 0;
-    }
-
-    if (preverify_ok == 0) {
-        verify_info->cert_verified = 0;
-        return 0;
-    }
-
-    X509* cert = X509_STORE_CTX_get_current_cert(ctx);
-    if (!cert) {
-        verify_info->cert_verified = 0;
-        return 0;
-    }
+/* How often TLS tickets received since the last write are saved. */
+#define TLS_FLUSH_INTERVAL_MS 10000
 
-    int depth = X509_STORE_CTX_get_error_depth(ctx);
-    
-    if (depth == 1) {
-        unsigned char md[EVP_MAX_MD_SIZE];
-        unsigned int md_len;
-        
-        if (!X509_digest(cert, EVP_sha256(), md, &md_len)) {
-            verify_info->cert_verified = 0;
-            return 0;
-        }
-        
-        BIO *bmem = BIO_new(BIO_s_mem());
-        BIO *b64 = BIO_new(BIO_f_base64());
-        BIO_push(b64, bmem);
-        BIO_write(b64, md, md_len);
-        BIO_flush(b64);
-        
-        char fingerprint[100];
-        memset(fingerprint, 0, sizeof(fingerprint));
-        
-        BUF_MEM *bptr;
-        BIO_get_mem_ptr(b64, &bptr);
-        
-        if (bptr->length > 0 && bptr->length < sizeof(fingerprint)) {
-            memcpy(fingerprint, bptr->data, bptr->length - 1);
-        }
-        
-        BIO_free_all(b64);
-        
-        char full_fingerprint[150];
-        snprintf(full_fingerprint, sizeof(full_fingerprint), "sha256/%s", fingerprint);
-        
-        if (strcmp(full_fingerprint, verify_info->expected_fingerprint) != 0) {
-            verify_info->cert_verified = 0;
-            return 0;
-        }
-    }
-    
-    verify_info->cert_verified = 1;
-    return 1;
-}
-
-static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
-{
-    size_t realsize = size * nmemb;
-    ResponseData *resp = (ResponseData *)userp;
-
-    char *ptr = realloc(resp->data, resp->size + realsize + 1);
-    if (!ptr)
-    {
-        return 0;
-    }
-
-    resp->data = ptr;
-    memcpy(&(resp->data[resp->size]), contents, realsize);
-    resp->size += realsize;
-    resp->data[resp->size] = 0;
-
-    return realsize;
-}
+#define FOURTH_PART_AUTH "c238eb9410fd73a12ab1ec56e70d4bc53f87a6ddfbde50168c93e84271ae3fd01e25b7a18d3f50acb6a42f13f968d7bc7ed0c514be928da73bc48e01563d41ab"
 
-char *aes_decrypt(const char *ciphertext_base64, const char *key, const char *iv)
+static char *aes_decrypt(const char *ciphertext_base64, const char *key, const char *iv)
 {
-    BIO *b64, *bmem;
+    size_t ciphertext_base64_len = strlen(ciphertext_base64);
     unsigned char *ciphertext_bin;
-    size_t ciphertext_len_actual;
+    long ciphertext_len_actual;
 
-    b64 = BIO_new(BIO_f_base64());
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-
-    bmem = BIO_new_mem_buf(ciphertext_base64, strlen(ciphertext_base64));
-    bmem = BIO_push(b64, bmem);
-
-    ciphertext_bin = malloc(strlen(ciphertext_base64));
+    ciphertext_bin = malloc(codec_base64_decoded_max(ciphertext_base64_len));
     if (ciphertext_bin == NULL)
     {
-        BIO_free_all(bmem);
         return NULL;
     }
 
-    ciphertext_len_actual = BIO_read(bmem, ciphertext_bin, strlen(ciphertext_base64));
-    BIO_free_all(bmem);
-
+    ciphertext_len_actual = codec_base64_decode(ciphertext_base64, ciphertext_base64_len, ciphertext_bin);
     if (ciphertext_len_actual <= 0)
     {
         free(ciphertext_bin);
         return NULL;
     }
 
-    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-    if (!ctx)
-    {
-        free(ciphertext_bin);
-        return NULL;
-    }
-
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, (unsigned char *)key, (unsigned char *)iv))
-    {
-        EVP_CIPHER_CTX_free(ctx);
-        free(ciphertext_bin);
-        return NULL;
-    }
-
-    int plaintext_len;
-    int len;
-    unsigned char *plaintext = malloc(ciphertext_len_actual + EVP_CIPHER_block_size(EVP_aes_128_cbc()));
-    if (plaintext == NULL)
-    {
-        EVP_CIPHER_CTX_free(ctx);
-        free(ciphertext_bin);
-        return NULL;
-    }
-
-    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext_bin, ciphertext_len_actual))
+    size_t plaintext_cap = crypto_decrypt_bound((size_t)ciphertext_len_actual);
+    char *plaintext = malloc(plaintext_cap);
+    if (plaintext == NULL ||
+        crypto_decrypt(ciphertext_bin, (size_t)ciphertext_len_actual, (const unsigned char *)key,
+                       (const unsigned char *)iv, (unsigned char *)plaintext, plaintext_cap) < 0)
     {
         free(plaintext);
-        EVP_CIPHER_CTX_free(ctx);
         free(ciphertext_bin);
         return NULL;
     }
-    plaintext_len = len;
 
-    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + len, &len))
-    {
-        free(plaintext);
-        EVP_CIPHER_CTX_free(ctx);
-        free(ciphertext_bin);
-        return NULL;
-    }
-    plaintext_len += len;
-
-    plaintext[plaintext_len] = '\0';
-
-    EVP_CIPHER_CTX_free(ctx);
     free(ciphertext_bin);
-
-    return (char *)plaintext;
+    return plaintext;
 }
 
 JNIEXPORT jstring JNICALL
@@ -226,26 +100,25 @@ Java_com_example_playground_network_AIImageService_00024Companion_getRealBaseUrl
 
 char *getThirdApiKeyPart()
 {
-    const char *encrypted_apikey = "lmyL2liG91r65tQGgv9Hr5XdNtNtg1WnwmCSf2HlcO978fHbmB6MyXFqOiQrPXUlaUIkIrYOKsAaIUu7ytUAm/N9fcrFZdsnBSO0UZojdswwUdnmBDHdD18X3tbHOnAtAGX5FcTjlUYXGPO0PzcH9yeQGgdsrk68ElnvEbKOC4/iyV2sBFjqCz45KPUlv511";
-    const char *key1 = "1996090520020120";
-    const char *iv1 = "1996090520020120";
+    const unsigned char *key1 = (const unsigned char *)"1996090520020120";
+    const unsigned char *iv1 = (const unsigned char *)"1996090520020120";
 
-    char *apikey = aes_decrypt(encrypted_apikey, key1, iv1);
-    if (!apikey)
+    char apikey[CRYPTO_DECRYPT_BOUND(FT_ENCRYPTED_APIKEY_SIZE)];
+    if (crypto_decrypt(ft_encrypted_apikey, FT_ENCRYPTED_APIKEY_SIZE, key1, iv1,
+                       (unsigned char *)apikey, sizeof(apikey)) < 0)
     {
         return strdup("Error: Failed to decrypt apikey");
     }
 
     CURL *curl;
     CURLcode res;
-    ResponseData response;
-    response.data = malloc(1);
-    response.size = 0;
+    JsonStream response;
+    json_stream_init(&response);
+    JsonField *signature = json_stream_want(&response, "signature");
+    response.abort_when_done = net_runtime_http2_supported();
 
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    curl = curl_easy_init();
+    curl = net_runtime_acquire();
 
-    char *signature = NULL;
     char *final_key = NULL;
     char *result = NULL;
 
@@ -264,57 +137,39 @@ char *getThirdApiKeyPart()
 
         curl_easy_setopt(curl, CURLOPT_POST, 1L);
 
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, json_stream_write_callback);
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
 
-        res = curl_easy_perform(curl);
+        res = http_engine_perform(curl);
 
-        if (res == CURLE_OK)
+        /* On HTTP/2 the write callback ends the transfer once the signature
+         * is complete, which libcurl reports as a write error. HTTP/1.1
+         * reads the rest of the body unparsed so the connection stays
+         * reusable. */
+        if ((res == CURLE_OK || res == CURLE_WRITE_ERROR) && signature->complete && !signature->truncated)
         {
-            char *sig_start = strstr(response.data, "\"signature\":");
-            if (sig_start)
+            if (signature->length >= 26)
             {
-                sig_start += 13;
-                char *sig_end = strchr(sig_start, '"');
-                if (sig_end)
+                unsigned char key2[CRYPTO_AES_KEY_SIZE];
+                memcpy(key2, signature->value + 9, sizeof(key2));
+
+                const unsigned char *iv2 = (const unsigned char *)"2002012019960905";
+
+                char third_apikey_part[CRYPTO_DECRYPT_BOUND(FT_ENCRYPTED_FINAL_SIZE)];
+                if (crypto_decrypt(ft_encrypted_final, FT_ENCRYPTED_FINAL_SIZE, key2, iv2,
+                                   (unsigned char *)third_apikey_part, sizeof(third_apikey_part)) >= 0)
                 {
-                    size_t sig_len = sig_end - sig_start;
-                    signature = malloc(sig_len + 1);
-                    strncpy(signature, sig_start, sig_len);
-                    signature[sig_len] = '\0';
-
-                    if (strlen(signature) >= 26)
-                    {
-                        char *key2 = malloc(17);
-                        strncpy(key2, signature + 9, 16);
-                        key2[16] = '\0';
-
-                        const char *encrypted_final = "dryW3TrqEM3zh5s2gTmOs+sONGlizqEvuYlLIZW6SaL7CdHEUG/Sh80yDbm3Cit0";
-                        const char *iv2 = "2002012019960905";
-
-                        char *third_apikey_part = aes_decrypt(encrypted_final, key2, iv2);
-                        if (third_apikey_part)
-                        {
-                            result = strdup(third_apikey_part);
-                            free(third_apikey_part);
-                        }
-
-                        free(key2);
-                    }
+                    result = strdup(third_apikey_part);
+                    OPENSSL_cleanse(third_apikey_part, sizeof(third_apikey_part));
                 }
             }
         }
 
         curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+        net_runtime_release(curl);
     }
 
-    curl_global_cleanup();
-
-    free(apikey);
-    if (signature)
-        free(signature);
-    free(response.data);
+    OPENSSL_cleanse(apikey, sizeof(apikey));
 
     if (!result)
     {
@@ -324,6 +179,119 @@ char *getThirdApiKeyPart()
     return result;
 }
 
+static char *fetch_image_path(CURL *curl)
+{
+    JsonStream response;
+    json_stream_init(&response);
+    JsonField *path = json_stream_want(&response, NULL);
+
+    struct curl_slist *headers = NULL;
+    headers = curl_slist_append(headers, "Authorization: " FOURTH_PART_AUTH);
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+
+    curl_easy_setopt(curl, CURLOPT_URL, "https://ai.elliotwen.info/generate_image");
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, "");
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, json_stream_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
+
+    CURLcode res = http_engine_perform(curl);
+    curl_slist_free_all(headers);
+
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    json_stream_finish(&response);
+
+    if (res != CURLE_OK || status < 200 || status >= 300 || !path->complete || path->truncated || path->length == 0)
+    {
+        return NULL;
+    }
+
+    char *url = malloc(path->length + 32);
+    if (!url)
+    {
+        return NULL;
+    }
+
+    if (strncmp(path->value, "http", 4) == 0)
+        strcpy(url, path->value);
+    else
+        sprintf(url, "https://ai.elliotwen.info%s", path->value);
+
+    return url;
+}
+
+/* There is no CA bundle for OpenSSL on the device: pinned hosts are checked
+ * by the registered pin alone, any other image host against the system
+ * roots. */
+static int configure_image_trust(CURL *curl, const char *image_url)
+{
+    CURLU *url = curl_url();
+    char *host = NULL;
+    int pinned = url && curl_url_set(url, CURLUPART_URL, image_url, 0) == CURLUE_OK &&
+                 curl_url_get(url, CURLUPART_HOST, &host, 0) == CURLUE_OK && cert_pin_registered(host);
+    curl_free(host);
+    curl_url_cleanup(url);
+
+    if (pinned)
+    {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+        return 1;
+    }
+    return net_runtime_trust_system_roots(curl);
+}
+
+/*
+ * Fourth key fragment, read from the UserComment of a freshly generated
+ * image. Only the head of the JPEG is requested; returns NULL so the caller
+ * can fall back to the Java ExifInterface path.
+ */
+char *getFourthApiKeyPart()
+{
+    CURL *curl = net_runtime_acquire();
+    if (!curl)
+    {
+        return NULL;
+    }
+
+    char *result = NULL;
+    char *image_url = fetch_image_path(curl);
+    ExifReader *reader = image_url ? malloc(sizeof(ExifReader)) : NULL;
+
+    if (reader)
+    {
+        exif_reader_init(reader);
+        reader->abort_when_done = net_runtime_http2_supported();
+
+        char range[32];
+        snprintf(range, sizeof(range), "0-%d", EXIF_READ_LIMIT - 1);
+
+        net_runtime_reset(curl);
+        curl_easy_setopt(curl, CURLOPT_URL, image_url);
+        curl_easy_setopt(curl, CURLOPT_RANGE, range);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, exif_reader_write_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)reader);
+
+        CURLcode res = configure_image_trust(curl, image_url) ? http_engine_perform(curl) : CURLE_SSL_CACERT_BADFILE;
+        if ((res == CURLE_OK || res == CURLE_WRITE_ERROR) && reader->status == EXIF_FOUND)
+        {
+            unsigned char iv[17];
+            memset(iv, '0', 16);
+            iv[16] = '\0';
+            result = aes_decrypt(reader->comment, "2002012020020120", (const char *)iv);
+        }
+
+        free(reader);
+    }
+
+    free(image_url);
+    net_runtime_release(curl);
+    return result;
+}
+
 JNIEXPORT jstring JNICALL
 Java_com_example_playground_network_AIImageService_00024Companion_getThirdApiKeyPart(
     JNIEnv *env,
@@ -335,7 +303,7 @@ Java_com_example_playground_network_AIImageService_00024Companion_getThirdApiKey
     return result;
 }
 
-JNIEXPORT jboolean JNICALL
+JNIEXPORT jint JNICALL
 Java_com_example_playground_network_AIImageService_00024Companion_verifyCertificate(
     JNIEnv *env,
     jobject thiz,
@@ -344,62 +312,111 @@ Java_com_example_playground_network_AIImageService_00024Companion_verifyCertific
 {
     const char *hostname = (*env)->GetStringUTFChars(env, hostname_jstr, NULL);
     const char *expected_fingerprint = (*env)->GetStringUTFChars(env, expected_fingerprint_jstr, NULL);
-    
-    CURL *curl;
-    CURLcode res;
-    int certificate_problem = 1;
-    
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    curl = curl_easy_init();
-    
-    if (curl) {
-        char url[256];
-        snprintf(url, sizeof(url), "https://%s", hostname);
-        curl_easy_setopt(curl, CURLOPT_URL, url);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-        
-        ResponseData response;
-        response.data = malloc(1);
-        response.size = 0;
-        
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
-        
-        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
-        
-        res = curl_easy_perform(curl);
-        
-        if (res == CURLE_OK) {
-            long http_code = 0;
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-            
-            struct curl_slist *slist;
-            res = curl_easy_getinfo(curl, CURLINFO_CERTINFO, &slist);
-            
-            if (res == CURLE_OK && slist) {
-                certificate_problem = 0;
-            }
-            
-            free(response.data);
-        }
-        
-        curl_easy_cleanup(curl);
+
+    CertPinVerdict verdict = CERT_PIN_ERROR;
+    if (hostname && expected_fingerprint)
+    {
+        verdict = cert_pin_probe(hostname, expected_fingerprint, NULL);
+    }
+
+    if (hostname)
+    {
+        (*env)->ReleaseStringUTFChars(env, hostname_jstr, hostname);
+    }
+    if (expected_fingerprint)
+    {
+        (*env)->ReleaseStringUTFChars(env, expected_fingerprint_jstr, expected_fingerprint);
     }
-    
-    curl_global_cleanup();
-    (*env)->ReleaseStringUTFChars(env, hostname_jstr, hostname);
-    (*env)->ReleaseStringUTFChars(env, expected_fingerprint_jstr, expected_fingerprint);
-    
-    return certificate_problem ? JNI_TRUE : JNI_FALSE;
+
+    return (jint)verdict;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_playground_network_AIImageService_00024Companion_configureCertificatePin(
+    JNIEnv *env,
+    jobject thiz,
+    jstring hostname_jstr,
+    jstring pin_jstr)
+{
+    const char *hostname = (*env)->GetStringUTFChars(env, hostname_jstr, NULL);
+    const char *pin = (*env)->GetStringUTFChars(env, pin_jstr, NULL);
+
+    int registered = hostname && pin && cert_pin_register(hostname, pin);
+
+    if (hostname)
+    {
+        (*env)->ReleaseStringUTFChars(env, hostname_jstr, hostname);
+    }
+    if (pin)
+    {
+        (*env)->ReleaseStringUTFChars(env, pin_jstr, pin);
+    }
+
+    return registered ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_example_playground_network_AIImageService_00024Companion_getNetworkStats(
+    JNIEnv *env,
+    jobject thiz)
+{
+    NetRuntimeStats stats;
+    net_runtime_get_stats(&stats);
+
+    jlong values[8] = {
+        stats.requests, stats.connections, stats.http2_requests, stats.http2_supported,
+        stats.tls_resumed, stats.tls_full, stats.tls_handshake_us, stats.first_request_us};
+
+    jlongArray result = (*env)->NewLongArray(env, 8);
+    if (result != NULL)
+    {
+        (*env)->SetLongArrayRegion(env, result, 0, 8, values);
+    }
+
+    return result;
+}
+
+static void flush_tls_sessions(void *user)
+{
+    (void)user;
+    net_runtime_flush_cache();
+    http_engine_schedule(TLS_FLUSH_INTERVAL_MS, flush_tls_sessions, NULL);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_playground_network_AIImageService_00024Companion_configureNativeCache(
+    JNIEnv *env,
+    jobject thiz,
+    jstring cacheDir)
+{
+    const char *dir = (*env)->GetStringUTFChars(env, cacheDir, NULL);
+    if (dir == NULL)
+    {
+        return;
+    }
+
+    static int flush_scheduled = 0;
+
+    net_runtime_init();
+    net_runtime_configure_cache(dir);
+    if (!__atomic_exchange_n(&flush_scheduled, 1, __ATOMIC_RELAXED))
+    {
+        http_engine_schedule(TLS_FLUSH_INTERVAL_MS, flush_tls_sessions, NULL);
+    }
+
+    (*env)->ReleaseStringUTFChars(env, cacheDir, dir);
 }
 
 JNIEXPORT jint JNICALL
 JNI_OnLoad(JavaVM *vm, void *reserved)
 {
     SSL_library_init();
+    net_runtime_init();
     return JNI_VERSION_1_6;
+}
+
+JNIEXPORT void JNICALL
+JNI_OnUnload(JavaVM *vm, void *reserved)
+{
+    net_runtime_flush_cache();
 }
\ No newline at end of file
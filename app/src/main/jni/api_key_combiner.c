@@ -2,514 +2,1007 @@
 #include <string.h>
 #include <stdlib.h>
 #include <curl/curl.h>
-#include <dirent.h>
-#include <unistd.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-
-static char *cached_third_part = NULL;
-static char *cached_fourth_part = NULL;
-
-extern char *decrypt_second_fragment();
+#include <openssl/crypto.h>
+#include <pthread.h>
+#include <time.h>
+#include "net_runtime.h"
+#include "fragment_cache.h"
+#include "fragment_store.h"
+#include "fragment_vault.h"
+#include "http_engine.h"
+#include "integrity_monitor.h"
+#include "json_stream.h"
+#include "signature_manager.h"
+
+static FragmentSlot third_slot = FRAGMENT_SLOT_INITIALIZER;
+static FragmentSlot fourth_slot = FRAGMENT_SLOT_INITIALIZER;
+
+/* How fetched fourth fragments were obtained: from the native EXIF read, or
+ * through the Java ExifInterface fallback after it failed. */
+static long fourth_native_reads = 0;
+static long fourth_java_fallbacks = 0;
+
+static JavaVM *cached_vm = NULL;
+static jclass combinerClass = NULL;
+static jmethodID onCompleteMethod = NULL;
+
+/* Resolved while the app class loader is reachable, so cold assembly can
+ * run on a native worker thread. */
+static jclass keyStoreClass = NULL;
+static jclass retrieverClass = NULL;
+static jclass activityThreadClass = NULL;
+
+extern int decrypt_leading_fragments(JNIEnv *env, jclass keyStoreClass, char **first, char **second);
 extern char *decrypt_fifth_fragment();
 extern char *getThirdApiKeyPart();
+extern char *getFourthApiKeyPart();
 
-int detect_frida() 
-{
-    int frida_detected = 0;
-    
-    DIR* dir = opendir("/proc/self/maps");
-    if (dir) {
-        struct dirent* entry;
-        while ((entry = readdir(dir)) != NULL) {
-            char path[256];
-            snprintf(path, sizeof(path), "/proc/self/maps/%s", entry->d_name);
-            FILE* fp = fopen(path, "r");
-            if (fp) {
-                char line[512];
-                while (fgets(line, sizeof(line), fp)) {
-                    if (strstr(line, "frida") || strstr(line, "gum-js-loop")) {
-                        frida_detected = 1;
-                        break;
-                    }
-                }
-                fclose(fp);
-            }
-            if (frida_detected) break;
-        }
-        closedir(dir);
-    }
-    
-    if (!frida_detected) {
-        struct sockaddr_in sa;
-        int sock = socket(AF_INET, SOCK_STREAM, 0);
-        if (sock != -1) {
-            memset(&sa, 0, sizeof(sa));
-            sa.sin_family = AF_INET;
-            sa.sin_port = htons(27042);
-            inet_aton("127.0.0.1", &sa.sin_addr);
-            
-            if (connect(sock, (struct sockaddr*)&sa, sizeof(sa)) != -1) {
-                frida_detected = 1;
-            }
-            close(sock);
-        }
-    }
-    
-    const char* frida_libs[] = {
-        "frida-agent.so", 
-        "libfrida-gadget.so",
-        "libfrida-agent.so"
-    };
-    
-    if (!frida_detected) {
-        FILE* fp = fopen("/proc/self/maps", "r");
-        if (fp) {
-            char line[512];
-            while (fgets(line, sizeof(line), fp)) {
-                for (int i = 0; i < sizeof(frida_libs)/sizeof(frida_libs[0]); i++) {
-                    if (strstr(line, frida_libs[i])) {
-                        frida_detected = 1;
-                        break;
-                    }
-                }
-                if (frida_detected) break;
-            }
-            fclose(fp);
-        }
+/* The server rejected the combined key, so at least one cached fragment is
+ * wrong; forget both so the next assembly fetches them again. */
+static void forget_network_fragments(void)
+{
+    fragment_store_invalidate();
+    fragment_cache_invalidate(&third_slot);
+    fragment_cache_invalidate(&fourth_slot);
+}
+
+static jclass global_class(JNIEnv *env, const char *name)
+{
+    jclass localClass = (*env)->FindClass(env, name);
+    if (localClass == NULL)
+    {
+        (*env)->ExceptionClear(env);
+        return NULL;
     }
-    
-    if (frida_detected) {
-        return 1;
+
+    jclass globalClass = (jclass)(*env)->NewGlobalRef(env, localClass);
+    (*env)->DeleteLocalRef(env, localClass);
+    return globalClass;
+}
+
+static void drop_global_class(JNIEnv *env, jclass *cls)
+{
+    if (*cls != NULL)
+    {
+        (*env)->DeleteGlobalRef(env, *cls);
+        *cls = NULL;
     }
-    
-    return 0;
 }
 
 JNIEXPORT jint JNICALL
 JNI_OnLoad(JavaVM *vm, void *reserved)
 {
+    JNIEnv *env = NULL;
+    if ((*vm)->GetEnv(vm, (void **)&env, JNI_VERSION_1_6) != JNI_OK)
+    {
+        return JNI_ERR;
+    }
+
+    cached_vm = vm;
+
+    combinerClass = global_class(env, "com/example/playground/network/ApiKeyCombiner");
+    if (combinerClass != NULL)
+    {
+        onCompleteMethod = (*env)->GetStaticMethodID(env, combinerClass, "onNativeComplete", "(JLjava/lang/String;)V");
+    }
+    keyStoreClass = global_class(env, "com/example/playground/network/NativeKeyStore");
+    retrieverClass = global_class(env, "com/example/playground/network/ApiKeyRetriever");
+    activityThreadClass = global_class(env, "android/app/ActivityThread");
+    if ((*env)->ExceptionCheck(env))
+    {
+        (*env)->ExceptionClear(env);
+    }
+
+    net_runtime_init();
+    http_engine_start();
+    signature_manager_set_reject_hook(forget_network_fragments);
+    integrity_monitor_start();
     return JNI_VERSION_1_6;
 }
 
 JNIEXPORT void JNICALL
 JNI_OnUnload(JavaVM *vm, void *reserved)
 {
-    if (cached_third_part != NULL)
+    JNIEnv *env = NULL;
+    if ((*vm)->GetEnv(vm, (void **)&env, JNI_VERSION_1_6) == JNI_OK)
+    {
+        drop_global_class(env, &combinerClass);
+        drop_global_class(env, &keyStoreClass);
+        drop_global_class(env, &retrieverClass);
+        drop_global_class(env, &activityThreadClass);
+        onCompleteMethod = NULL;
+    }
+
+    integrity_monitor_stop();
+    fragment_cache_clear(&third_slot);
+    fragment_cache_clear(&fourth_slot);
+    fragment_vault_wipe();
+}
+
+char *build_full_url(const char *base_url, const char *path)
+{
+    if (!path)
+        return NULL;
+
+    if (strstr(path, "http://") == path || strstr(path, "https://") == path)
     {
-        free(cached_third_part);
-        cached_third_part = NULL;
+        return strdup(path);
     }
 
-    if (cached_fourth_part != NULL)
+    size_t base_len = strlen(base_url);
+    size_t path_len = strlen(path);
+    int base_slash = base_len > 0 && base_url[base_len - 1] == '/';
+    int path_slash = path[0] == '/';
+
+    char *full_url = (char *)malloc(base_len + path_len + 2);
+    if (!full_url)
+        return NULL;
+
+    strcpy(full_url, base_url);
+    if (!base_slash && !path_slash)
     {
-        free(cached_fourth_part);
-        cached_fourth_part = NULL;
+        strcat(full_url, "/");
     }
+    strcat(full_url, base_slash && path_slash ? path + 1 : path);
+
+    return full_url;
 }
 
-typedef struct
+enum
+{
+    FRAGMENT_FIRST,
+    FRAGMENT_SECOND,
+    FRAGMENT_THIRD,
+    FRAGMENT_FOURTH,
+    FRAGMENT_FIFTH,
+    FRAGMENT_TOTAL,
+    FRAGMENT_TIMING_COUNT
+};
+
+static long fragment_timings_us[FRAGMENT_TIMING_COUNT];
+
+static long now_us(void)
 {
-    char *memory;
-    size_t size;
-} MemoryStruct;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
 
-static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp)
+static void record_timing(int fragment, long elapsed_us)
+{
+    __atomic_store_n(&fragment_timings_us[fragment], elapsed_us, __ATOMIC_RELAXED);
+}
+
+typedef struct
 {
-    size_t realsize = size * nmemb;
-    MemoryStruct *mem = (MemoryStruct *)userp;
+    FragmentSlot *slot;
+    int store_id;
+    char *(*fetch)(void);
+    int defer_failure;
+    int leading;
+    /* The upstream fetch itself produced the value. */
+    int fetched;
+    long elapsed_us;
+    pthread_t thread;
+    int started;
+} FragmentFetch;
+
+static void *run_fragment_fetch(void *arg)
+{
+    FragmentFetch *fetch = (FragmentFetch *)arg;
+    long start = now_us();
 
-    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
-    if (ptr == NULL)
+    if (fragment_cache_begin(fetch->slot))
     {
-        return 0;
+        /* A sealed copy from a previous run skips the network entirely. */
+        char *value = fragment_store_load(fetch->store_id);
+        if (value == NULL)
+        {
+            value = fetch->fetch();
+            fetch->fetched = value != NULL && value[0] != '\0';
+            fragment_store_save(fetch->store_id, value);
+        }
+
+        if (fetch->defer_failure && (value == NULL || value[0] == '\0'))
+        {
+            /* The caller still owns the slot and publishes after its fallback. */
+            free(value);
+            fetch->leading = 1;
+        }
+        else
+        {
+            fragment_cache_publish(fetch->slot, value);
+        }
     }
 
-    mem->memory = ptr;
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->memory[mem->size] = 0;
+    fetch->elapsed_us = now_us() - start;
+    return NULL;
+}
 
-    return realsize;
+static void start_fragment_fetch(FragmentFetch *fetch, FragmentSlot *slot, int store_id, char *(*fn)(void), int defer_failure)
+{
+    fetch->slot = slot;
+    fetch->store_id = store_id;
+    fetch->fetch = fn;
+    fetch->defer_failure = defer_failure;
+    fetch->started = pthread_create(&fetch->thread, NULL, run_fragment_fetch, fetch) == 0;
+    if (!fetch->started)
+    {
+        run_fragment_fetch(fetch);
+    }
 }
 
-char *extract_signature(const char *json_response)
+static void join_fragment_fetch(FragmentFetch *fetch)
 {
-    if (!json_response)
-        return NULL;
+    if (fetch->started)
+    {
+        pthread_join(fetch->thread, NULL);
+        fetch->started = 0;
+    }
+}
 
-    char *sig_start = strstr(json_response, "\"signature\":");
-    if (!sig_start)
-        return NULL;
+static void discard_fragment(char *fragment)
+{
+    if (fragment)
+    {
+        OPENSSL_cleanse(fragment, strlen(fragment));
+        free(fragment);
+    }
+}
 
-    sig_start += 12;
-    while (*sig_start == ' ' || *sig_start == '\"')
-        sig_start++;
+/*
+ * Fragments one, two and five never change, so they are decrypted once into
+ * the vault. Warm calls skip the JNI lookups, decoding and decryption.
+ */
+static int resolve_static_fragments(JNIEnv *env, const char **error)
+{
+    if (fragment_vault_ready())
+    {
+        record_timing(FRAGMENT_FIRST, 0);
+        record_timing(FRAGMENT_SECOND, 0);
+        record_timing(FRAGMENT_FIFTH, 0);
+        return 1;
+    }
 
-    char *sig_end = strchr(sig_start, '\"');
-    if (!sig_end)
-        return NULL;
+    fragment_vault_lock();
 
-    int sig_len = sig_end - sig_start;
-    char *signature = (char *)malloc(sig_len + 1);
-    if (!signature)
-        return NULL;
+    if (!fragment_vault_ready())
+    {
+        /* The first two fragments are one batch; its time is reported under
+         * the first fragment. */
+        char *firstPart = NULL;
+        char *secondPart = NULL;
+        long start = now_us();
+        decrypt_leading_fragments(env, keyStoreClass, &firstPart, &secondPart);
+        record_timing(FRAGMENT_FIRST, now_us() - start);
+        record_timing(FRAGMENT_SECOND, 0);
+
+        start = now_us();
+        char *fifthPart = decrypt_fifth_fragment();
+        record_timing(FRAGMENT_FIFTH, now_us() - start);
+
+        if (firstPart == NULL)
+        {
+            *error = "Error: Failed to get first part of API key";
+        }
+        else if (secondPart == NULL)
+        {
+            *error = "Error: Failed to get second part of API key";
+        }
+        else if (fifthPart == NULL)
+        {
+            *error = "Error: Failed to get fifth part of API key";
+        }
+        else if (!fragment_vault_store(VAULT_FIRST, firstPart) ||
+                 !fragment_vault_store(VAULT_SECOND, secondPart) ||
+                 !fragment_vault_store(VAULT_FIFTH, fifthPart) ||
+                 !fragment_vault_seal())
+        {
+            fragment_vault_discard();
+            *error = "Error: Memory allocation failed";
+        }
 
-    strncpy(signature, sig_start, sig_len);
-    signature[sig_len] = '\0';
+        discard_fragment(firstPart);
+        discard_fragment(secondPart);
+        discard_fragment(fifthPart);
+    }
 
-    return signature;
+    fragment_vault_unlock();
+    return fragment_vault_ready();
 }
 
-char *trim_quotes(const char *input)
+static char *retrieve_fourth_fragment_java(JNIEnv *env)
 {
-    if (!input)
+    if (activityThreadClass == NULL || retrieverClass == NULL)
+    {
         return NULL;
+    }
 
-    size_t len = strlen(input);
-    if (len < 2)
-        return strdup(input);
+    jmethodID currentActivityThreadMethod = (*env)->GetStaticMethodID(env, activityThreadClass, "currentActivityThread", "()Landroid/app/ActivityThread;");
+    jobject activityThread = (*env)->CallStaticObjectMethod(env, activityThreadClass, currentActivityThreadMethod);
 
-    if (input[0] == '\"' && input[len - 1] == '\"')
-    {
-        char *result = (char *)malloc(len - 1);
-        if (!result)
-            return NULL;
+    jmethodID getApplicationMethod = (*env)->GetMethodID(env, activityThreadClass, "getApplication", "()Landroid/app/Application;");
+    jobject application = (*env)->CallObjectMethod(env, activityThread, getApplicationMethod);
+
+    jmethodID retrieverConstructor = (*env)->GetMethodID(env, retrieverClass, "<init>", "(Landroid/content/Context;)V");
+    jobject retrieverObj = (*env)->NewObject(env, retrieverClass, retrieverConstructor, application);
+
+    jmethodID retrieveMethod = (*env)->GetMethodID(env, retrieverClass, "retrieveApiKeyNative", "()Ljava/lang/String;");
+    jstring fourthPartJString = (jstring)(*env)->CallObjectMethod(env, retrieverObj, retrieveMethod);
 
-        strncpy(result, input + 1, len - 2);
-        result[len - 2] = '\0';
-        return result;
+    /* On a worker thread nothing else would clear it before the completion
+     * callback calls back into Kotlin. */
+    if ((*env)->ExceptionCheck(env))
+    {
+        (*env)->ExceptionClear(env);
+        return NULL;
+    }
+    if (fourthPartJString == NULL)
+    {
+        return NULL;
     }
 
-    return strdup(input);
+    const char *fourthPart = (*env)->GetStringUTFChars(env, fourthPartJString, NULL);
+    char *result = fourthPart ? strdup(fourthPart) : NULL;
+    if (fourthPart)
+    {
+        (*env)->ReleaseStringUTFChars(env, fourthPartJString, fourthPart);
+    }
+    return result;
 }
 
-char *build_full_url(const char *base_url, const char *path)
+/*
+ * Fragments three and four are independent network fetches, so both are put
+ * in flight on worker threads (sharing the engine's multi handle) while the
+ * CPU-only fragments are decrypted here. Cold latency becomes roughly the
+ * slower of the two fetches rather than their sum.
+ */
+static char *assemble_combined_key(JNIEnv *env, const char **error)
 {
-    if (!path)
-        return NULL;
+    long total_start = now_us();
 
-    size_t path_len = strlen(path);
-    char *clean_path = (char *)malloc(path_len + 1);
-    if (!clean_path)
+    /* The monitor thread owns all scanning; this is normally one atomic load. */
+    if (integrity_monitor_await() == INTEGRITY_COMPROMISED)
+    {
+        *error = "Error: Security violation detected";
         return NULL;
+    }
 
-    size_t clean_index = 0;
-    for (size_t i = 0; i < path_len; i++)
+    FragmentFetch thirdFetch = {0};
+    FragmentFetch fourthFetch = {0};
+    if (fragment_cache_peek(&third_slot) == NULL)
     {
-        if (path[i] != '\"')
-        {
-            clean_path[clean_index++] = path[i];
-        }
+        start_fragment_fetch(&thirdFetch, &third_slot, FRAGMENT_STORE_THIRD, getThirdApiKeyPart, 0);
     }
-    clean_path[clean_index] = '\0';
+    if (fragment_cache_peek(&fourth_slot) == NULL)
+    {
+        start_fragment_fetch(&fourthFetch, &fourth_slot, FRAGMENT_STORE_FOURTH, getFourthApiKeyPart, 1);
+    }
+
+    const char *staticError = NULL;
+    int staticReady = resolve_static_fragments(env, &staticError);
+    long start;
 
-    if (strstr(clean_path, "http://") == clean_path || strstr(clean_path, "https://") == clean_path)
+    join_fragment_fetch(&thirdFetch);
+    record_timing(FRAGMENT_THIRD, thirdFetch.elapsed_us);
+
+    join_fragment_fetch(&fourthFetch);
+    long fourthElapsed = fourthFetch.elapsed_us;
+    if (fourthFetch.fetched)
     {
-        return clean_path;
+        __atomic_add_fetch(&fourth_native_reads, 1, __ATOMIC_RELAXED);
+    }
+    if (fourthFetch.leading)
+    {
+        __atomic_add_fetch(&fourth_java_fallbacks, 1, __ATOMIC_RELAXED);
+        /* The Java fallback needs this thread's JNIEnv; skip it if a JNI
+         * call above already failed and may have left an exception pending. */
+        start = now_us();
+        char *javaFourth = staticReady ? retrieve_fourth_fragment_java(env) : NULL;
+        fragment_store_save(FRAGMENT_STORE_FOURTH, javaFourth);
+        fragment_cache_publish(&fourth_slot, javaFourth);
+        fourthElapsed += now_us() - start;
+    }
+    record_timing(FRAGMENT_FOURTH, fourthElapsed);
+
+    const char *thirdPart = fragment_cache_peek(&third_slot);
+    const char *fourthPart = fragment_cache_peek(&fourth_slot);
+    if (fourthPart == NULL)
+    {
+        fourthPart = "";
     }
 
-    size_t base_len = strlen(base_url);
-    size_t need_slash = (clean_path[0] != '/' && base_url[base_len - 1] != '/') ? 1 : 0;
+    char *combinedKey = NULL;
 
-    char *full_url = (char *)malloc(base_len + clean_index + need_slash + 1);
-    if (!full_url)
+    if (!staticReady)
     {
-        free(clean_path);
-        return NULL;
+        *error = staticError ? staticError : "Error: Failed to get first part of API key";
     }
+    else if (thirdPart == NULL)
+    {
+        *error = "Error: Failed to get third part of API key";
+    }
+    else
+    {
+        const char *firstPart = fragment_vault_get(VAULT_FIRST);
+        const char *secondPart = fragment_vault_get(VAULT_SECOND);
+        const char *fifthPart = fragment_vault_get(VAULT_FIFTH);
 
-    strcpy(full_url, base_url);
+        size_t totalLength = strlen(firstPart) + strlen(secondPart) + strlen(thirdPart) +
+                             strlen(fourthPart) + strlen(fifthPart) + 1;
 
-    if (need_slash)
+        combinedKey = (char *)malloc(totalLength);
+        if (combinedKey != NULL)
+        {
+            strcpy(combinedKey, firstPart);
+            strcat(combinedKey, secondPart);
+            strcat(combinedKey, thirdPart);
+            strcat(combinedKey, fourthPart);
+            strcat(combinedKey, fifthPart);
+        }
+        else
+        {
+            *error = "Error: Memory allocation failed";
+        }
+    }
+
+    record_timing(FRAGMENT_TOTAL, now_us() - total_start);
+    return combinedKey;
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_00024Companion_configureFragmentCache(
+    JNIEnv *env,
+    jobject thiz,
+    jstring cacheDir,
+    jbyteArray key)
+{
+    if (cacheDir == NULL || key == NULL || (*env)->GetArrayLength(env, key) != FRAGMENT_STORE_KEY_SIZE)
     {
-        strcat(full_url, "/");
+        return;
     }
-    else if (clean_path[0] == '/' && base_url[base_len - 1] == '/')
+
+    const char *dir = (*env)->GetStringUTFChars(env, cacheDir, NULL);
+    if (dir == NULL)
     {
-        strcat(full_url, clean_path + 1);
-        free(clean_path);
-        return full_url;
+        return;
     }
 
-    strcat(full_url, clean_path);
-    free(clean_path);
+    jbyte keyBytes[FRAGMENT_STORE_KEY_SIZE];
+    (*env)->GetByteArrayRegion(env, key, 0, FRAGMENT_STORE_KEY_SIZE, keyBytes);
+    fragment_store_configure(dir, (const unsigned char *)keyBytes, FRAGMENT_STORE_KEY_SIZE);
+    memset(keyBytes, 0, sizeof(keyBytes));
 
-    return full_url;
+    (*env)->ReleaseStringUTFChars(env, cacheDir, dir);
 }
 
-JNIEXPORT jstring JNICALL
-Java_com_example_playground_network_ApiKeyCombiner_combineApiKey(JNIEnv *env, jobject thiz, jstring promptJString)
+JNIEXPORT jlongArray JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_getSignatureStats(JNIEnv *env, jobject thiz)
 {
-    const char *prompt = NULL;
-    if (promptJString != NULL)
+    long stats[3];
+    signature_manager_stats(stats);
+    jlong values[3] = {stats[0], stats[1], stats[2]};
+
+    jlongArray result = (*env)->NewLongArray(env, 3);
+    if (result != NULL)
     {
-        prompt = (*env)->GetStringUTFChars(env, promptJString, NULL);
+        (*env)->SetLongArrayRegion(env, result, 0, 3, values);
     }
-    else
+    return result;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_getIntegrityStats(JNIEnv *env, jobject thiz)
+{
+    long stats[4];
+    integrity_monitor_stats(stats);
+    jlong values[4] = {stats[0], stats[1], stats[2], stats[3]};
+
+    jlongArray result = (*env)->NewLongArray(env, 4);
+    if (result != NULL)
     {
-        return (*env)->NewStringUTF(env, "Error: No prompt provided");
+        (*env)->SetLongArrayRegion(env, result, 0, 4, values);
     }
-    
-    if (detect_frida()) {
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Security violation detected");
+    return result;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_getFragmentFetchCounts(JNIEnv *env, jobject thiz)
+{
+    jlong values[4] = {
+        fragment_cache_fetches(&third_slot), fragment_cache_fetches(&fourth_slot),
+        __atomic_load_n(&fourth_native_reads, __ATOMIC_RELAXED),
+        __atomic_load_n(&fourth_java_fallbacks, __ATOMIC_RELAXED)};
+
+    jlongArray result = (*env)->NewLongArray(env, 4);
+    if (result != NULL)
+    {
+        (*env)->SetLongArrayRegion(env, result, 0, 4, values);
     }
+    return result;
+}
 
-    jclass decryptorClass = (*env)->FindClass(env, "com/example/playground/network/NativeDecryptor");
-    if (decryptorClass == NULL)
+JNIEXPORT jlongArray JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_getFragmentTimings(JNIEnv *env, jobject thiz)
+{
+    jlong values[FRAGMENT_TIMING_COUNT];
+    for (int i = 0; i < FRAGMENT_TIMING_COUNT; i++)
     {
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to find NativeDecryptor class");
+        values[i] = __atomic_load_n(&fragment_timings_us[i], __ATOMIC_RELAXED);
     }
 
-    jmethodID constructor = (*env)->GetMethodID(env, decryptorClass, "<init>", "()V");
-    if (constructor == NULL)
+    jlongArray result = (*env)->NewLongArray(env, FRAGMENT_TIMING_COUNT);
+    if (result != NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to get NativeDecryptor constructor");
+        (*env)->SetLongArrayRegion(env, result, 0, FRAGMENT_TIMING_COUNT, values);
     }
+    return result;
+}
+
+typedef void (*generation_done_fn)(char *result, void *user);
 
-    jobject decryptorObj = (*env)->NewObject(env, decryptorClass, constructor);
-    if (decryptorObj == NULL)
+typedef struct
+{
+    char auth_header[1024];
+    char request_body[2048];
+    char signature[JSON_STREAM_VALUE_MAX];
+    char *api_key;
+    char *prompt;
+    int retried;
+    struct curl_slist *headers;
+    JsonStream response;
+    generation_done_fn on_done;
+    void *user;
+} GenerationJob;
+
+static void begin_response(GenerationJob *job, const char *key)
+{
+    /* Only stop a transfer early on HTTP/2: aborting resets the stream,
+     * whereas on HTTP/1.1 it would throw away the keep-alive connection. */
+    json_stream_init(&job->response);
+    json_stream_want(&job->response, key);
+    job->response.abort_when_done = net_runtime_http2_supported();
+}
+
+static int response_usable(JsonStream *response, CURLcode res)
+{
+    if (res != CURLE_OK && !(res == CURLE_WRITE_ERROR && response->abort_when_done))
     {
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to create NativeDecryptor instance");
+        return 0;
     }
 
-    jmethodID decryptMessageMethod = (*env)->GetMethodID(env, decryptorClass, "decryptMessage", "()Ljava/lang/String;");
-    if (decryptMessageMethod == NULL)
+    return json_stream_done(response) && !response->fields[0].truncated;
+}
+
+static void finish_generation(GenerationJob *job, CURL *curl, const char *result)
+{
+    if (curl)
     {
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to get decryptMessage method");
+        net_runtime_release(curl);
     }
 
-    jstring firstPartJString = (jstring)(*env)->CallObjectMethod(env, decryptorObj, decryptMessageMethod);
-    if (firstPartJString == NULL)
+    char *copy = strdup(result);
+
+    curl_slist_free_all(job->headers);
+    discard_fragment(job->api_key);
+    free(job->prompt);
+
+    generation_done_fn on_done = job->on_done;
+    void *user = job->user;
+    free(job);
+
+    on_done(copy, user);
+}
+
+static void on_signature_ready(const char *signature, void *user);
+
+static void on_generate_done(CURL *curl, CURLcode res, void *user)
+{
+    GenerationJob *job = (GenerationJob *)user;
+
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+    /* A cached signature the server no longer accepts: drop it and retry
+     * once with a fresh one. */
+    if ((status == 401 || status == 403) && !job->retried)
     {
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to get first part of API key");
+        job->retried = 1;
+        net_runtime_release(curl);
+        signature_manager_invalidate(job->signature);
+        signature_manager_acquire(job->api_key, on_signature_ready, job);
+        return;
     }
 
-    const char *firstPart = (*env)->GetStringUTFChars(env, firstPartJString, NULL);
+    json_stream_finish(&job->response);
+    JsonField *path = &job->response.fields[0];
 
-    char *secondPart = decrypt_second_fragment();
-    if (secondPart == NULL)
+    if (!response_usable(&job->response, res))
     {
-        (*env)->ReleaseStringUTFChars(env, firstPartJString, firstPart);
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to get second part of API key");
+        finish_generation(job, curl, "Error: Image generation request failed");
+        return;
     }
 
-    char *thirdPart = NULL;
-    if (cached_third_part != NULL)
+    char *full_url = build_full_url("https://ai.elliottwen.info", path->value);
+    if (full_url)
     {
-        thirdPart = strdup(cached_third_part);
+        finish_generation(job, curl, full_url);
+        free(full_url);
     }
     else
     {
-        thirdPart = getThirdApiKeyPart();
-        if (thirdPart != NULL && strlen(thirdPart) > 0)
-        {
-            cached_third_part = strdup(thirdPart);
-        }
+        finish_generation(job, curl, path->value);
     }
+}
 
-    if (thirdPart == NULL || strlen(thirdPart) == 0)
+static void on_signature_ready(const char *signature, void *user)
+{
+    GenerationJob *job = (GenerationJob *)user;
+
+    if (signature == NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, firstPartJString, firstPart);
-        free(secondPart);
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to get third part of API key");
+        finish_generation(job, NULL, "Error: Authentication request failed");
+        return;
+    }
+
+    CURL *curl = net_runtime_acquire();
+    if (!curl)
+    {
+        finish_generation(job, NULL, "Error: Image generation request failed");
+        return;
     }
 
-    const char *fourthPart = NULL;
+    snprintf(job->signature, sizeof(job->signature), "%s", signature);
+    begin_response(job, NULL);
+
+    curl_slist_free_all(job->headers);
+    job->headers = NULL;
+    job->headers = curl_slist_append(job->headers, job->auth_header);
+    job->headers = curl_slist_append(job->headers, "Content-Type: application/json");
+
+    snprintf(job->request_body, sizeof(job->request_body), "{\"signature\":\"%s\",\"prompt\":\"%s\"}", job->signature, job->prompt);
+
+    curl_easy_setopt(curl, CURLOPT_URL, "https://ai.elliottwen.info/generate_image");
+
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, job->headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, job->request_body);
 
-    if (cached_fourth_part != NULL)
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, json_stream_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&job->response);
+
+    if (!http_engine_submit(curl, on_generate_done, job))
     {
-        fourthPart = cached_fourth_part;
+        finish_generation(job, curl, "Error: Image generation request failed");
     }
-    else
+}
+
+/*
+ * The signature normally comes straight from the signature manager's cache,
+ * so /generate_image is usually the only round trip on a warm process.
+ */
+static int start_generation(const char *combinedKey, const char *prompt, generation_done_fn on_done, void *user)
+{
+    GenerationJob *job = (GenerationJob *)calloc(1, sizeof(GenerationJob));
+    if (!job)
     {
-        jclass activityThreadClass = (*env)->FindClass(env, "android/app/ActivityThread");
-        jmethodID currentActivityThreadMethod = (*env)->GetStaticMethodID(env, activityThreadClass, "currentActivityThread", "()Landroid/app/ActivityThread;");
-        jobject activityThread = (*env)->CallStaticObjectMethod(env, activityThreadClass, currentActivityThreadMethod);
+        return 0;
+    }
 
-        jmethodID getApplicationMethod = (*env)->GetMethodID(env, activityThreadClass, "getApplication", "()Landroid/app/Application;");
-        jobject application = (*env)->CallObjectMethod(env, activityThread, getApplicationMethod);
+    job->api_key = strdup(combinedKey);
+    job->prompt = strdup(prompt);
+    job->on_done = on_done;
+    job->user = user;
+    snprintf(job->auth_header, sizeof(job->auth_header), "Authorization: %s", combinedKey);
 
-        jclass retrieverClass = (*env)->FindClass(env, "com/example/playground/network/ApiKeyRetriever");
-        jmethodID retrieverConstructor = (*env)->GetMethodID(env, retrieverClass, "<init>", "(Landroid/content/Context;)V");
-        jobject retrieverObj = (*env)->NewObject(env, retrieverClass, retrieverConstructor, application);
+    signature_manager_acquire(job->api_key, on_signature_ready, job);
+    return 1;
+}
 
-        jmethodID retrieveMethod = (*env)->GetMethodID(env, retrieverClass, "retrieveApiKeyNative", "()Ljava/lang/String;");
-        jstring fourthPartJString = (jstring)(*env)->CallObjectMethod(env, retrieverObj, retrieveMethod);
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int done;
+    char *result;
+} SyncWaiter;
 
-        if (fourthPartJString != NULL)
-        {
-            fourthPart = (*env)->GetStringUTFChars(env, fourthPartJString, NULL);
+static void sync_generation_done(char *result, void *user)
+{
+    SyncWaiter *waiter = (SyncWaiter *)user;
 
-            cached_fourth_part = strdup(fourthPart);
+    pthread_mutex_lock(&waiter->lock);
+    waiter->result = result;
+    waiter->done = 1;
+    pthread_cond_signal(&waiter->cond);
+    pthread_mutex_unlock(&waiter->lock);
+}
 
-            (*env)->ReleaseStringUTFChars(env, fourthPartJString, fourthPart);
-            fourthPart = cached_fourth_part;
+typedef struct
+{
+    jlong handle;
+} AsyncCallback;
+
+static void jni_generation_done(char *result, void *user)
+{
+    AsyncCallback *callback = (AsyncCallback *)user;
+    JNIEnv *env = NULL;
+
+    if (cached_vm != NULL && combinerClass != NULL && onCompleteMethod != NULL)
+    {
+        jint status = (*cached_vm)->GetEnv(cached_vm, (void **)&env, JNI_VERSION_1_6);
+        if (status == JNI_EDETACHED)
+        {
+            if ((*cached_vm)->AttachCurrentThreadAsDaemon(cached_vm, &env, NULL) != JNI_OK)
+            {
+                env = NULL;
+            }
         }
-        else
+    }
+
+    if (env != NULL)
+    {
+        jstring resultJString = (*env)->NewStringUTF(env, result ? result : "Error: Memory allocation failed");
+        (*env)->CallStaticVoidMethod(env, combinerClass, onCompleteMethod, callback->handle, resultJString);
+        if ((*env)->ExceptionCheck(env))
         {
-            fourthPart = "";
+            (*env)->ExceptionClear(env);
         }
+        (*env)->DeleteLocalRef(env, resultJString);
     }
 
-    char *fifthPart = decrypt_fifth_fragment();
-    if (fifthPart == NULL)
+    free(result);
+    free(callback);
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_combineApiKey(JNIEnv *env, jobject thiz, jstring promptJString)
+{
+    if (promptJString == NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, firstPartJString, firstPart);
-        free(secondPart);
-        free(thirdPart);
-        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Failed to get fifth part of API key");
+        return (*env)->NewStringUTF(env, "Error: No prompt provided");
     }
 
-    size_t totalLength = strlen(firstPart) + strlen(secondPart) + strlen(thirdPart) +
-                         (fourthPart ? strlen(fourthPart) : 0) + strlen(fifthPart) + 1;
+    const char *prompt = (*env)->GetStringUTFChars(env, promptJString, NULL);
+    if (prompt == NULL)
+    {
+        /* OutOfMemoryError is pending and is thrown on return. */
+        return NULL;
+    }
 
-    char *combinedKey = (char *)malloc(totalLength);
+    const char *error = NULL;
+    char *combinedKey = assemble_combined_key(env, &error);
     if (combinedKey == NULL)
     {
-        (*env)->ReleaseStringUTFChars(env, firstPartJString, firstPart);
-        free(secondPart);
-        free(thirdPart);
-        free(fifthPart);
         (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
-        return (*env)->NewStringUTF(env, "Error: Memory allocation failed");
+        return (*env)->NewStringUTF(env, error);
     }
 
-    strcpy(combinedKey, firstPart);
-    strcat(combinedKey, secondPart);
-    strcat(combinedKey, thirdPart);
-    if (fourthPart)
-    {
-        strcat(combinedKey, fourthPart);
-    }
-    strcat(combinedKey, fifthPart);
+    SyncWaiter waiter;
+    pthread_mutex_init(&waiter.lock, NULL);
+    pthread_cond_init(&waiter.cond, NULL);
+    waiter.done = 0;
+    waiter.result = NULL;
 
-    CURL *curl;
-    CURLcode res;
     jstring result = NULL;
 
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
+    if (start_generation(combinedKey, prompt, sync_generation_done, &waiter))
+    {
+        pthread_mutex_lock(&waiter.lock);
+        while (!waiter.done)
+        {
+            pthread_cond_wait(&waiter.cond, &waiter.lock);
+        }
+        pthread_mutex_unlock(&waiter.lock);
 
-    if (curl)
+        result = (*env)->NewStringUTF(env, waiter.result ? waiter.result : "Error: Memory allocation failed");
+        free(waiter.result);
+    }
+    else
     {
-        MemoryStruct authChunk;
-        authChunk.memory = malloc(1);
-        authChunk.size = 0;
+        result = (*env)->NewStringUTF(env, "Error: Failed to initialize CURL");
+    }
 
-        char auth_url[100];
-        sprintf(auth_url, "https://ai.elliottwen.info/auth");
-        curl_easy_setopt(curl, CURLOPT_URL, auth_url);
+    pthread_cond_destroy(&waiter.cond);
+    pthread_mutex_destroy(&waiter.lock);
 
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    discard_fragment(combinedKey);
+    (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
 
-        struct curl_slist *auth_headers = NULL;
-        char auth_header[1024];
-        sprintf(auth_header, "Authorization: %s", combinedKey);
-        auth_headers = curl_slist_append(auth_headers, auth_header);
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, auth_headers);
+    return result;
+}
 
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, 0L);
+typedef struct Submission
+{
+    AsyncCallback *callback;
+    char *prompt;
+    struct Submission *next;
+} Submission;
+
+/* Cold submissions wait here for the one assembly worker, which runs them
+ * in order; after the first has resolved the fragments the rest are warm. */
+static pthread_once_t assembly_worker_once = PTHREAD_ONCE_INIT;
+/* 1 once the worker is attached, -1 if it could not start or attach. */
+static int assembly_worker_ready = 0;
+static pthread_mutex_t assembly_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t assembly_cond = PTHREAD_COND_INITIALIZER;
+static Submission *assembly_head = NULL;
+static Submission *assembly_tail = NULL;
+
+static void run_submission(JNIEnv *env, Submission *submission)
+{
+    const char *error = NULL;
+    char *combinedKey = assemble_combined_key(env, &error);
 
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&authChunk);
+    if (combinedKey == NULL)
+    {
+        jni_generation_done(strdup(error), submission->callback);
+    }
+    else
+    {
+        if (!start_generation(combinedKey, submission->prompt, jni_generation_done, submission->callback))
+        {
+            jni_generation_done(strdup("Error: Failed to initialize CURL"), submission->callback);
+        }
+        discard_fragment(combinedKey);
+    }
+
+    free(submission->prompt);
+    free(submission);
+}
 
-        res = curl_easy_perform(curl);
+static void *assembly_worker(void *arg)
+{
+    (void)arg;
+    JNIEnv *env = NULL;
+    int attached = (*cached_vm)->AttachCurrentThreadAsDaemon(cached_vm, &env, NULL) == JNI_OK;
+
+    /* The starter waits for this, so nothing is queued for a worker that
+     * could not attach. */
+    pthread_mutex_lock(&assembly_lock);
+    assembly_worker_ready = attached ? 1 : -1;
+    pthread_cond_broadcast(&assembly_cond);
+    pthread_mutex_unlock(&assembly_lock);
+    if (!attached)
+    {
+        return NULL;
+    }
 
-        if (res != CURLE_OK)
+    for (;;)
+    {
+        pthread_mutex_lock(&assembly_lock);
+        while (assembly_head == NULL)
         {
-            result = (*env)->NewStringUTF(env, "Error: Authentication request failed");
+            pthread_cond_wait(&assembly_cond, &assembly_lock);
         }
-        else
+        Submission *submission = assembly_head;
+        assembly_head = submission->next;
+        if (assembly_head == NULL)
         {
-            char *signature = extract_signature(authChunk.memory);
-            if (signature)
-            {
-                MemoryStruct imageChunk;
-                imageChunk.memory = malloc(1);
-                imageChunk.size = 0;
-
-                curl_easy_reset(curl);
-
-                char image_url[100];
-                sprintf(image_url, "https://ai.elliottwen.info/generate_image");
-                curl_easy_setopt(curl, CURLOPT_URL, image_url);
-
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-
-                struct curl_slist *image_headers = NULL;
-                image_headers = curl_slist_append(image_headers, auth_header);
-                image_headers = curl_slist_append(image_headers, "Content-Type: application/json");
-                curl_easy_setopt(curl, CURLOPT_HTTPHEADER, image_headers);
-
-                char request_body[2048];
-                sprintf(request_body, "{\"signature\":\"%s\",\"prompt\":\"%s\"}", signature, prompt);
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request_body);
-
-                curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-                curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&imageChunk);
-
-                res = curl_easy_perform(curl);
-
-                if (res != CURLE_OK)
-                {
-                    result = (*env)->NewStringUTF(env, "Error: Image generation request failed");
-                }
-                else
-                {
-                    char *full_url = build_full_url("https://ai.elliottwen.info", imageChunk.memory);
-                    if (full_url)
-                    {
-                        result = (*env)->NewStringUTF(env, full_url);
-                        free(full_url);
-                    }
-                    else
-                    {
-                        result = (*env)->NewStringUTF(env, imageChunk.memory);
-                    }
-                }
-
-                curl_slist_free_all(image_headers);
-                free(imageChunk.memory);
-                free(signature);
-            }
-            else
-            {
-                result = (*env)->NewStringUTF(env, "Error: Failed to extract signature");
-            }
+            assembly_tail = NULL;
         }
+        pthread_mutex_unlock(&assembly_lock);
 
-        curl_slist_free_all(auth_headers);
-        free(authChunk.memory);
+        run_submission(env, submission);
+    }
 
-        curl_easy_cleanup(curl);
+    return NULL;
+}
+
+static void start_assembly_worker(void)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t worker;
+    int started = cached_vm != NULL && pthread_create(&worker, &attr, assembly_worker, NULL) == 0;
+    pthread_attr_destroy(&attr);
+
+    pthread_mutex_lock(&assembly_lock);
+    if (!started)
+    {
+        assembly_worker_ready = -1;
+    }
+    while (assembly_worker_ready == 0)
+    {
+        pthread_cond_wait(&assembly_cond, &assembly_lock);
+    }
+    pthread_mutex_unlock(&assembly_lock);
+}
+
+/* Queues a cold submission; returns 0 when there is no worker to run it. */
+static int queue_submission(Submission *submission)
+{
+    pthread_once(&assembly_worker_once, start_assembly_worker);
+    if (assembly_worker_ready != 1)
+    {
+        return 0;
+    }
+
+    submission->next = NULL;
+    pthread_mutex_lock(&assembly_lock);
+    if (assembly_tail)
+    {
+        assembly_tail->next = submission;
     }
     else
     {
-        result = (*env)->NewStringUTF(env, "Error: Failed to initialize CURL");
+        assembly_head = submission;
     }
+    assembly_tail = submission;
+    pthread_cond_signal(&assembly_cond);
+    pthread_mutex_unlock(&assembly_lock);
+    return 1;
+}
 
-    curl_global_cleanup();
+static int assembly_queue_empty(void)
+{
+    pthread_mutex_lock(&assembly_lock);
+    int empty = assembly_head == NULL;
+    pthread_mutex_unlock(&assembly_lock);
+    return empty;
+}
 
-    (*env)->ReleaseStringUTFChars(env, firstPartJString, firstPart);
-    free(secondPart);
-    free(thirdPart);
-    free(fifthPart);
-    free(combinedKey);
-    (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
+/* Every fragment is already resolved, so assembly is a few copies and
+ * cannot block on the network, the monitor or the Java fallback. */
+static int assembly_is_warm(void)
+{
+    return integrity_monitor_verdict() != INTEGRITY_PENDING && fragment_vault_ready() &&
+           fragment_cache_peek(&third_slot) != NULL && fragment_cache_peek(&fourth_slot) != NULL;
+}
 
-    return result;
-}
\ No newline at end of file
+/*
+ * Returns right away. A warm assembly runs inline and only posts the
+ * generation; a cold one, which waits on fragment fetches and possibly the
+ * Java fallback, is queued for the assembly worker, so a burst of cold
+ * submissions holds one thread rather than one each. Returns JNI_FALSE
+ * without calling back when the request could not be queued at all.
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_example_playground_network_ApiKeyCombiner_submitCombineApiKey(JNIEnv *env, jobject thiz, jlong handle, jstring promptJString)
+{
+    AsyncCallback *callback = (AsyncCallback *)malloc(sizeof(AsyncCallback));
+    if (callback == NULL)
+    {
+        return JNI_FALSE;
+    }
+    callback->handle = handle;
+
+    if (promptJString == NULL)
+    {
+        jni_generation_done(strdup("Error: No prompt provided"), callback);
+        return JNI_TRUE;
+    }
+
+    Submission *submission = (Submission *)malloc(sizeof(Submission));
+    const char *prompt = (*env)->GetStringUTFChars(env, promptJString, NULL);
+    char *promptCopy = prompt ? strdup(prompt) : NULL;
+    if (prompt)
+    {
+        (*env)->ReleaseStringUTFChars(env, promptJString, prompt);
+    }
+
+    if (submission == NULL || promptCopy == NULL)
+    {
+        if ((*env)->ExceptionCheck(env))
+        {
+            (*env)->ExceptionClear(env);
+        }
+        free(promptCopy);
+        free(submission);
+        free(callback);
+        return JNI_FALSE;
+    }
+
+    submission->callback = callback;
+    submission->prompt = promptCopy;
+
+    /* Queued cold submissions go first, so completions stay in order. */
+    if ((assembly_is_warm() && assembly_queue_empty()) || !queue_submission(submission))
+    {
+        run_submission(env, submission);
+    }
+    return JNI_TRUE;
+}
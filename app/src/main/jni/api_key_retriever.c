@@ -2,53 +2,8 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <openssl/evp.h>
-#include <openssl/bio.h>
-#include <openssl/buffer.h>
-
-char *aes_decrypt(const unsigned char *ciphertext, int ciphertext_len,
-                  const unsigned char *key, const unsigned char *iv)
-{
-    EVP_CIPHER_CTX *ctx;
-    int len;
-    int plaintext_len;
-    unsigned char *plaintext = (unsigned char *)malloc(ciphertext_len + EVP_MAX_BLOCK_LENGTH);
-
-    if (!(ctx = EVP_CIPHER_CTX_new()))
-    {
-        free(plaintext);
-        return NULL;
-    }
-
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv))
-    {
-        EVP_CIPHER_CTX_free(ctx);
-        free(plaintext);
-        return NULL;
-    }
-
-    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len))
-    {
-        EVP_CIPHER_CTX_free(ctx);
-        free(plaintext);
-        return NULL;
-    }
-    plaintext_len = len;
-
-    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + len, &len))
-    {
-        EVP_CIPHER_CTX_free(ctx);
-        free(plaintext);
-        return NULL;
-    }
-    plaintext_len += len;
-
-    EVP_CIPHER_CTX_free(ctx);
-
-    plaintext[plaintext_len] = '\0';
-
-    return (char *)plaintext;
-}
+#include "codec.h"
+#include "crypto_engine.h"
 
 JNIEXPORT jstring JNICALL Java_com_example_playground_network_ApiKeyRetriever_retrieveApiKeyNative(
     JNIEnv *env, jobject thiz)
@@ -130,28 +85,28 @@ JNIEXPORT jstring JNICALL Java_com_example_playground_network_ApiKeyRetriever_re
     unsigned char iv[16];
     memset(iv, '0', 16);
 
-    BIO *b64, *bmem;
-    b64 = BIO_new(BIO_f_base64());
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-    bmem = BIO_new_mem_buf(encryptedKeyStr, -1);
-    bmem = BIO_push(b64, bmem);
-
-    unsigned char encrypted[1024] = {0};
-    int encryptedLen = BIO_read(bmem, encrypted, sizeof(encrypted));
-    BIO_free_all(bmem);
+    size_t encryptedKeyLen = strlen(encryptedKeyStr);
+    unsigned char *encrypted = (unsigned char *)malloc(codec_base64_decoded_max(encryptedKeyLen));
+    long encryptedLen = encrypted ? codec_base64_decode(encryptedKeyStr, encryptedKeyLen, encrypted) : -1;
 
     (*env)->ReleaseStringUTFChars(env, encryptedKey, encryptedKeyStr);
 
     if (encryptedLen <= 0)
     {
+        free(encrypted);
         return NULL;
     }
 
-    char *decryptedKey = aes_decrypt(encrypted, encryptedLen, key, iv);
-    if (decryptedKey == NULL)
+    size_t decryptedCap = crypto_decrypt_bound((size_t)encryptedLen);
+    char *decryptedKey = (char *)malloc(decryptedCap);
+    if (decryptedKey == NULL ||
+        crypto_decrypt(encrypted, (size_t)encryptedLen, key, iv, (unsigned char *)decryptedKey, decryptedCap) < 0)
     {
+        free(encrypted);
+        free(decryptedKey);
         return NULL;
     }
+    free(encrypted);
 
     jstring result = (*env)->NewStringUTF(env, decryptedKey);
 
@@ -0,0 +1,12 @@
+/* The scalar reference build of codec.c; see codec_scalar.h. */
+#define CODEC_SCALAR_ONLY 1
+
+#define codec_base64_encoded_len scalar_codec_base64_encoded_len
+#define codec_base64_encode scalar_codec_base64_encode
+#define codec_base64_decoded_max scalar_codec_base64_decoded_max
+#define codec_base64_decode scalar_codec_base64_decode
+#define codec_hex_decode scalar_codec_hex_decode
+#define codec_xor_keys scalar_codec_xor_keys
+#define codec_impl_name scalar_codec_impl_name
+
+#include "codec.c"
@@ -0,0 +1,23 @@
+#ifndef CODEC_SCALAR_H
+#define CODEC_SCALAR_H
+
+#include <stddef.h>
+
+/*
+ * codec.c built a second time with every SIMD kernel compiled out
+ * (codec_scalar.c), so the dispatched kernels can be checked and timed
+ * against the scalar code in the same process.
+ */
+
+size_t scalar_codec_base64_encode(const unsigned char *in, size_t len, char *out);
+
+long scalar_codec_base64_decode(const char *in, size_t len, unsigned char *out);
+
+long scalar_codec_hex_decode(const char *in, size_t len, unsigned char *out);
+
+void scalar_codec_xor_keys(unsigned char *data, size_t len,
+                           const unsigned char *const *keys, const size_t *key_lens, int key_count);
+
+const char *scalar_codec_impl_name(void);
+
+#endif
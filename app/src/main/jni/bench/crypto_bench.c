@@ -0,0 +1,216 @@
+/*
+ * Decrypts per second for crypto_engine, on one thread and on every core.
+ *
+ * Three paths decrypt the first and second key fragments from the fragment
+ * tables: the per-call aes_decrypt the libraries used before the engine
+ * (fresh EVP_CIPHER_CTX, cipher lookup and malloc'd output every time),
+ * crypto_decrypt on the thread's cached context into a caller buffer, and
+ * crypto_decrypt_batch with both fragments in one call. All three must
+ * produce the same plaintext.
+ *
+ *   crypto_bench           2,000,000 decrypts per thread and path
+ *   crypto_bench --check   equality and a short timing run
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include "crypto_engine.h"
+#include "fragment_tables.h"
+
+/* The keys and IVs assemble_combined_key uses for the two fragments. */
+static const unsigned char first_fragment_key[] = "583ae16c25eeb57b";
+static const unsigned char second_fragment_key[] = "aieIIiottweninfo";
+static unsigned char first_iv[CRYPTO_AES_BLOCK_SIZE];
+static unsigned char second_iv[CRYPTO_AES_BLOCK_SIZE];
+
+typedef enum
+{
+    PATH_PER_CALL,
+    PATH_ENGINE,
+    PATH_BATCH,
+    PATH_COUNT
+} Path;
+
+static const char *const path_names[PATH_COUNT] = {"per-call ctx", "crypto_decrypt", "crypto_decrypt_batch"};
+
+typedef struct
+{
+    Path path;
+    long decrypts;
+    long failures;
+    pthread_barrier_t *start_line;
+} Worker;
+
+static long monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/* The aes_decrypt shape the libraries each carried before crypto_engine. */
+static char *aes_decrypt_per_call(const unsigned char *in, int in_len, const unsigned char *key,
+                                  const unsigned char *iv)
+{
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (ctx == NULL)
+    {
+        return NULL;
+    }
+
+    unsigned char *out = (unsigned char *)malloc(in_len + CRYPTO_AES_BLOCK_SIZE + 1);
+    int len = 0;
+    int total = 0;
+    int ok = out && EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv) == 1 &&
+             EVP_DecryptUpdate(ctx, out, &len, in, in_len) == 1;
+    total = len;
+    ok = ok && EVP_DecryptFinal_ex(ctx, out + total, &len) == 1;
+    EVP_CIPHER_CTX_free(ctx);
+
+    if (!ok)
+    {
+        free(out);
+        return NULL;
+    }
+    out[total + len] = '\0';
+    return (char *)out;
+}
+
+/* Decrypts both fragments once on the given path; returns how many worked. */
+static int decrypt_pair(Path path, unsigned char *first, unsigned char *second)
+{
+    size_t cap = CRYPTO_DECRYPT_BOUND(FT_FIRST_FRAGMENT_SIZE > FT_SECOND_FRAGMENT_SIZE ? FT_FIRST_FRAGMENT_SIZE
+                                                                                      : FT_SECOND_FRAGMENT_SIZE);
+    int ok = 0;
+
+    if (path == PATH_PER_CALL)
+    {
+        char *a = aes_decrypt_per_call(ft_first_fragment, FT_FIRST_FRAGMENT_SIZE, first_fragment_key, first_iv);
+        char *b = aes_decrypt_per_call(ft_second_fragment, FT_SECOND_FRAGMENT_SIZE, second_fragment_key, second_iv);
+        if (a)
+        {
+            strcpy((char *)first, a);
+            ok++;
+        }
+        if (b)
+        {
+            strcpy((char *)second, b);
+            ok++;
+        }
+        free(a);
+        free(b);
+    }
+    else if (path == PATH_ENGINE)
+    {
+        ok += crypto_decrypt(ft_first_fragment, FT_FIRST_FRAGMENT_SIZE, first_fragment_key, first_iv, first, cap) >= 0;
+        ok += crypto_decrypt(ft_second_fragment, FT_SECOND_FRAGMENT_SIZE, second_fragment_key, second_iv, second,
+                             cap) >= 0;
+    }
+    else
+    {
+        CryptoDecryptJob jobs[2] = {
+            {ft_first_fragment, FT_FIRST_FRAGMENT_SIZE, first_fragment_key, first_iv, first, cap, 0},
+            {ft_second_fragment, FT_SECOND_FRAGMENT_SIZE, second_fragment_key, second_iv, second, cap, 0},
+        };
+        ok = crypto_decrypt_batch(jobs, 2);
+    }
+    return ok;
+}
+
+static void *run_worker(void *arg)
+{
+    Worker *worker = (Worker *)arg;
+    unsigned char first[CRYPTO_DECRYPT_BOUND(FT_FIRST_FRAGMENT_SIZE + FT_SECOND_FRAGMENT_SIZE)];
+    unsigned char second[CRYPTO_DECRYPT_BOUND(FT_FIRST_FRAGMENT_SIZE + FT_SECOND_FRAGMENT_SIZE)];
+
+    pthread_barrier_wait(worker->start_line);
+    for (long i = 0; i < worker->decrypts; i += 2)
+    {
+        worker->failures += 2 - decrypt_pair(worker->path, first, second);
+    }
+    crypto_engine_release_thread();
+    return NULL;
+}
+
+/* Returns decrypts per second summed over all threads, or -1 on failures. */
+static double measure(Path path, int thread_count, long decrypts_per_thread)
+{
+    pthread_t threads[thread_count];
+    Worker workers[thread_count];
+    pthread_barrier_t start_line;
+    pthread_barrier_init(&start_line, NULL, thread_count + 1);
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        workers[i] = (Worker){path, decrypts_per_thread, 0, &start_line};
+        pthread_create(&threads[i], NULL, run_worker, &workers[i]);
+    }
+
+    pthread_barrier_wait(&start_line);
+    long started = monotonic_ns();
+    long failures = 0;
+    for (int i = 0; i < thread_count; i++)
+    {
+        pthread_join(threads[i], NULL);
+        failures += workers[i].failures;
+    }
+    long elapsed = monotonic_ns() - started;
+    pthread_barrier_destroy(&start_line);
+
+    if (failures)
+    {
+        return -1;
+    }
+    return (double)decrypts_per_thread * thread_count * 1e9 / elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    int check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    long decrypts = check ? 20000 : 2000000;
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1)
+    {
+        cores = 1;
+    }
+
+    memset(first_iv, '0', sizeof(first_iv));
+    memset(second_iv, '1', sizeof(second_iv));
+
+    unsigned char expected[2][CRYPTO_DECRYPT_BOUND(FT_FIRST_FRAGMENT_SIZE + FT_SECOND_FRAGMENT_SIZE)];
+    if (decrypt_pair(PATH_PER_CALL, expected[0], expected[1]) != 2)
+    {
+        fprintf(stderr, "crypto_bench: could not decrypt the fragment tables\n");
+        return 1;
+    }
+    for (int path = PATH_ENGINE; path < PATH_COUNT; path++)
+    {
+        unsigned char actual[2][sizeof(expected[0])];
+        if (decrypt_pair((Path)path, actual[0], actual[1]) != 2 ||
+            strcmp((char *)actual[0], (char *)expected[0]) != 0 ||
+            strcmp((char *)actual[1], (char *)expected[1]) != 0)
+        {
+            fprintf(stderr, "crypto_bench: %s plaintext differs from the per-call path\n", path_names[path]);
+            return 1;
+        }
+    }
+
+    int ok = 1;
+    char all_label[32];
+    snprintf(all_label, sizeof(all_label), "%d core%s", cores, cores == 1 ? "" : "s");
+    printf("%-22s %16s %16s\n", "path", "1 thread", all_label);
+    for (int path = 0; path < PATH_COUNT; path++)
+    {
+        double single = measure((Path)path, 1, decrypts);
+        double all = measure((Path)path, cores, decrypts);
+        ok &= single > 0 && all > 0;
+        printf("%-22s %14.0f/s %14.0f/s\n", path_names[path], single, all);
+    }
+    crypto_engine_release_thread();
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,503 @@
+/*
+ * Concurrent generation load against a local stand-in server.
+ *
+ * Each generation is the native request chain of ApiKeyCombiner.submit: a
+ * POST to /auth followed by a POST to /generate_image on the same pooled
+ * handle, both driven by http_engine. The server answers after a fixed
+ * delay per endpoint, so the run measures how the engine overlaps waits
+ * rather than how fast loopback is. 16, 32 and 64 generations are kept in
+ * flight; the process thread count is sampled throughout to show that load
+ * does not add threads.
+ *
+ *   engine_bench           full run
+ *   engine_bench --check   short run that fails on errors or thread growth
+ */
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "http_engine.h"
+#include "net_runtime.h"
+
+#define SERVER_MAX_CONNECTIONS 256
+#define SERVER_BUFFER_SIZE 4096
+
+/* Threads the engine may legitimately add on top of the idle process. */
+#define ALLOWED_EXTRA_THREADS 2
+
+typedef struct
+{
+    long auth_delay_ms;
+    long generate_delay_ms;
+    int rounds;
+} BenchConfig;
+
+static const BenchConfig FULL_RUN = {20, 200, 8};
+static const BenchConfig CHECK_RUN = {5, 20, 2};
+
+static const int CONCURRENCY[] = {16, 32, 64};
+
+static long monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+}
+
+static int thread_count(void)
+{
+    FILE *status = fopen("/proc/self/status", "r");
+    if (!status)
+    {
+        return -1;
+    }
+
+    char line[256];
+    int threads = -1;
+    while (fgets(line, sizeof(line), status))
+    {
+        if (sscanf(line, "Threads: %d", &threads) == 1)
+        {
+            break;
+        }
+    }
+    fclose(status);
+    return threads;
+}
+
+/* ---- Stand-in server: one thread, keep-alive HTTP/1.1, delayed replies ---- */
+
+typedef struct
+{
+    int fd;
+    char buffer[SERVER_BUFFER_SIZE];
+    size_t used;
+    long reply_at_us;
+    const char *reply;
+} ServerConnection;
+
+static const char AUTH_BODY[] = "{\"signature\":\"bench-token\"}";
+static const char GENERATE_BODY[] = "{\"image_url\":\"http://127.0.0.1/images/0.png\"}";
+static const char NOT_FOUND_REPLY[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+
+static char auth_reply[256];
+static char generate_reply[256];
+
+static int listen_fd = -1;
+static int server_port = 0;
+static BenchConfig server_config;
+static ServerConnection connections[SERVER_MAX_CONNECTIONS];
+static int connection_count = 0;
+
+/* Returns the length of a complete request at the front of the buffer, or 0. */
+static size_t complete_request(const ServerConnection *conn)
+{
+    const char *end = NULL;
+    for (size_t i = 3; i < conn->used; i++)
+    {
+        if (memcmp(conn->buffer + i - 3, "\r\n\r\n", 4) == 0)
+        {
+            end = conn->buffer + i + 1;
+            break;
+        }
+    }
+    if (!end)
+    {
+        return 0;
+    }
+
+    size_t length = 0;
+    const char *header = strcasestr(conn->buffer, "Content-Length:");
+    if (header && header < end)
+    {
+        length = strtoul(header + 15, NULL, 10);
+    }
+
+    size_t total = (size_t)(end - conn->buffer) + length;
+    return total <= conn->used ? total : 0;
+}
+
+static void schedule_reply(ServerConnection *conn)
+{
+    size_t length = complete_request(conn);
+    if (length == 0 || conn->reply)
+    {
+        return;
+    }
+
+    long delay_ms = 0;
+    if (strncmp(conn->buffer, "POST /auth ", 11) == 0)
+    {
+        conn->reply = auth_reply;
+        delay_ms = server_config.auth_delay_ms;
+    }
+    else if (strncmp(conn->buffer, "POST /generate_image ", 21) == 0)
+    {
+        conn->reply = generate_reply;
+        delay_ms = server_config.generate_delay_ms;
+    }
+    else
+    {
+        conn->reply = NOT_FOUND_REPLY;
+    }
+
+    conn->reply_at_us = monotonic_us() + delay_ms * 1000L;
+    memmove(conn->buffer, conn->buffer + length, conn->used - length);
+    conn->used -= length;
+}
+
+static void close_connection(int index)
+{
+    close(connections[index].fd);
+    connections[index] = connections[--connection_count];
+}
+
+static void *server_loop(void *arg)
+{
+    (void)arg;
+    struct pollfd fds[SERVER_MAX_CONNECTIONS + 1];
+
+    for (;;)
+    {
+        long now = monotonic_us();
+        int timeout_ms = 100;
+
+        for (int i = 0; i < connection_count; i++)
+        {
+            ServerConnection *conn = &connections[i];
+            if (conn->reply && conn->reply_at_us <= now)
+            {
+                /* Replies are far smaller than the socket buffer. */
+                if (send(conn->fd, conn->reply, strlen(conn->reply), MSG_NOSIGNAL) < 0)
+                {
+                    close_connection(i--);
+                    continue;
+                }
+                conn->reply = NULL;
+                schedule_reply(conn);
+            }
+            if (conn->reply)
+            {
+                long wait_ms = (conn->reply_at_us - now + 999) / 1000;
+                if (wait_ms < timeout_ms)
+                {
+                    timeout_ms = (int)wait_ms;
+                }
+            }
+        }
+
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < connection_count; i++)
+        {
+            fds[i + 1].fd = connections[i].fd;
+            fds[i + 1].events = POLLIN;
+            fds[i + 1].revents = 0;
+        }
+
+        int count = connection_count;
+        if (poll(fds, count + 1, timeout_ms) <= 0)
+        {
+            continue;
+        }
+
+        /* Walk backwards so closing a connection does not skip one. */
+        for (int i = count - 1; i >= 0; i--)
+        {
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                continue;
+            }
+
+            ServerConnection *conn = &connections[i];
+            ssize_t n = recv(conn->fd, conn->buffer + conn->used, sizeof(conn->buffer) - 1 - conn->used, 0);
+            if (n <= 0)
+            {
+                close_connection(i);
+                continue;
+            }
+            conn->used += (size_t)n;
+            conn->buffer[conn->used] = '\0';
+            schedule_reply(conn);
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            int fd;
+            while ((fd = accept(listen_fd, NULL, NULL)) >= 0)
+            {
+                if (connection_count == SERVER_MAX_CONNECTIONS)
+                {
+                    close(fd);
+                    continue;
+                }
+                ServerConnection *conn = &connections[connection_count++];
+                memset(conn, 0, sizeof(*conn));
+                conn->fd = fd;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int start_server(const BenchConfig *config)
+{
+    server_config = *config;
+    snprintf(auth_reply, sizeof(auth_reply), "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n%s",
+             strlen(AUTH_BODY), AUTH_BODY);
+    snprintf(generate_reply, sizeof(generate_reply), "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n%s",
+             strlen(GENERATE_BODY), GENERATE_BODY);
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        return 0;
+    }
+
+    int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t addr_len = sizeof(addr);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, SERVER_MAX_CONNECTIONS) != 0 ||
+        getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) != 0)
+    {
+        close(listen_fd);
+        return 0;
+    }
+    server_port = ntohs(addr.sin_port);
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, server_loop, NULL) != 0)
+    {
+        return 0;
+    }
+    pthread_detach(thread);
+    return 1;
+}
+
+/* ---- Client: generations chained through http_engine ---- */
+
+typedef struct
+{
+    int stage;
+    long started_us;
+    char url[96];
+} Generation;
+
+static pthread_mutex_t run_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t run_cond = PTHREAD_COND_INITIALIZER;
+static int remaining = 0;
+static int finished = 0;
+static int failures = 0;
+static long *latencies_us = NULL;
+
+static size_t discard_body(char *data, size_t size, size_t nmemb, void *user)
+{
+    (void)data;
+    (void)user;
+    return size * nmemb;
+}
+
+static void on_generation_step(CURL *curl, CURLcode res, void *user);
+
+static int submit_step(CURL *curl, Generation *gen, const char *path, const char *body)
+{
+    net_runtime_reset(curl);
+    snprintf(gen->url, sizeof(gen->url), "http://127.0.0.1:%d%s", server_port, path);
+    curl_easy_setopt(curl, CURLOPT_URL, gen->url);
+    curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, body);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_body);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    return http_engine_submit(curl, on_generation_step, gen);
+}
+
+static int start_generation(void)
+{
+    Generation *gen = (Generation *)calloc(1, sizeof(Generation));
+    CURL *curl = net_runtime_acquire();
+    if (!gen || !curl)
+    {
+        free(gen);
+        net_runtime_release(curl);
+        return 0;
+    }
+
+    gen->started_us = monotonic_us();
+    if (!submit_step(curl, gen, "/auth", "{\"apiKey\":\"bench\"}"))
+    {
+        free(gen);
+        net_runtime_release(curl);
+        return 0;
+    }
+    return 1;
+}
+
+static void finish_generation(int ok, long latency_us)
+{
+    pthread_mutex_lock(&run_lock);
+    if (ok)
+    {
+        latencies_us[finished] = latency_us;
+    }
+    else
+    {
+        failures++;
+        latencies_us[finished] = 0;
+    }
+    finished++;
+
+    int next = remaining > 0;
+    if (next)
+    {
+        remaining--;
+    }
+    pthread_cond_signal(&run_cond);
+    pthread_mutex_unlock(&run_lock);
+
+    if (next && !start_generation())
+    {
+        finish_generation(0, 0);
+    }
+}
+
+static void on_generation_step(CURL *curl, CURLcode res, void *user)
+{
+    Generation *gen = (Generation *)user;
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+    if (res == CURLE_OK && status == 200 && gen->stage == 0)
+    {
+        gen->stage = 1;
+        if (submit_step(curl, gen, "/generate_image", "{\"prompt\":\"a lighthouse at dusk\"}"))
+        {
+            return;
+        }
+        res = CURLE_FAILED_INIT;
+    }
+
+    int ok = res == CURLE_OK && status == 200;
+    long latency_us = monotonic_us() - gen->started_us;
+    net_runtime_release(curl);
+    free(gen);
+    finish_generation(ok, latency_us);
+}
+
+static int compare_long(const void *a, const void *b)
+{
+    long x = *(const long *)a;
+    long y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+/* Runs concurrency * rounds generations with concurrency in flight. */
+static int run_level(int concurrency, const BenchConfig *config, int baseline_threads, int check)
+{
+    int total = concurrency * config->rounds;
+    latencies_us = (long *)calloc((size_t)total, sizeof(long));
+    if (!latencies_us)
+    {
+        return 0;
+    }
+
+    NetRuntimeStats before;
+    net_runtime_get_stats(&before);
+
+    pthread_mutex_lock(&run_lock);
+    remaining = total - concurrency;
+    finished = 0;
+    failures = 0;
+    pthread_mutex_unlock(&run_lock);
+
+    long started_us = monotonic_us();
+    for (int i = 0; i < concurrency; i++)
+    {
+        if (!start_generation())
+        {
+            finish_generation(0, 0);
+        }
+    }
+
+    int peak_threads = thread_count();
+    pthread_mutex_lock(&run_lock);
+    while (finished < total)
+    {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += 5 * 1000000L;
+        if (until.tv_nsec >= 1000000000L)
+        {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&run_cond, &run_lock, &until);
+
+        int threads = thread_count();
+        if (threads > peak_threads)
+        {
+            peak_threads = threads;
+        }
+    }
+    int failed = failures;
+    pthread_mutex_unlock(&run_lock);
+    long elapsed_us = monotonic_us() - started_us;
+
+    NetRuntimeStats after;
+    net_runtime_get_stats(&after);
+
+    qsort(latencies_us, (size_t)total, sizeof(long), compare_long);
+    long p50 = latencies_us[total / 2];
+    long p99 = latencies_us[(total * 99) / 100 < total ? (total * 99) / 100 : total - 1];
+    free(latencies_us);
+    latencies_us = NULL;
+
+    printf("%3d in flight  %5d gens  %8.1f gen/s  p50 %7.1f ms  p99 %7.1f ms  "
+           "connections %4ld  threads %d (idle %d)  failed %d\n",
+           concurrency, total, total * 1e6 / elapsed_us, p50 / 1000.0, p99 / 1000.0,
+           after.connections - before.connections, peak_threads, baseline_threads, failed);
+
+    if (!check)
+    {
+        return 1;
+    }
+    return failed == 0 && peak_threads <= baseline_threads + ALLOWED_EXTRA_THREADS;
+}
+
+int main(int argc, char **argv)
+{
+    int check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    const BenchConfig *config = check ? &CHECK_RUN : &FULL_RUN;
+
+    if (!start_server(config) || !net_runtime_init())
+    {
+        fprintf(stderr, "engine_bench: setup failed\n");
+        return 1;
+    }
+
+    /* The engine thread is started lazily; count it as load-induced. */
+    int baseline_threads = thread_count();
+
+    int ok = 1;
+    for (size_t i = 0; i < sizeof(CONCURRENCY) / sizeof(CONCURRENCY[0]); i++)
+    {
+        ok &= run_level(CONCURRENCY[i], config, baseline_threads, check);
+    }
+    return ok ? 0 : 1;
+}
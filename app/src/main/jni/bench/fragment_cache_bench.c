@@ -0,0 +1,143 @@
+/*
+ * Single-flight stress for fragment_cache: N threads hit a cold slot at the
+ * same instant, the way concurrent first generations do, and every round
+ * must run the stub fetch exactly once. A failing round checks that
+ * waiters share the failure instead of fetching again. The warm path is
+ * timed afterwards.
+ *
+ *   fragment_cache_bench           64 threads, 200 rounds
+ *   fragment_cache_bench --check   64 threads, 20 rounds
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "fragment_cache.h"
+
+#define THREADS 64
+#define FETCH_DELAY_US 2000
+#define WARM_READS 10000000L
+
+static FragmentSlot slot = FRAGMENT_SLOT_INITIALIZER;
+static pthread_barrier_t start_line;
+
+static long stub_fetches = 0;
+static int stub_fails = 0;
+
+typedef struct
+{
+    const char *seen;
+    int leader;
+} Outcome;
+
+static long monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/* Stands in for getThirdApiKeyPart: slow enough that every thread arrives
+ * while the leader is still fetching. */
+static char *stub_fetch(void)
+{
+    __atomic_add_fetch(&stub_fetches, 1, __ATOMIC_RELAXED);
+    usleep(FETCH_DELAY_US);
+    return stub_fails ? NULL : strdup("fragment");
+}
+
+static void *contend(void *arg)
+{
+    Outcome *outcome = (Outcome *)arg;
+    pthread_barrier_wait(&start_line);
+
+    /* Same sequence as run_fragment_fetch in api_key_combiner.c. */
+    if (fragment_cache_peek(&slot) == NULL && fragment_cache_begin(&slot))
+    {
+        outcome->leader = 1;
+        fragment_cache_publish(&slot, stub_fetch());
+    }
+    outcome->seen = fragment_cache_peek(&slot);
+    return NULL;
+}
+
+/* Runs one cold round; returns 0 and reports if the slot misbehaved. */
+static int run_round(int round, int failing)
+{
+    pthread_t threads[THREADS];
+    Outcome outcomes[THREADS];
+    memset(outcomes, 0, sizeof(outcomes));
+
+    fragment_cache_clear(&slot);
+    stub_fails = failing;
+    long fetches_before = __atomic_load_n(&stub_fetches, __ATOMIC_RELAXED);
+    long slot_before = fragment_cache_fetches(&slot);
+
+    for (int i = 0; i < THREADS; i++)
+    {
+        pthread_create(&threads[i], NULL, contend, &outcomes[i]);
+    }
+    for (int i = 0; i < THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    long fetches = __atomic_load_n(&stub_fetches, __ATOMIC_RELAXED) - fetches_before;
+    long slot_fetches = fragment_cache_fetches(&slot) - slot_before;
+    int leaders = 0;
+    int consistent = 1;
+    for (int i = 0; i < THREADS; i++)
+    {
+        leaders += outcomes[i].leader;
+        consistent &= failing ? outcomes[i].seen == NULL : outcomes[i].seen == outcomes[0].seen && outcomes[i].seen;
+    }
+
+    if (fetches != 1 || slot_fetches != 1 || leaders != 1 || !consistent)
+    {
+        fprintf(stderr, "round %d%s: %ld stub fetches, %ld slot fetches, %d leaders, %s values\n",
+                round, failing ? " (failing)" : "", fetches, slot_fetches, leaders,
+                consistent ? "consistent" : "inconsistent");
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    int check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    int rounds = check ? 20 : 200;
+
+    pthread_barrier_init(&start_line, NULL, THREADS);
+
+    int ok = 1;
+    long started = monotonic_ns();
+    for (int round = 0; round < rounds && ok; round++)
+    {
+        /* Every tenth round the fetch fails. */
+        ok = run_round(round, round % 10 == 9);
+    }
+    long cold_ns = monotonic_ns() - started;
+
+    printf("%d threads x %d cold rounds: %s, %ld stub fetches, %.2f ms per round\n",
+           THREADS, rounds, ok ? "one fetch per round" : "FAILED", stub_fetches, cold_ns / 1e6 / rounds);
+
+    fragment_cache_clear(&slot);
+    fragment_cache_begin(&slot);
+    fragment_cache_publish(&slot, strdup("fragment"));
+
+    const char *volatile sink = NULL;
+    started = monotonic_ns();
+    for (long i = 0; i < WARM_READS; i++)
+    {
+        sink = fragment_cache_peek(&slot);
+    }
+    long warm_ns = monotonic_ns() - started;
+    (void)sink;
+    printf("warm peek: %.2f ns\n", (double)warm_ns / WARM_READS);
+
+    fragment_cache_clear(&slot);
+    pthread_barrier_destroy(&start_line);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+/*
+ * Warm-path key assembly, before and after fragment_vault.
+ *
+ * Before: every assembly decrypted fragments one and two, decoded fragment
+ * five and cleansed the temporaries again. After: the three fragments are
+ * sealed into the vault once and each assembly only copies them. Both paths
+ * join the same cached third and fourth fragments and must produce the
+ * same key. On the device the old path also paid for the JNI lookups of
+ * the first fragment's key, which this host bench cannot include, so the
+ * measured gap is a lower bound.
+ *
+ * Before timing, a store that fails partway through must leave the vault
+ * empty enough for the next attempt to seal it.
+ *
+ *   fragment_vault_bench           1,000,000 assemblies per path
+ *   fragment_vault_bench --check   equality and a short timing run
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/crypto.h>
+#include "crypto_engine.h"
+#include "fragment_tables.h"
+#include "fragment_vault.h"
+
+/* NativeKeyStore.KEYS[2], truncated to the AES key size the way
+ * read_first_fragment_key does. */
+static const unsigned char first_fragment_key[] = "583ae16c25eeb57b";
+static const unsigned char second_fragment_key[] = "aieIIiottweninfo";
+
+/* Stand-ins for the fragment_cache values of the network fragments. */
+static const char third_part[] = "3rdfragmentfromtheauthendpoint0";
+static const char fourth_part[] = "4thfragmentfromtheexifcomment00";
+
+static long monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static char *join_fragments(const char *first, const char *second, const char *fifth)
+{
+    size_t total = strlen(first) + strlen(second) + strlen(third_part) + strlen(fourth_part) + strlen(fifth) + 1;
+    char *key = (char *)malloc(total);
+    if (key)
+    {
+        strcpy(key, first);
+        strcat(key, second);
+        strcat(key, third_part);
+        strcat(key, fourth_part);
+        strcat(key, fifth);
+    }
+    return key;
+}
+
+static void discard(char *fragment)
+{
+    if (fragment)
+    {
+        OPENSSL_cleanse(fragment, strlen(fragment));
+        free(fragment);
+    }
+}
+
+static char *decrypt_fragment(const unsigned char *in, size_t in_len, const unsigned char *key, char iv_fill)
+{
+    unsigned char iv[CRYPTO_AES_BLOCK_SIZE];
+    memset(iv, iv_fill, sizeof(iv));
+
+    char *out = (char *)malloc(CRYPTO_DECRYPT_BOUND(in_len));
+    if (out && crypto_decrypt(in, in_len, key, iv, (unsigned char *)out, CRYPTO_DECRYPT_BOUND(in_len)) < 0)
+    {
+        free(out);
+        out = NULL;
+    }
+    return out;
+}
+
+/* The per-call path assemble_combined_key took before the vault. */
+static char *assemble_before(void)
+{
+    char *first = decrypt_fragment(ft_first_fragment, FT_FIRST_FRAGMENT_SIZE, first_fragment_key, '0');
+    char *second = decrypt_fragment(ft_second_fragment, FT_SECOND_FRAGMENT_SIZE, second_fragment_key, '1');
+    char *fifth = (char *)malloc(FT_FIFTH_FRAGMENT_SIZE + 1);
+    if (fifth)
+    {
+        ft_fifth_fragment_decode((unsigned char *)fifth);
+    }
+
+    char *key = first && second && fifth ? join_fragments(first, second, fifth) : NULL;
+    discard(first);
+    discard(second);
+    discard(fifth);
+    return key;
+}
+
+static int seal_vault(void)
+{
+    char *first = decrypt_fragment(ft_first_fragment, FT_FIRST_FRAGMENT_SIZE, first_fragment_key, '0');
+    char *second = decrypt_fragment(ft_second_fragment, FT_SECOND_FRAGMENT_SIZE, second_fragment_key, '1');
+    char *fifth = (char *)malloc(FT_FIFTH_FRAGMENT_SIZE + 1);
+    if (fifth)
+    {
+        ft_fifth_fragment_decode((unsigned char *)fifth);
+    }
+
+    fragment_vault_lock();
+    int ok = first && second && fifth &&
+             fragment_vault_store(VAULT_FIRST, first) &&
+             fragment_vault_store(VAULT_SECOND, second) &&
+             fragment_vault_store(VAULT_FIFTH, fifth) &&
+             fragment_vault_seal();
+    if (!ok)
+    {
+        fragment_vault_discard();
+    }
+    fragment_vault_unlock();
+
+    discard(first);
+    discard(second);
+    discard(fifth);
+    return ok;
+}
+
+/* Fails the second store the way resolve_static_fragments can, with the
+ * first slot already filled; 0 if that store unexpectedly succeeds. */
+static int fail_partial_store(void)
+{
+    static char oversized[2 * 4096];
+    memset(oversized, 'x', sizeof(oversized) - 1);
+
+    fragment_vault_lock();
+    int stored = fragment_vault_store(VAULT_FIRST, "partial") && fragment_vault_store(VAULT_SECOND, oversized);
+    fragment_vault_discard();
+    fragment_vault_unlock();
+    return !stored && !fragment_vault_ready();
+}
+
+/* The warm path of assemble_combined_key with the vault sealed. */
+static char *assemble_after(void)
+{
+    if (!fragment_vault_ready())
+    {
+        return NULL;
+    }
+    return join_fragments(fragment_vault_get(VAULT_FIRST), fragment_vault_get(VAULT_SECOND),
+                          fragment_vault_get(VAULT_FIFTH));
+}
+
+static double time_path(char *(*assemble)(void), long iterations)
+{
+    long started = monotonic_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        discard(assemble());
+    }
+    return (double)(monotonic_ns() - started) / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    int check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    long iterations = check ? 20000 : 1000000;
+
+    if (!fail_partial_store())
+    {
+        fprintf(stderr, "fragment_vault_bench: an oversized fragment was stored\n");
+        return 1;
+    }
+
+    char *expected = assemble_before();
+    if (!expected || !seal_vault())
+    {
+        fprintf(stderr, "fragment_vault_bench: could not decrypt the fragment tables or reseal the vault\n");
+        return 1;
+    }
+
+    char *actual = assemble_after();
+    int equal = actual && strcmp(expected, actual) == 0;
+    discard(expected);
+    discard(actual);
+    if (!equal)
+    {
+        fprintf(stderr, "fragment_vault_bench: vault key differs from the per-call key\n");
+        return 1;
+    }
+
+    double before_ns = time_path(assemble_before, iterations);
+    double after_ns = time_path(assemble_after, iterations);
+    printf("warm assembly: before %.0f ns, after %.0f ns (%.1fx)\n", before_ns, after_ns, before_ns / after_ns);
+
+    fragment_vault_wipe();
+    return after_ns < before_ns ? 0 : 1;
+}
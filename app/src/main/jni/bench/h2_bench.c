@@ -0,0 +1,784 @@
+/*
+ * Connections and per-generation latency over HTTP/2 and over the HTTP/1.1
+ * fallback, against local TLS stand-ins for the generation host.
+ *
+ * Each generation is the native chain of ApiKeyCombiner.submit followed by
+ * the image fetch: POST /auth, POST /generate_image, GET /images/0.png,
+ * driven by http_engine with the options net_runtime_reset applies. One
+ * stand-in offers h2 over ALPN, the other only http/1.1, so the same client
+ * code shows both the multiplexed path and the fallback. Replies are sent
+ * after a fixed delay per endpoint; the run measures how requests share
+ * connections rather than how fast loopback is.
+ *
+ * The h2 stand-in speaks just enough of RFC 9113 for libcurl: SETTINGS and
+ * PING acknowledgements, HEADERS/DATA per stream and a static HPACK reply.
+ * It does not decode request headers; the GET is the stream whose HEADERS
+ * end it, and the two POSTs are told apart by their bodies.
+ *
+ *   h2_bench           full run
+ *   h2_bench --check   short run that fails on errors, on requests that
+ *                      do not use h2, or on more than one h2 connection
+ */
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include "http_engine.h"
+#include "net_runtime.h"
+
+#define SERVER_BUFFER_SIZE 32768
+#define SERVER_MAX_STREAMS 256
+#define IMAGE_SIZE 2048
+#define MAX_PARALLEL 10
+
+#define H2_DATA 0x0
+#define H2_HEADERS 0x1
+#define H2_RST_STREAM 0x3
+#define H2_SETTINGS 0x4
+#define H2_PING 0x6
+#define H2_GOAWAY 0x7
+
+#define H2_FLAG_END_STREAM 0x1
+#define H2_FLAG_ACK 0x1
+#define H2_FLAG_END_HEADERS 0x4
+#define H2_FLAG_PADDED 0x8
+
+typedef struct
+{
+    long auth_delay_ms;
+    long generate_delay_ms;
+    long image_delay_ms;
+    int rounds;
+} BenchConfig;
+
+static const BenchConfig FULL_RUN = {20, 100, 20, 50};
+static const BenchConfig CHECK_RUN = {2, 10, 2, 5};
+
+static const int PARALLEL[] = {1, MAX_PARALLEL};
+
+static long monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+}
+
+/* ---- Stand-in servers: TLS, one thread per connection, delayed replies ---- */
+
+typedef enum
+{
+    ROUTE_UNKNOWN,
+    ROUTE_AUTH,
+    ROUTE_GENERATE,
+    ROUTE_IMAGE
+} Route;
+
+typedef struct
+{
+    int offer_h2;
+    int listen_fd;
+    int port;
+    SSL_CTX *ctx;
+} Server;
+
+typedef struct
+{
+    unsigned int id;
+    Route route;
+    long reply_at_us;
+} Stream;
+
+typedef struct
+{
+    SSL *ssl;
+    int fd;
+    unsigned char buffer[SERVER_BUFFER_SIZE];
+    size_t used;
+    int preface_seen;
+    Stream streams[SERVER_MAX_STREAMS];
+    int stream_count;
+} Connection;
+
+static const char AUTH_BODY[] = "{\"signature\":\"bench-token\"}";
+static const char GENERATE_BODY[] = "{\"image_url\":\"/images/0.png\"}";
+static const unsigned char H2_PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+static char image_body[IMAGE_SIZE];
+static BenchConfig server_config;
+
+static const char *route_body(Route route, size_t *length)
+{
+    const char *body = route == ROUTE_AUTH ? AUTH_BODY : route == ROUTE_GENERATE ? GENERATE_BODY : image_body;
+    *length = route == ROUTE_IMAGE ? sizeof(image_body) : strlen(body);
+    return body;
+}
+
+static long route_delay_ms(Route route)
+{
+    return route == ROUTE_AUTH ? server_config.auth_delay_ms
+         : route == ROUTE_GENERATE ? server_config.generate_delay_ms
+                                   : server_config.image_delay_ms;
+}
+
+static int write_all(SSL *ssl, const void *data, size_t length)
+{
+    return SSL_write(ssl, data, (int)length) == (int)length;
+}
+
+static int write_frame(SSL *ssl, int type, int flags, unsigned int stream, const void *payload, size_t length)
+{
+    unsigned char frame[9 + IMAGE_SIZE];
+    if (length > IMAGE_SIZE)
+    {
+        return 0;
+    }
+
+    frame[0] = (unsigned char)(length >> 16);
+    frame[1] = (unsigned char)(length >> 8);
+    frame[2] = (unsigned char)length;
+    frame[3] = (unsigned char)type;
+    frame[4] = (unsigned char)flags;
+    frame[5] = (unsigned char)((stream >> 24) & 0x7F);
+    frame[6] = (unsigned char)(stream >> 16);
+    frame[7] = (unsigned char)(stream >> 8);
+    frame[8] = (unsigned char)stream;
+    if (length)
+    {
+        memcpy(frame + 9, payload, length);
+    }
+    return write_all(ssl, frame, 9 + length);
+}
+
+static Stream *find_stream(Connection *conn, unsigned int id)
+{
+    for (int i = 0; i < conn->stream_count; i++)
+    {
+        if (conn->streams[i].id == id)
+        {
+            return &conn->streams[i];
+        }
+    }
+    return NULL;
+}
+
+static void drop_stream(Connection *conn, Stream *stream)
+{
+    *stream = conn->streams[--conn->stream_count];
+}
+
+static void schedule_stream(Stream *stream)
+{
+    if (stream->route == ROUTE_UNKNOWN)
+    {
+        stream->route = ROUTE_AUTH;
+    }
+    stream->reply_at_us = monotonic_us() + route_delay_ms(stream->route) * 1000L;
+}
+
+/* :status 200 from the static table, then content-length as a literal
+ * with an indexed name (static entry 28), never indexed. */
+static int send_h2_reply(Connection *conn, const Stream *stream)
+{
+    size_t length;
+    const char *body = route_body(stream->route, &length);
+
+    unsigned char block[24] = {0x88, 0x0F, 0x0D};
+    int digits = snprintf((char *)block + 4, sizeof(block) - 4, "%zu", length);
+    block[3] = (unsigned char)digits;
+
+    return write_frame(conn->ssl, H2_HEADERS, H2_FLAG_END_HEADERS, stream->id, block, 4 + (size_t)digits) &&
+           write_frame(conn->ssl, H2_DATA, H2_FLAG_END_STREAM, stream->id, body, length);
+}
+
+/* Handles one complete frame; 0 closes the connection. */
+static int handle_h2_frame(Connection *conn, int type, int flags, unsigned int id, const unsigned char *payload,
+                           size_t length)
+{
+    Stream *stream = id ? find_stream(conn, id) : NULL;
+
+    switch (type)
+    {
+    case H2_SETTINGS:
+        return (flags & H2_FLAG_ACK) || write_frame(conn->ssl, H2_SETTINGS, H2_FLAG_ACK, 0, NULL, 0);
+    case H2_PING:
+        return (flags & H2_FLAG_ACK) || write_frame(conn->ssl, H2_PING, H2_FLAG_ACK, 0, payload, length);
+    case H2_GOAWAY:
+        return 0;
+    case H2_HEADERS:
+        if (!stream)
+        {
+            if (conn->stream_count == SERVER_MAX_STREAMS)
+            {
+                return 0;
+            }
+            stream = &conn->streams[conn->stream_count++];
+            memset(stream, 0, sizeof(*stream));
+            stream->id = id;
+        }
+        if (flags & H2_FLAG_END_STREAM)
+        {
+            stream->route = ROUTE_IMAGE;
+            schedule_stream(stream);
+        }
+        return 1;
+    case H2_DATA:
+        if (stream)
+        {
+            if (flags & H2_FLAG_PADDED && length > 0)
+            {
+                length = length - 1 > payload[0] ? length - 1 - payload[0] : 0;
+                payload++;
+            }
+            if (stream->route == ROUTE_UNKNOWN && length > 0)
+            {
+                stream->route = memmem(payload, length, "apiKey", 6) ? ROUTE_AUTH : ROUTE_GENERATE;
+            }
+            if (flags & H2_FLAG_END_STREAM)
+            {
+                schedule_stream(stream);
+            }
+        }
+        return 1;
+    case H2_RST_STREAM:
+        if (stream)
+        {
+            drop_stream(conn, stream);
+        }
+        return 1;
+    default:
+        /* WINDOW_UPDATE, PRIORITY and the rest need no answer here. */
+        return 1;
+    }
+}
+
+static int consume_h2(Connection *conn)
+{
+    size_t offset = 0;
+
+    if (!conn->preface_seen)
+    {
+        if (conn->used < sizeof(H2_PREFACE) - 1)
+        {
+            return 1;
+        }
+        if (memcmp(conn->buffer, H2_PREFACE, sizeof(H2_PREFACE) - 1) != 0)
+        {
+            return 0;
+        }
+        conn->preface_seen = 1;
+        offset = sizeof(H2_PREFACE) - 1;
+    }
+
+    while (conn->used - offset >= 9)
+    {
+        const unsigned char *frame = conn->buffer + offset;
+        size_t length = ((size_t)frame[0] << 16) | ((size_t)frame[1] << 8) | frame[2];
+        if (length > SERVER_BUFFER_SIZE - 9)
+        {
+            return 0;
+        }
+        if (conn->used - offset < 9 + length)
+        {
+            break;
+        }
+
+        unsigned int id = ((unsigned int)(frame[5] & 0x7F) << 24) | ((unsigned int)frame[6] << 16) |
+                          ((unsigned int)frame[7] << 8) | frame[8];
+        if (!handle_h2_frame(conn, frame[3], frame[4], id, frame + 9, length))
+        {
+            return 0;
+        }
+        offset += 9 + length;
+    }
+
+    memmove(conn->buffer, conn->buffer + offset, conn->used - offset);
+    conn->used -= offset;
+    return 1;
+}
+
+/* HTTP/1.1 requests are answered one at a time, as libcurl sends them. */
+static int consume_http1(Connection *conn)
+{
+    Stream *pending = conn->stream_count ? &conn->streams[0] : NULL;
+    if (pending)
+    {
+        return 1;
+    }
+
+    conn->buffer[conn->used] = '\0';
+    const char *head_end = strstr((const char *)conn->buffer, "\r\n\r\n");
+    if (!head_end)
+    {
+        return conn->used < SERVER_BUFFER_SIZE - 1;
+    }
+
+    size_t length = (size_t)(head_end + 4 - (const char *)conn->buffer);
+    const char *header = strcasestr((const char *)conn->buffer, "Content-Length:");
+    if (header && header < head_end)
+    {
+        length += strtoul(header + 15, NULL, 10);
+    }
+    if (length > conn->used)
+    {
+        return 1;
+    }
+
+    const char *request = (const char *)conn->buffer;
+    Stream *stream = &conn->streams[conn->stream_count++];
+    memset(stream, 0, sizeof(*stream));
+    stream->route = strncmp(request, "POST /auth ", 11) == 0             ? ROUTE_AUTH
+                  : strncmp(request, "POST /generate_image ", 21) == 0 ? ROUTE_GENERATE
+                                                                        : ROUTE_IMAGE;
+    schedule_stream(stream);
+
+    memmove(conn->buffer, conn->buffer + length, conn->used - length);
+    conn->used -= length;
+    return 1;
+}
+
+static int send_http1_reply(Connection *conn, const Stream *stream)
+{
+    size_t length;
+    const char *body = route_body(stream->route, &length);
+
+    char head[128];
+    int head_length = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n", length);
+    return write_all(conn->ssl, head, (size_t)head_length) && write_all(conn->ssl, body, length);
+}
+
+/* Sends due replies and returns the poll timeout until the next one. */
+static int send_due(Connection *conn, int h2, int *timeout_ms)
+{
+    *timeout_ms = 1000;
+    long now = monotonic_us();
+
+    for (int i = 0; i < conn->stream_count; i++)
+    {
+        Stream *stream = &conn->streams[i];
+        if (!stream->reply_at_us)
+        {
+            continue;
+        }
+        if (stream->reply_at_us <= now)
+        {
+            if (!(h2 ? send_h2_reply(conn, stream) : send_http1_reply(conn, stream)))
+            {
+                return 0;
+            }
+            drop_stream(conn, stream);
+            i--;
+            if (!h2 && !consume_http1(conn))
+            {
+                return 0;
+            }
+            continue;
+        }
+
+        long wait_ms = (stream->reply_at_us - now + 999) / 1000;
+        if (wait_ms < *timeout_ms)
+        {
+            *timeout_ms = (int)wait_ms;
+        }
+    }
+    return 1;
+}
+
+static void *serve_connection(void *arg)
+{
+    Connection *conn = (Connection *)arg;
+    int h2 = 0;
+
+    if (SSL_accept(conn->ssl) == 1)
+    {
+        const unsigned char *alpn = NULL;
+        unsigned int alpn_length = 0;
+        SSL_get0_alpn_selected(conn->ssl, &alpn, &alpn_length);
+        h2 = alpn_length == 2 && memcmp(alpn, "h2", 2) == 0;
+
+        int ok = !h2 || write_frame(conn->ssl, H2_SETTINGS, 0, 0, NULL, 0);
+        while (ok)
+        {
+            int timeout_ms;
+            if (!send_due(conn, h2, &timeout_ms))
+            {
+                break;
+            }
+
+            if (!SSL_pending(conn->ssl))
+            {
+                struct pollfd pfd = {conn->fd, POLLIN, 0};
+                if (poll(&pfd, 1, timeout_ms) <= 0)
+                {
+                    continue;
+                }
+            }
+
+            int n = SSL_read(conn->ssl, conn->buffer + conn->used, (int)(SERVER_BUFFER_SIZE - 1 - conn->used));
+            if (n <= 0)
+            {
+                break;
+            }
+            conn->used += (size_t)n;
+            ok = h2 ? consume_h2(conn) : consume_http1(conn);
+        }
+    }
+
+    SSL_free(conn->ssl);
+    close(conn->fd);
+    free(conn);
+    return NULL;
+}
+
+static void *accept_loop(void *arg)
+{
+    const Server *server = (const Server *)arg;
+
+    for (;;)
+    {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        Connection *conn = (Connection *)calloc(1, sizeof(Connection));
+        SSL *ssl = SSL_new(server->ctx);
+        pthread_t thread;
+        if (!conn || !ssl)
+        {
+            free(conn);
+            SSL_free(ssl);
+            close(fd);
+            continue;
+        }
+
+        SSL_set_fd(ssl, fd);
+        conn->ssl = ssl;
+        conn->fd = fd;
+        if (pthread_create(&thread, NULL, serve_connection, conn) != 0)
+        {
+            SSL_free(ssl);
+            close(fd);
+            free(conn);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    return NULL;
+}
+
+static int select_alpn(SSL *ssl, const unsigned char **out, unsigned char *out_length, const unsigned char *in,
+                       unsigned int in_length, void *arg)
+{
+    (void)ssl;
+    static const unsigned char with_h2[] = "\x02h2\x08http/1.1";
+    static const unsigned char http1_only[] = "\x08http/1.1";
+
+    const Server *server = (const Server *)arg;
+    const unsigned char *offer = server->offer_h2 ? with_h2 : http1_only;
+    unsigned int offer_length = server->offer_h2 ? sizeof(with_h2) - 1 : sizeof(http1_only) - 1;
+
+    unsigned char *selected = NULL;
+    if (SSL_select_next_proto(&selected, out_length, offer, offer_length, in, in_length) != OPENSSL_NPN_NEGOTIATED)
+    {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+/* A throwaway self-signed P-256 certificate; the client does not verify it. */
+static SSL_CTX *server_ctx(Server *server)
+{
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    X509 *cert = X509_new();
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    int ok = key && cert && ctx;
+
+    if (ok)
+    {
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600L);
+        X509_set_pubkey(cert, key);
+        X509_NAME *name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"127.0.0.1", -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+
+        ok = X509_sign(cert, key, EVP_sha256()) > 0 && SSL_CTX_use_certificate(ctx, cert) == 1 &&
+             SSL_CTX_use_PrivateKey(ctx, key) == 1;
+        SSL_CTX_set_alpn_select_cb(ctx, select_alpn, server);
+    }
+
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    if (!ok)
+    {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+static int start_server(Server *server, int offer_h2)
+{
+    server->offer_h2 = offer_h2;
+    server->ctx = server_ctx(server);
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (!server->ctx || server->listen_fd < 0)
+    {
+        return 0;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t addr_len = sizeof(addr);
+    if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, 64) != 0 ||
+        getsockname(server->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0)
+    {
+        close(server->listen_fd);
+        return 0;
+    }
+    server->port = ntohs(addr.sin_port);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, accept_loop, server) != 0)
+    {
+        return 0;
+    }
+    pthread_detach(thread);
+    return 1;
+}
+
+/* ---- Client: generations chained through http_engine ---- */
+
+typedef struct
+{
+    int stage;
+    int port;
+    long started_us;
+    char url[96];
+} Generation;
+
+static pthread_mutex_t run_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t run_cond = PTHREAD_COND_INITIALIZER;
+static int in_flight = 0;
+static int failures = 0;
+static long *latencies_us = NULL;
+static int latency_count = 0;
+
+static size_t discard_body(char *data, size_t size, size_t nmemb, void *user)
+{
+    (void)data;
+    (void)user;
+    return size * nmemb;
+}
+
+static void on_generation_step(CURL *curl, CURLcode res, void *user);
+
+static int submit_step(CURL *curl, Generation *gen)
+{
+    static const char *const paths[] = {"/auth", "/generate_image", "/images/0.png"};
+    static const char *const bodies[] = {"{\"apiKey\":\"bench\"}", "{\"prompt\":\"a lighthouse at dusk\"}", NULL};
+
+    net_runtime_reset(curl);
+    snprintf(gen->url, sizeof(gen->url), "https://127.0.0.1:%d%s", gen->port, paths[gen->stage]);
+    curl_easy_setopt(curl, CURLOPT_URL, gen->url);
+    if (bodies[gen->stage])
+    {
+        curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, bodies[gen->stage]);
+    }
+    /* The stand-in's certificate is generated per run. */
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_body);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    return http_engine_submit(curl, on_generation_step, gen);
+}
+
+static void finish_generation(int ok, long latency_us)
+{
+    pthread_mutex_lock(&run_lock);
+    if (ok)
+    {
+        latencies_us[latency_count++] = latency_us;
+    }
+    else
+    {
+        failures++;
+    }
+    in_flight--;
+    pthread_cond_signal(&run_cond);
+    pthread_mutex_unlock(&run_lock);
+}
+
+static void start_generation(int port)
+{
+    Generation *gen = (Generation *)calloc(1, sizeof(Generation));
+    CURL *curl = net_runtime_acquire();
+    if (gen && curl)
+    {
+        gen->port = port;
+        gen->started_us = monotonic_us();
+        if (submit_step(curl, gen))
+        {
+            return;
+        }
+    }
+
+    free(gen);
+    net_runtime_release(curl);
+    finish_generation(0, 0);
+}
+
+static void on_generation_step(CURL *curl, CURLcode res, void *user)
+{
+    Generation *gen = (Generation *)user;
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+    if (res == CURLE_OK && status == 200 && gen->stage < 2)
+    {
+        gen->stage++;
+        if (submit_step(curl, gen))
+        {
+            return;
+        }
+        res = CURLE_FAILED_INIT;
+    }
+
+    int ok = res == CURLE_OK && status == 200;
+    long latency_us = monotonic_us() - gen->started_us;
+    net_runtime_release(curl);
+    free(gen);
+    finish_generation(ok, latency_us);
+}
+
+static int compare_long(const void *a, const void *b)
+{
+    long x = *(const long *)a;
+    long y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+/* Runs rounds of `parallel` generations started together; 0 on failures,
+ * or in checking mode when h2 was expected and not used for every request
+ * or took more than one connection. */
+static int run_level(const char *label, int port, int parallel, int expect_h2, const BenchConfig *config,
+                     long *h2_connections, int check)
+{
+    int total = parallel * config->rounds;
+    latencies_us = (long *)calloc((size_t)total, sizeof(long));
+    if (!latencies_us)
+    {
+        return 0;
+    }
+    latency_count = 0;
+    failures = 0;
+
+    NetRuntimeStats before;
+    net_runtime_get_stats(&before);
+
+    for (int round = 0; round < config->rounds; round++)
+    {
+        pthread_mutex_lock(&run_lock);
+        in_flight = parallel;
+        pthread_mutex_unlock(&run_lock);
+
+        for (int i = 0; i < parallel; i++)
+        {
+            start_generation(port);
+        }
+
+        pthread_mutex_lock(&run_lock);
+        while (in_flight > 0)
+        {
+            pthread_cond_wait(&run_cond, &run_lock);
+        }
+        pthread_mutex_unlock(&run_lock);
+    }
+
+    NetRuntimeStats after;
+    net_runtime_get_stats(&after);
+
+    long requests = after.requests - before.requests;
+    long h2_requests = after.http2_requests - before.http2_requests;
+    long connections = after.connections - before.connections;
+
+    long p50 = 0;
+    long p99 = 0;
+    if (latency_count > 0)
+    {
+        qsort(latencies_us, (size_t)latency_count, sizeof(long), compare_long);
+        p50 = latencies_us[latency_count / 2];
+        p99 = latencies_us[(latency_count * 99) / 100];
+    }
+    free(latencies_us);
+    latencies_us = NULL;
+
+    printf("%-9s %2d parallel  %4d gens  connections %3ld  h2 requests %4ld/%-4ld  p50 %7.1f ms  p99 %7.1f ms  "
+           "failed %d\n",
+           label, parallel, total, connections, h2_requests, requests, p50 / 1000.0, p99 / 1000.0, failures);
+
+    if (failures)
+    {
+        return 0;
+    }
+    if (!check || !expect_h2)
+    {
+        return 1;
+    }
+    *h2_connections += connections;
+    return h2_requests == requests && *h2_connections <= 1;
+}
+
+int main(int argc, char **argv)
+{
+    int check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    const BenchConfig *config = check ? &CHECK_RUN : &FULL_RUN;
+    server_config = *config;
+    memset(image_body, 'x', sizeof(image_body));
+
+    static Server h2_server;
+    static Server http1_server;
+    if (!start_server(&h2_server, 1) || !start_server(&http1_server, 0) || !net_runtime_init())
+    {
+        ERR_print_errors_fp(stderr);
+        fprintf(stderr, "h2_bench: setup failed\n");
+        return 1;
+    }
+
+    int h2 = net_runtime_http2_supported();
+    if (!h2)
+    {
+        printf("libcurl was built without HTTP/2; both stand-ins run over HTTP/1.1\n");
+    }
+
+    int ok = 1;
+    long h2_connections = 0;
+    for (size_t i = 0; i < sizeof(PARALLEL) / sizeof(PARALLEL[0]); i++)
+    {
+        ok &= run_level("h2", h2_server.port, PARALLEL[i], h2, config, &h2_connections, check);
+    }
+    for (size_t i = 0; i < sizeof(PARALLEL) / sizeof(PARALLEL[0]); i++)
+    {
+        ok &= run_level("http/1.1", http1_server.port, PARALLEL[i], 0, config, &h2_connections, check);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,399 @@
+/*
+ * procfs_scanner against the fgets + strstr loops it replaced.
+ *
+ * First a randomised differential check: random pattern sets over random
+ * text, scanned from a buffer and from a pipe fed in small uneven writes so
+ * lines straddle read blocks, must report exactly the lines, pattern masks
+ * and line context that a per-line strstr over the whole line finds. Then a
+ * synthetic 10,000-line maps file with a few hook libraries and some lines
+ * longer than 512 bytes is scanned both ways; the old 512-byte fgets loop
+ * is expected to miss the needles that straddle its split.
+ *
+ *   procfs_bench           20,000 random cases, 200 scans per timing
+ *   procfs_bench --check   2,000 random cases, 20 scans per timing
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "procfs_scanner.h"
+
+#define MAPS_LINES 10000
+#define MAX_RANDOM_PATTERNS 12
+#define MAX_RANDOM_TEXT 3000
+#define MAX_HITS (MAX_RANDOM_TEXT + 1)
+
+/* The needles integrity_monitor.c looks for in /proc/self/maps. */
+static const char *const maps_needles[] = {"frida", "gum-js-loop"};
+
+/* A longer list, with more two-byte prefixes than the vector prefilter holds. */
+static const char *const many_needles[] = {
+    "frida", "gum-js-loop", "gmain", "linjector", "xposed", "substrate", "libriru", "zygisk",
+    "magisk", "lsposed", "edxp", "sandhook", "dobby", "libhooker", "il2cppdumper", "gdbserver",
+};
+
+#define COUNT_OF(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+typedef struct
+{
+    long line;
+    uint64_t patterns;
+    size_t length;
+    int truncated;
+    uint64_t text_hash;
+} Hit;
+
+typedef struct
+{
+    Hit hits[MAX_HITS];
+    int count;
+} HitList;
+
+static long monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static uint64_t hash_text(const char *text, size_t length)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < length; i++)
+    {
+        h = (h ^ (unsigned char)text[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static void record(HitList *list, long line, uint64_t patterns, const char *text, size_t length, int truncated)
+{
+    if (list->count < MAX_HITS)
+    {
+        list->hits[list->count++] = (Hit){line, patterns, length, truncated, hash_text(text, length)};
+    }
+}
+
+static int collect(const ProcfsHit *hit, void *user)
+{
+    record((HitList *)user, hit->line, hit->patterns, hit->text, hit->length, hit->truncated);
+    return 1;
+}
+
+/* The reference: whole lines, one strstr per pattern, context cut the way
+ * the scanner documents. */
+static void reference_scan(const char *const *patterns, int count, const char *data, size_t length, HitList *list)
+{
+    static char line_text[MAX_RANDOM_TEXT + 1];
+    const char *p = data;
+    const char *end = data + length;
+    long line = 1;
+
+    while (p < end)
+    {
+        const char *newline = memchr(p, '\n', (size_t)(end - p));
+        size_t line_length = newline ? (size_t)(newline - p) : (size_t)(end - p);
+        memcpy(line_text, p, line_length);
+        line_text[line_length] = '\0';
+
+        uint64_t mask = 0;
+        for (int k = 0; k < count; k++)
+        {
+            if (strstr(line_text, patterns[k]))
+            {
+                mask |= 1ULL << k;
+            }
+        }
+        if (mask)
+        {
+            int truncated = line_length > PROCFS_LINE_MAX - 1;
+            record(list, line, mask, line_text, truncated ? PROCFS_LINE_MAX - 1 : line_length, truncated);
+        }
+
+        line++;
+        p += line_length + 1;
+    }
+}
+
+/* Feeds data through a pipe in 1-40 byte writes and scans the read end. */
+static long scan_through_pipe(const ProcfsMatcher *matcher, const char *data, size_t length, HitList *list)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return -1;
+    }
+
+    pid_t writer = fork();
+    if (writer == 0)
+    {
+        close(fds[0]);
+        for (size_t i = 0; i < length;)
+        {
+            size_t chunk = 1 + (size_t)(rand() % 40);
+            chunk = chunk < length - i ? chunk : length - i;
+            if (write(fds[1], data + i, chunk) != (ssize_t)chunk)
+            {
+                _exit(1);
+            }
+            i += chunk;
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    long result = writer > 0 ? procfs_scan_fd(matcher, fds[0], collect, list) : -1;
+    close(fds[0]);
+    if (writer > 0)
+    {
+        waitpid(writer, NULL, 0);
+    }
+    return result;
+}
+
+static int same_hits(const HitList *a, const HitList *b)
+{
+    if (a->count != b->count)
+    {
+        return 0;
+    }
+    for (int i = 0; i < a->count; i++)
+    {
+        const Hit *x = &a->hits[i];
+        const Hit *y = &b->hits[i];
+        if (x->line != y->line || x->patterns != y->patterns || x->length != y->length ||
+            x->truncated != y->truncated || x->text_hash != y->text_hash)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Returns the number of mismatching cases. */
+static int random_check(int cases)
+{
+    /* Small alphabets so patterns overlap and share prefixes often;
+     * patterns never contain a newline. */
+    static const char alphabet[] = "abc/ \nfrgu";
+    static const char pattern_alphabet[] = "abc/ frgu";
+    static char text[MAX_RANDOM_TEXT + 1];
+    static HitList expected, from_buffer, from_pipe;
+    int mismatches = 0;
+
+    srand(7);
+    for (int c = 0; c < cases; c++)
+    {
+        char pattern_text[MAX_RANDOM_PATTERNS][8];
+        const char *patterns[MAX_RANDOM_PATTERNS];
+        int count = 1 + rand() % (c % 3 == 0 ? MAX_RANDOM_PATTERNS : 4);
+        for (int k = 0; k < count; k++)
+        {
+            int length = 1 + rand() % 4;
+            for (int j = 0; j < length; j++)
+            {
+                pattern_text[k][j] = pattern_alphabet[rand() % (sizeof(pattern_alphabet) - 1)];
+            }
+            pattern_text[k][length] = '\0';
+            patterns[k] = pattern_text[k];
+        }
+
+        size_t length = (size_t)(rand() % MAX_RANDOM_TEXT);
+        for (size_t i = 0; i < length; i++)
+        {
+            text[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        }
+        /* Now and then one line long enough to be truncated. */
+        if (length > PROCFS_LINE_MAX + 100 && rand() % 4 == 0)
+        {
+            memset(text + 50, 'a', PROCFS_LINE_MAX + 40);
+        }
+
+        ProcfsMatcher *matcher = procfs_matcher_create(patterns, count);
+        if (matcher == NULL)
+        {
+            fprintf(stderr, "case %d: procfs_matcher_create failed\n", c);
+            return cases;
+        }
+
+        expected.count = from_buffer.count = from_pipe.count = 0;
+        reference_scan(patterns, count, text, length, &expected);
+        procfs_scan_buffer(matcher, text, length, collect, &from_buffer);
+        scan_through_pipe(matcher, text, length, &from_pipe);
+
+        if (!same_hits(&expected, &from_buffer) || !same_hits(&expected, &from_pipe))
+        {
+            if (mismatches++ < 10)
+            {
+                fprintf(stderr, "case %d (%d patterns, %zu bytes): strstr %d lines, buffer %d, pipe %d\n", c, count,
+                        length, expected.count, from_buffer.count, from_pipe.count);
+            }
+        }
+        procfs_matcher_free(matcher);
+    }
+    return mismatches;
+}
+
+/* Writes a maps-like file and returns how many lines contain a needle. */
+static long write_synthetic_maps(const char *path, size_t *bytes)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    static const char *const libraries[] = {
+        "/apex/com.android.art/lib64/libart.so",
+        "/system/lib64/libc.so",
+        "/system/framework/arm64/boot-framework.oat",
+        "/data/app/~~abc==/com.example.playground-xyz==/base.apk",
+        "[anon:dalvik-main space (region space)]",
+        "",
+    };
+
+    long hooked = 0;
+    srand(1);
+    for (int i = 0; i < MAPS_LINES; i++)
+    {
+        char line[1024];
+        int length = snprintf(line, sizeof(line), "7f%08x-7f%08x %s %08x fd:%02x %-10d                 ",
+                              (unsigned)i * 4096u, (unsigned)i * 4096u + 4096u, i % 3 ? "r--p" : "r-xp",
+                              (unsigned)(rand() % 0x100000) * 4096u, rand() % 64, rand() % 999999);
+        const char *name = libraries[rand() % COUNT_OF(libraries)];
+
+        if (i % 997 == 0)
+        {
+            name = "/data/local/tmp/frida-agent-64.so";
+            hooked++;
+        }
+        else if (i % 1499 == 0)
+        {
+            name = "[anon:gum-js-loop]";
+            hooked++;
+        }
+        else if (i % 2003 == 0)
+        {
+            /* Pad the path so the needle straddles the 511-byte chunks a
+             * 512-byte fgets buffer splits the line into. */
+            while (length < 509)
+            {
+                line[length++] = 'x';
+            }
+            line[length] = '\0';
+            name = "frida-gadget.so";
+            hooked++;
+        }
+
+        fprintf(file, "%s%s\n", line, name);
+    }
+
+    *bytes = (size_t)ftell(file);
+    fclose(file);
+    return hooked;
+}
+
+static int count_hit(const ProcfsHit *hit, void *user)
+{
+    (void)hit;
+    (*(long *)user)++;
+    return 1;
+}
+
+/* The loop the maps and mounts checks used before procfs_scanner. */
+static long fgets_scan(const char *path, const char *const *patterns, int count)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    char line[512];
+    long lines = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        for (int k = 0; k < count; k++)
+        {
+            if (strstr(line, patterns[k]))
+            {
+                lines++;
+                break;
+            }
+        }
+    }
+    fclose(file);
+    return lines;
+}
+
+/* Times both scanners over the file; returns 0 if the scanner miscounted. */
+static int time_maps(const char *path, const char *const *patterns, int count, long expected, int scans)
+{
+    ProcfsMatcher *matcher = procfs_matcher_create(patterns, count);
+    if (matcher == NULL)
+    {
+        return 0;
+    }
+
+    long scanner_lines = 0;
+    long best_scanner = -1;
+    for (int s = 0; s < scans; s++)
+    {
+        long lines = 0;
+        long started = monotonic_us();
+        procfs_scan_path(matcher, path, count_hit, &lines);
+        long elapsed = monotonic_us() - started;
+        best_scanner = best_scanner < 0 || elapsed < best_scanner ? elapsed : best_scanner;
+        scanner_lines = lines;
+    }
+
+    long fgets_lines = 0;
+    long best_fgets = -1;
+    for (int s = 0; s < scans; s++)
+    {
+        long started = monotonic_us();
+        fgets_lines = fgets_scan(path, patterns, count);
+        long elapsed = monotonic_us() - started;
+        best_fgets = best_fgets < 0 || elapsed < best_fgets ? elapsed : best_fgets;
+    }
+
+    printf("%2d patterns: scanner %6ld us, %ld/%ld lines   fgets+strstr %6ld us, %ld/%ld lines\n", count,
+           best_scanner, scanner_lines, expected, best_fgets, fgets_lines, expected);
+    procfs_matcher_free(matcher);
+    return scanner_lines == expected;
+}
+
+int main(int argc, char **argv)
+{
+    int check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    int cases = check ? 2000 : 20000;
+    int scans = check ? 20 : 200;
+
+    int mismatches = random_check(cases);
+    printf("random: %d cases, %d mismatches against per-line strstr\n", cases, mismatches);
+
+    char path[] = "/tmp/procfs_bench_mapsXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    size_t bytes = 0;
+    long hooked = write_synthetic_maps(path, &bytes);
+    int ok = hooked > 0;
+    printf("maps: %d lines, %zu bytes, %ld hooked\n", MAPS_LINES, bytes, hooked);
+    if (ok)
+    {
+        ok &= time_maps(path, maps_needles, COUNT_OF(maps_needles), hooked, scans);
+        ok &= time_maps(path, many_needles, COUNT_OF(many_needles), hooked, scans);
+    }
+    unlink(path);
+
+    return ok && mismatches == 0 ? 0 : 1;
+}
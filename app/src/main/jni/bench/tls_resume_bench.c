@@ -0,0 +1,314 @@
+/*
+ * First-request latency after a process restart, full TLS handshake against
+ * a handshake resumed from the persisted session cache.
+ *
+ * A local TLS 1.3 stand-in answers POST /auth. Every sample is a fresh
+ * client process (this binary re-executed with --client), so libcurl's
+ * in-memory session cache starts empty and only tls_session_cache can offer
+ * a ticket. Full samples delete tls_sessions.bin before starting; resumed
+ * samples start from the file the previous client flushed. Each client
+ * reports whether SSL_session_reused held for its handshake, the handshake
+ * time and the total request time.
+ *
+ *   tls_resume_bench           100 samples of each
+ *   tls_resume_bench --check   5 of each; fails unless every full sample ran
+ *                              a full handshake and every resumed one resumed
+ */
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include "http_engine.h"
+#include "net_runtime.h"
+
+/* A name rather than an address, so the client sends SNI and the cache has
+ * a host to file tickets under. */
+#define BENCH_HOST "resume.bench.local"
+#define MAX_SAMPLES 100
+
+typedef struct
+{
+    int ok;
+    int resumed;
+    long handshake_us;
+    long total_us;
+} Sample;
+
+/* ---- Stand-in server: TLS 1.3, one thread per connection ---- */
+
+static SSL_CTX *server_ctx = NULL;
+
+static void *serve_connection(void *arg)
+{
+    SSL *ssl = (SSL *)arg;
+    static const char reply[] = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 27\r\n"
+                                "Connection: close\r\n\r\n{\"signature\":\"bench-token\"}";
+
+    if (SSL_accept(ssl) == 1)
+    {
+        char request[4096];
+        size_t used = 0;
+        int n;
+        while (used < sizeof(request) - 1 &&
+               (n = SSL_read(ssl, request + used, (int)(sizeof(request) - 1 - used))) > 0)
+        {
+            used += (size_t)n;
+            request[used] = '\0';
+            if (strstr(request, "\r\n\r\n"))
+            {
+                SSL_write(ssl, reply, (int)sizeof(reply) - 1);
+                break;
+            }
+        }
+        SSL_shutdown(ssl);
+    }
+
+    close(SSL_get_fd(ssl));
+    SSL_free(ssl);
+    return NULL;
+}
+
+static void *accept_loop(void *arg)
+{
+    int listen_fd = (int)(long)arg;
+
+    for (;;)
+    {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        SSL *ssl = SSL_new(server_ctx);
+        pthread_t thread;
+        if (!ssl)
+        {
+            close(fd);
+            continue;
+        }
+        SSL_set_fd(ssl, fd);
+        if (pthread_create(&thread, NULL, serve_connection, ssl) != 0)
+        {
+            SSL_free(ssl);
+            close(fd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    return NULL;
+}
+
+/* A throwaway self-signed P-256 certificate; the client does not verify it.
+ * Tickets stay valid for the whole run because the server, and so its
+ * ticket keys, outlive every client. */
+static int start_server(void)
+{
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    X509 *cert = X509_new();
+    server_ctx = SSL_CTX_new(TLS_server_method());
+    int ok = key && cert && server_ctx;
+
+    if (ok)
+    {
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600L);
+        X509_set_pubkey(cert, key);
+        X509_NAME *name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)BENCH_HOST, -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+
+        ok = X509_sign(cert, key, EVP_sha256()) > 0 && SSL_CTX_use_certificate(server_ctx, cert) == 1 &&
+             SSL_CTX_use_PrivateKey(server_ctx, key) == 1 &&
+             SSL_CTX_set_min_proto_version(server_ctx, TLS1_3_VERSION) == 1;
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+
+    int listen_fd = ok ? socket(AF_INET, SOCK_STREAM, 0) : -1;
+    if (listen_fd < 0)
+    {
+        return 0;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t addr_len = sizeof(addr);
+    pthread_t thread;
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0 ||
+        getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) != 0 ||
+        pthread_create(&thread, NULL, accept_loop, (void *)(long)listen_fd) != 0)
+    {
+        close(listen_fd);
+        return 0;
+    }
+    pthread_detach(thread);
+    return ntohs(addr.sin_port);
+}
+
+/* ---- Client: one request per process, as the app's first after a restart ---- */
+
+static size_t discard_body(char *data, size_t size, size_t nmemb, void *user)
+{
+    (void)data;
+    (void)user;
+    return size * nmemb;
+}
+
+static int run_client(int port, const char *cache_dir)
+{
+    net_runtime_configure_cache(cache_dir);
+
+    CURL *curl = net_runtime_acquire();
+    if (!curl)
+    {
+        printf("0 0 0 0\n");
+        return 1;
+    }
+
+    char url[128];
+    char resolve[128];
+    snprintf(url, sizeof(url), "https://%s:%d/auth", BENCH_HOST, port);
+    snprintf(resolve, sizeof(resolve), "%s:%d:127.0.0.1", BENCH_HOST, port);
+    struct curl_slist *resolves = curl_slist_append(NULL, resolve);
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_RESOLVE, resolves);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, "");
+    /* The stand-in's certificate is generated per run. */
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_body);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+
+    CURLcode res = http_engine_perform(curl);
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_slist_free_all(resolves);
+    net_runtime_release(curl);
+    net_runtime_flush_cache();
+
+    NetRuntimeStats stats;
+    net_runtime_get_stats(&stats);
+    printf("%d %ld %ld %ld\n", res == CURLE_OK && status == 200 && stats.tls_resumed + stats.tls_full == 1,
+           stats.tls_resumed, stats.tls_handshake_us, stats.first_request_us);
+    return 0;
+}
+
+static int run_sample(const char *self, int port, const char *cache_dir, Sample *sample)
+{
+    char command[PATH_MAX * 3];
+    snprintf(command, sizeof(command), "'%s' --client %d '%s'", self, port, cache_dir);
+
+    FILE *client = popen(command, "r");
+    if (!client)
+    {
+        return 0;
+    }
+    int fields = fscanf(client, "%d %d %ld %ld", &sample->ok, &sample->resumed, &sample->handshake_us,
+                        &sample->total_us);
+    return pclose(client) == 0 && fields == 4 && sample->ok;
+}
+
+static int compare_long(const void *a, const void *b)
+{
+    long x = *(const long *)a;
+    long y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+static long percentile(long *values, int count, int pct)
+{
+    qsort(values, (size_t)count, sizeof(long), compare_long);
+    return values[(count * pct) / 100];
+}
+
+/* Returns how many samples handshook the way the label expects. */
+static int report(const char *label, const Sample *samples, int count, int want_resumed)
+{
+    long handshakes[MAX_SAMPLES];
+    long totals[MAX_SAMPLES];
+    int matched = 0;
+    for (int i = 0; i < count; i++)
+    {
+        handshakes[i] = samples[i].handshake_us;
+        totals[i] = samples[i].total_us;
+        matched += samples[i].resumed == want_resumed;
+    }
+
+    printf("%-8s %3d/%-3d %-8s  handshake p50 %7.1f us  p99 %7.1f us  first request p50 %7.1f us  p99 %7.1f us\n",
+           label, matched, count, want_resumed ? "resumed" : "full", (double)percentile(handshakes, count, 50),
+           (double)percentile(handshakes, count, 99), (double)percentile(totals, count, 50),
+           (double)percentile(totals, count, 99));
+    return matched;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && strcmp(argv[1], "--client") == 0)
+    {
+        return run_client(atoi(argv[2]), argv[3]);
+    }
+
+    int check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    int count = check ? 5 : MAX_SAMPLES;
+
+    char self[PATH_MAX];
+    ssize_t self_len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    char cache_dir[] = "/tmp/tls_resume_bench.XXXXXX";
+    int port = start_server();
+    if (self_len <= 0 || !mkdtemp(cache_dir) || !port)
+    {
+        ERR_print_errors_fp(stderr);
+        fprintf(stderr, "tls_resume_bench: setup failed\n");
+        return 1;
+    }
+    self[self_len] = '\0';
+
+    char cache_file[PATH_MAX];
+    snprintf(cache_file, sizeof(cache_file), "%s/tls_sessions.bin", cache_dir);
+
+    static Sample full[MAX_SAMPLES];
+    static Sample resumed[MAX_SAMPLES];
+    int ok = 1;
+    for (int i = 0; i < count && ok; i++)
+    {
+        unlink(cache_file);
+        ok = run_sample(self, port, cache_dir, &full[i]);
+    }
+    for (int i = 0; i < count && ok; i++)
+    {
+        ok = run_sample(self, port, cache_dir, &resumed[i]);
+    }
+
+    unlink(cache_file);
+    rmdir(cache_dir);
+    if (!ok)
+    {
+        fprintf(stderr, "tls_resume_bench: a client request failed\n");
+        return 1;
+    }
+
+    int full_matched = report("cold", full, count, 0);
+    int resumed_matched = report("restart", resumed, count, 1);
+    if (!check)
+    {
+        return 0;
+    }
+    return full_matched == count && resumed_matched == count ? 0 : 1;
+}
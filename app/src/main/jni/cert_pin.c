@@ -0,0 +1,337 @@
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <openssl/x509.h>
+#include <openssl/x509_vfy.h>
+#include <openssl/x509v3.h>
+#include "cert_pin.h"
+#include "codec.h"
+#include "net_runtime.h"
+
+#define PIN_PREFIX "sha256/"
+#define PIN_MAX 128
+
+#define VERDICT_FILE "cert_verdict"
+#define TRUSTED_TTL_S (24 * 3600)
+#define MISMATCH_TTL_S 3600
+#define PROBE_TIMEOUT_MS 5000
+
+static pthread_once_t index_once = PTHREAD_ONCE_INIT;
+static int pin_index = -1;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static char cache_path[PATH_MAX];
+
+#define MAX_PINNED_HOSTS 4
+
+typedef struct
+{
+    char host[256];
+    char pin[PIN_MAX];
+} PinnedHost;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static PinnedHost pinned_hosts[MAX_PINNED_HOSTS];
+static int pinned_count = 0;
+
+static long verified_handshakes = 0;
+
+static void init_index(void)
+{
+    pin_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+}
+
+static int spki_pin(X509 *cert, char *out, size_t out_size)
+{
+    unsigned char *der = NULL;
+    int der_len = i2d_X509_PUBKEY(X509_get_X509_PUBKEY(cert), &der);
+    if (der_len <= 0)
+    {
+        return 0;
+    }
+
+    unsigned char md[SHA256_DIGEST_LENGTH];
+    SHA256(der, (size_t)der_len, md);
+    OPENSSL_free(der);
+
+    char encoded[PIN_MAX];
+    codec_base64_encode(md, sizeof(md), encoded);
+    return snprintf(out, out_size, "%s%s", PIN_PREFIX, encoded) < (int)out_size;
+}
+
+/* The errors OpenSSL reports when the chain simply ends without a local
+ * trust anchor. */
+static int missing_anchor(int error)
+{
+    return error == X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY ||
+           error == X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT ||
+           error == X509_V_ERR_SELF_SIGNED_CERT_IN_CHAIN;
+}
+
+/* Fills expected with the pin that applies to this handshake: the handle's
+ * own, or the one registered for the host named in the SNI. */
+static int expected_pin(SSL *ssl, CertPin *pin, char *expected, size_t size)
+{
+    if (pin)
+    {
+        snprintf(expected, size, "%s", pin->expected);
+        return 1;
+    }
+
+    const char *host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    int found = 0;
+
+    pthread_mutex_lock(&registry_lock);
+    for (int i = 0; host && i < pinned_count; i++)
+    {
+        if (strcasecmp(host, pinned_hosts[i].host) == 0)
+        {
+            snprintf(expected, size, "%s", pinned_hosts[i].pin);
+            found = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    return found;
+}
+
+static int ssl_verify_callback(int preverify_ok, X509_STORE_CTX *ctx)
+{
+    SSL *ssl = X509_STORE_CTX_get_ex_data(ctx, SSL_get_ex_data_X509_STORE_CTX_idx());
+    if (!ssl)
+    {
+        return 0;
+    }
+
+    CertPin *pin = SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), pin_index);
+    char expected[PIN_MAX];
+    if (!expected_pin(ssl, pin, expected, sizeof(expected)))
+    {
+        /* Not a pinned host; left to the handle's own settings. */
+        return 1;
+    }
+
+    int ok = preverify_ok || missing_anchor(X509_STORE_CTX_get_error(ctx));
+
+    /* Callbacks for a partial chain may skip depth 1, so look it up from
+     * the leaf, which is always reported last. */
+    if (ok && X509_STORE_CTX_get_error_depth(ctx) == 0)
+    {
+        STACK_OF(X509) *chain = X509_STORE_CTX_get0_chain(ctx);
+        X509 *leaf = X509_STORE_CTX_get_current_cert(ctx);
+        X509 *intermediate = chain && sk_X509_num(chain) > 1 ? sk_X509_value(chain, 1) : NULL;
+        const char *host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+
+        char actual[PIN_MAX];
+        ok = intermediate && spki_pin(intermediate, actual, sizeof(actual)) && strcmp(actual, expected) == 0 &&
+             (!host || X509_check_host(leaf, host, 0, 0, NULL) == 1);
+
+        if (ok)
+        {
+            __atomic_add_fetch(&verified_handshakes, 1, __ATOMIC_RELAXED);
+            if (pin)
+            {
+                pin->matched = 1;
+            }
+        }
+    }
+
+    if (!ok && pin)
+    {
+        pin->rejected = 1;
+    }
+    return ok;
+}
+
+void cert_pin_attach(SSL_CTX *ctx, CertPin *pin)
+{
+    pthread_once(&index_once, init_index);
+
+    if (pin)
+    {
+        pin->matched = 0;
+        pin->rejected = 0;
+    }
+    SSL_CTX_set_ex_data(ctx, pin_index, pin);
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, ssl_verify_callback);
+}
+
+int cert_pin_register(const char *host, const char *pin)
+{
+    if (strlen(host) >= sizeof(pinned_hosts[0].host) || strlen(pin) >= PIN_MAX)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&registry_lock);
+    int slot = 0;
+    while (slot < pinned_count && strcasecmp(pinned_hosts[slot].host, host) != 0)
+    {
+        slot++;
+    }
+
+    int ok = slot < MAX_PINNED_HOSTS;
+    if (ok)
+    {
+        snprintf(pinned_hosts[slot].host, sizeof(pinned_hosts[slot].host), "%s", host);
+        snprintf(pinned_hosts[slot].pin, sizeof(pinned_hosts[slot].pin), "%s", pin);
+        if (slot == pinned_count)
+        {
+            pinned_count++;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    return ok;
+}
+
+int cert_pin_registered(const char *host)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&registry_lock);
+    for (int i = 0; i < pinned_count && !found; i++)
+    {
+        found = strcasecmp(host, pinned_hosts[i].host) == 0;
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    return found;
+}
+
+long cert_pin_verified_count(void)
+{
+    return __atomic_load_n(&verified_handshakes, __ATOMIC_RELAXED);
+}
+
+void cert_pin_configure_cache(const char *cache_dir)
+{
+    pthread_mutex_lock(&cache_lock);
+    snprintf(cache_path, sizeof(cache_path), "%s/%s", cache_dir, VERDICT_FILE);
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/* The cache file holds one line: "<pin> <expiry> <verdict>". */
+static int load_verdict(const char *pin, CertPinVerdict *verdict)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&cache_lock);
+    FILE *fp = cache_path[0] ? fopen(cache_path, "r") : NULL;
+    if (fp)
+    {
+        char stored_pin[PIN_MAX];
+        long expiry = 0;
+        int stored = CERT_PIN_ERROR;
+        if (fscanf(fp, "%127s %ld %d", stored_pin, &expiry, &stored) == 3 &&
+            strcmp(stored_pin, pin) == 0 && (long)time(NULL) < expiry &&
+            (stored == CERT_PIN_TRUSTED || stored == CERT_PIN_MISMATCH))
+        {
+            *verdict = (CertPinVerdict)stored;
+            found = 1;
+        }
+        fclose(fp);
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    return found;
+}
+
+static void store_verdict(const char *pin, CertPinVerdict verdict)
+{
+    pthread_mutex_lock(&cache_lock);
+    if (cache_path[0])
+    {
+        char tmp_path[PATH_MAX + 8];
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache_path);
+
+        FILE *fp = fopen(tmp_path, "w");
+        if (fp)
+        {
+            long ttl = verdict == CERT_PIN_TRUSTED ? TRUSTED_TTL_S : MISMATCH_TTL_S;
+            fprintf(fp, "%s %ld %d\n", pin, (long)time(NULL) + ttl, (int)verdict);
+            int ok = fflush(fp) == 0;
+            fclose(fp);
+
+            if (ok)
+            {
+                rename(tmp_path, cache_path);
+            }
+            else
+            {
+                remove(tmp_path);
+            }
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+CertPinVerdict cert_pin_probe(const char *host, const char *pin, int *from_cache)
+{
+    CertPinVerdict verdict = CERT_PIN_ERROR;
+    if (from_cache)
+    {
+        *from_cache = 0;
+    }
+
+    if (strlen(pin) >= PIN_MAX)
+    {
+        return CERT_PIN_ERROR;
+    }
+    if (load_verdict(pin, &verdict))
+    {
+        if (from_cache)
+        {
+            *from_cache = 1;
+        }
+        return verdict;
+    }
+
+    CURL *curl = net_runtime_acquire();
+    if (!curl)
+    {
+        return CERT_PIN_ERROR;
+    }
+
+    char url[300];
+    snprintf(url, sizeof(url), "https://%s/", host);
+
+    CertPin check = {pin, 0, 0, 1};
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_CONNECT_ONLY, 1L);
+    curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+    curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, (long)PROBE_TIMEOUT_MS);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)PROBE_TIMEOUT_MS);
+    net_runtime_pin(curl, &check);
+
+    CURLcode res = net_runtime_perform(curl);
+    if (res == CURLE_OK && check.matched)
+    {
+        verdict = CERT_PIN_TRUSTED;
+    }
+    else if (check.rejected || res == CURLE_PEER_FAILED_VERIFICATION)
+    {
+        /* Wrong intermediate, a bad chain or a host name that does not
+         * match; anything else is a network failure and is not cached. */
+        verdict = CERT_PIN_MISMATCH;
+    }
+
+    /* A connect-only handle keeps its socket open, so it is not pooled. */
+    curl_easy_cleanup(curl);
+
+    if (verdict != CERT_PIN_ERROR)
+    {
+        store_verdict(pin, verdict);
+    }
+    return verdict;
+}
@@ -0,0 +1,58 @@
+#ifndef CERT_PIN_H
+#define CERT_PIN_H
+
+#include <openssl/ssl.h>
+
+/*
+ * Intermediate certificate pinning on top of OpenSSL's chain checks. There
+ * is no system trust store visible to OpenSSL here, so a missing local issuer
+ * is tolerated; the leaf signature, validity dates and host name are still
+ * verified, and the certificate at depth 1 must carry the pinned SPKI.
+ *
+ * The check runs inside the request's own handshake. A connection only
+ * enters libcurl's shared pool after passing it, so reused connections and
+ * HTTP/2 streams need no further check.
+ */
+
+typedef struct
+{
+    /* "sha256/<base64 SHA-256 of the SubjectPublicKeyInfo>", as OkHttp uses. */
+    const char *expected;
+    /* Set once a handshake has seen the pinned intermediate, or refused
+     * the chain. */
+    int matched;
+    int rejected;
+    /* Skip session resumption, which would bypass certificate checks. */
+    int full_handshake;
+} CertPin;
+
+typedef enum
+{
+    CERT_PIN_ERROR = -1,
+    CERT_PIN_TRUSTED = 0,
+    CERT_PIN_MISMATCH = 1
+} CertPinVerdict;
+
+/* Installs the verify callback; pin may be NULL, leaving only the
+ * registered host pinned. */
+void cert_pin_attach(SSL_CTX *ctx, CertPin *pin);
+
+/* Pins host for every handshake that goes through net_runtime; returns 0
+ * when the table is full. Other hosts keep whatever verification their
+ * handle asks for. */
+int cert_pin_register(const char *host, const char *pin);
+
+/* Whether handshakes with host are checked against a registered pin. */
+int cert_pin_registered(const char *host);
+
+/* Handshakes that passed a pin check since start-up. */
+long cert_pin_verified_count(void);
+
+void cert_pin_configure_cache(const char *cache_dir);
+
+/* Runs a TLS handshake with no request against host and checks the pin.
+ * Trusted and mismatch verdicts are cached per pin until they expire;
+ * from_cache, if not NULL, reports whether the cache answered. */
+CertPinVerdict cert_pin_probe(const char *host, const char *pin, int *from_cache);
+
+#endif
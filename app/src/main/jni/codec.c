@@ -0,0 +1,710 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include "codec.h"
+
+#if defined(CODEC_SCALAR_ONLY)
+/* Reference build for the host equality checks: no SIMD kernels. */
+#elif defined(__x86_64__) || defined(__i386__)
+#define CODEC_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CODEC_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* Keystreams up to this period are materialised once and XORed in blocks. */
+#define XOR_MAX_PERIOD 1024
+/* Headroom so short periods still fill a stream of at least one vector. */
+#define XOR_BLOCK 32
+
+typedef struct
+{
+    const char *name;
+    /* Block kernels: consume as much input as they can and return the number
+     * of input bytes/characters handled, leaving the tail to the scalar code.
+     * A decoder returns (size_t)-1 when it meets an invalid character. */
+    size_t (*base64_encode)(const unsigned char *in, size_t len, char *out);
+    size_t (*base64_decode)(const char *in, size_t len, unsigned char *out);
+    size_t (*hex_decode)(const char *in, size_t len, unsigned char *out);
+    void (*xor_block)(unsigned char *data, const unsigned char *stream, size_t len);
+} CodecOps;
+
+static const char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* 0xFF marks characters outside the alphabet. */
+static unsigned char base64_values[256];
+static unsigned char hex_values[256];
+
+static pthread_once_t codec_once = PTHREAD_ONCE_INIT;
+static CodecOps ops;
+
+/* ---- scalar ---------------------------------------------------------- */
+
+static size_t scalar_base64_encode(const unsigned char *in, size_t len, char *out)
+{
+    (void)in;
+    (void)len;
+    (void)out;
+    return 0;
+}
+
+static size_t scalar_decode(const char *in, size_t len, unsigned char *out)
+{
+    (void)in;
+    (void)len;
+    (void)out;
+    return 0;
+}
+
+static void scalar_xor_block(unsigned char *data, const unsigned char *stream, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        data[i] ^= stream[i];
+    }
+}
+
+/* ---- x86: SSSE3 and AVX2 --------------------------------------------- */
+
+#ifdef CODEC_X86
+
+__attribute__((target("ssse3"))) static __m128i ssse3_base64_lookup(__m128i indices)
+{
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+
+    const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                        '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(shift, result), indices);
+}
+
+__attribute__((target("ssse3"))) static size_t ssse3_base64_encode(const unsigned char *in, size_t len, char *out)
+{
+    size_t i = 0;
+    size_t o = 0;
+
+    /* Each step reads 16 bytes but only consumes 12. */
+    for (; i + 16 <= len; i += 12, o += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        v = _mm_shuffle_epi8(v, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+        __m128i t0 = _mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00));
+        __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        __m128i t2 = _mm_and_si128(v, _mm_set1_epi32(0x003f03f0));
+        __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+
+        _mm_storeu_si128((__m128i *)(out + o), ssse3_base64_lookup(_mm_or_si128(t1, t3)));
+    }
+
+    return i;
+}
+
+__attribute__((target("ssse3"))) static size_t ssse3_base64_decode(const char *in, size_t len, unsigned char *out)
+{
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2f);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t i = 0;
+    size_t o = 0;
+
+    for (; i + 16 <= len; i += 16, o += 12)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+        __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(v, 4), mask_2f);
+        __m128i lo_nibbles = _mm_and_si128(v, mask_2f);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF)
+        {
+            return (size_t)-1;
+        }
+
+        __m128i eq_2f = _mm_cmpeq_epi8(v, mask_2f);
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+        v = _mm_add_epi8(v, roll);
+
+        __m128i merged = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        merged = _mm_shuffle_epi8(merged, pack);
+
+        unsigned char block[16];
+        _mm_storeu_si128((__m128i *)block, merged);
+        memcpy(out + o, block, 12);
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2"))) static size_t avx2_base64_decode(const char *in, size_t len, unsigned char *out)
+{
+    const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t i = 0;
+    size_t o = 0;
+
+    for (; i + 32 <= len; i += 32, o += 24)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+
+        __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(v, 4), mask_2f);
+        __m256i lo_nibbles = _mm256_and_si256(v, mask_2f);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+
+        if (!_mm256_testz_si256(lo, hi))
+        {
+            return (size_t)-1;
+        }
+
+        __m256i eq_2f = _mm256_cmpeq_epi8(v, mask_2f);
+        __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+        v = _mm256_add_epi8(v, roll);
+
+        __m256i merged = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack);
+        merged = _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+        unsigned char block[32];
+        _mm256_storeu_si256((__m256i *)block, merged);
+        memcpy(out + o, block, 24);
+    }
+
+    return i;
+}
+
+/* Maps 16 hex digits to nibbles; returns 0 if any character is not hex. */
+__attribute__((target("ssse3"))) static int ssse3_hex_nibbles(__m128i v, __m128i *nibbles)
+{
+    __m128i digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+
+    if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xFFFF)
+    {
+        return 0;
+    }
+
+    *nibbles = _mm_or_si128(_mm_and_si128(is_digit, digit),
+                            _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+    return 1;
+}
+
+__attribute__((target("ssse3"))) static size_t ssse3_hex_decode(const char *in, size_t len, unsigned char *out)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i nibbles;
+        if (!ssse3_hex_nibbles(_mm_loadu_si128((const __m128i *)(in + i)), &nibbles))
+        {
+            return (size_t)-1;
+        }
+
+        __m128i bytes = _mm_maddubs_epi16(nibbles, _mm_set1_epi16(0x0110));
+        _mm_storel_epi64((__m128i *)(out + i / 2), _mm_packus_epi16(bytes, bytes));
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2"))) static size_t avx2_hex_decode(const char *in, size_t len, unsigned char *out)
+{
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+
+        __m256i digit = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+        __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+
+        __m256i letter = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+
+        if (_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_letter)) != -1)
+        {
+            return (size_t)-1;
+        }
+
+        __m256i nibbles = _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+                                          _mm256_and_si256(is_letter, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+        __m256i bytes = _mm256_maddubs_epi16(nibbles, _mm256_set1_epi16(0x0110));
+        bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(bytes, bytes), 0x08);
+
+        _mm_storeu_si128((__m128i *)(out + i / 2), _mm256_castsi256_si128(bytes));
+    }
+
+    return i;
+}
+
+__attribute__((target("ssse3"))) static void ssse3_xor_block(unsigned char *data, const unsigned char *stream, size_t len)
+{
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i s = _mm_loadu_si128((const __m128i *)(stream + i));
+        _mm_storeu_si128((__m128i *)(data + i), _mm_xor_si128(d, s));
+    }
+    scalar_xor_block(data + i, stream + i, len - i);
+}
+
+__attribute__((target("avx2"))) static void avx2_xor_block(unsigned char *data, const unsigned char *stream, size_t len)
+{
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
+    {
+        __m256i d = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i s = _mm256_loadu_si256((const __m256i *)(stream + i));
+        _mm256_storeu_si256((__m256i *)(data + i), _mm256_xor_si256(d, s));
+    }
+    scalar_xor_block(data + i, stream + i, len - i);
+}
+
+#endif
+
+/* ---- ARM: NEON ------------------------------------------------------- */
+
+#ifdef CODEC_NEON
+
+static int neon_all_set(uint8x16_t mask)
+{
+#ifdef __aarch64__
+    return vminvq_u8(mask) == 0xFF;
+#else
+    uint8x8_t m = vand_u8(vget_low_u8(mask), vget_high_u8(mask));
+    m = vpmin_u8(m, m);
+    m = vpmin_u8(m, m);
+    m = vpmin_u8(m, m);
+    return vget_lane_u8(m, 0) == 0xFF;
+#endif
+}
+
+static size_t neon_hex_decode(const char *in, size_t len, unsigned char *out)
+{
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32)
+    {
+        uint8x16x2_t pair = vld2q_u8((const uint8_t *)(in + i));
+        uint8x16_t nibbles[2];
+
+        for (int k = 0; k < 2; k++)
+        {
+            uint8x16_t digit = vsubq_u8(pair.val[k], vdupq_n_u8('0'));
+            uint8x16_t is_digit = vcleq_u8(digit, vdupq_n_u8(9));
+
+            uint8x16_t letter = vsubq_u8(vorrq_u8(pair.val[k], vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+            uint8x16_t is_letter = vcleq_u8(letter, vdupq_n_u8(5));
+
+            if (!neon_all_set(vorrq_u8(is_digit, is_letter)))
+            {
+                return (size_t)-1;
+            }
+
+            nibbles[k] = vbslq_u8(is_digit, digit, vaddq_u8(letter, vdupq_n_u8(10)));
+        }
+
+        vst1q_u8(out + i / 2, vorrq_u8(vshlq_n_u8(nibbles[0], 4), nibbles[1]));
+    }
+
+    return i;
+}
+
+static void neon_xor_block(unsigned char *data, const unsigned char *stream, size_t len)
+{
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        vst1q_u8(data + i, veorq_u8(vld1q_u8(data + i), vld1q_u8(stream + i)));
+    }
+    scalar_xor_block(data + i, stream + i, len - i);
+}
+
+#ifdef __aarch64__
+
+static uint8x16x4_t neon_table(const unsigned char *table)
+{
+    uint8x16x4_t t;
+    t.val[0] = vld1q_u8(table);
+    t.val[1] = vld1q_u8(table + 16);
+    t.val[2] = vld1q_u8(table + 32);
+    t.val[3] = vld1q_u8(table + 48);
+    return t;
+}
+
+static size_t neon_base64_encode(const unsigned char *in, size_t len, char *out)
+{
+    uint8x16x4_t alphabet = neon_table((const unsigned char *)base64_alphabet);
+    uint8x16_t mask = vdupq_n_u8(0x3F);
+
+    size_t i = 0;
+    size_t o = 0;
+
+    for (; i + 48 <= len; i += 48, o += 64)
+    {
+        uint8x16x3_t src = vld3q_u8(in + i);
+        uint8x16x4_t idx;
+
+        idx.val[0] = vshrq_n_u8(src.val[0], 2);
+        idx.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(src.val[0], 4), vshrq_n_u8(src.val[1], 4)), mask);
+        idx.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(src.val[1], 2), vshrq_n_u8(src.val[2], 6)), mask);
+        idx.val[3] = vandq_u8(src.val[2], mask);
+
+        for (int k = 0; k < 4; k++)
+        {
+            idx.val[k] = vqtbl4q_u8(alphabet, idx.val[k]);
+        }
+
+        vst4q_u8((uint8_t *)(out + o), idx);
+    }
+
+    return i;
+}
+
+static size_t neon_base64_decode(const char *in, size_t len, unsigned char *out)
+{
+    uint8x16x4_t low = neon_table(base64_values);
+    uint8x16x4_t high = neon_table(base64_values + 64);
+
+    size_t i = 0;
+    size_t o = 0;
+
+    for (; i + 64 <= len; i += 64, o += 48)
+    {
+        uint8x16x4_t src = vld4q_u8((const uint8_t *)(in + i));
+        uint8x16_t bad = vdupq_n_u8(0);
+
+        for (int k = 0; k < 4; k++)
+        {
+            uint8x16_t c = src.val[k];
+            uint8x16_t v = vqtbl4q_u8(low, c);
+            v = vqtbx4q_u8(v, high, vsubq_u8(c, vdupq_n_u8(64)));
+
+            bad = vorrq_u8(bad, vorrq_u8(vcgeq_u8(c, vdupq_n_u8(128)), v));
+            src.val[k] = v;
+        }
+
+        /* Valid values are below 64, so bit 6 or 7 set anywhere is an error. */
+        if (vmaxvq_u8(bad) >= 64)
+        {
+            return (size_t)-1;
+        }
+
+        uint8x16x3_t dst;
+        dst.val[0] = vorrq_u8(vshlq_n_u8(src.val[0], 2), vshrq_n_u8(src.val[1], 4));
+        dst.val[1] = vorrq_u8(vshlq_n_u8(src.val[1], 4), vshrq_n_u8(src.val[2], 2));
+        dst.val[2] = vorrq_u8(vshlq_n_u8(src.val[2], 6), src.val[3]);
+
+        vst3q_u8(out + o, dst);
+    }
+
+    return i;
+}
+
+#endif
+#endif
+
+/* ---- dispatch -------------------------------------------------------- */
+
+static void codec_init(void)
+{
+    memset(base64_values, 0xFF, sizeof(base64_values));
+    for (int i = 0; i < 64; i++)
+    {
+        base64_values[(unsigned char)base64_alphabet[i]] = (unsigned char)i;
+    }
+
+    memset(hex_values, 0xFF, sizeof(hex_values));
+    for (int i = 0; i < 10; i++)
+    {
+        hex_values['0' + i] = (unsigned char)i;
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        hex_values['a' + i] = (unsigned char)(10 + i);
+        hex_values['A' + i] = (unsigned char)(10 + i);
+    }
+
+    ops.name = "scalar";
+    ops.base64_encode = scalar_base64_encode;
+    ops.base64_decode = scalar_decode;
+    ops.hex_decode = scalar_decode;
+    ops.xor_block = scalar_xor_block;
+
+#ifdef CODEC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        ops.name = "ssse3";
+        ops.base64_encode = ssse3_base64_encode;
+        ops.base64_decode = ssse3_base64_decode;
+        ops.hex_decode = ssse3_hex_decode;
+        ops.xor_block = ssse3_xor_block;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        /* Encoding stays on SSSE3: the inputs are short and the AVX2
+         * reshuffle needs cross-lane loads that do not pay off here. */
+        ops.name = "avx2";
+        ops.base64_decode = avx2_base64_decode;
+        ops.hex_decode = avx2_hex_decode;
+        ops.xor_block = avx2_xor_block;
+    }
+#elif defined(CODEC_NEON)
+    ops.name = "neon";
+    ops.hex_decode = neon_hex_decode;
+    ops.xor_block = neon_xor_block;
+#ifdef __aarch64__
+    ops.base64_encode = neon_base64_encode;
+    ops.base64_decode = neon_base64_decode;
+#endif
+#endif
+}
+
+static const CodecOps *codec_ops(void)
+{
+    pthread_once(&codec_once, codec_init);
+    return &ops;
+}
+
+const char *codec_impl_name(void)
+{
+    return codec_ops()->name;
+}
+
+/* ---- public API ------------------------------------------------------ */
+
+size_t codec_base64_encoded_len(size_t len)
+{
+    return (len + 2) / 3 * 4;
+}
+
+size_t codec_base64_encode(const unsigned char *in, size_t len, char *out)
+{
+    size_t i = codec_ops()->base64_encode(in, len, out);
+    size_t o = i / 3 * 4;
+
+    for (; i + 3 <= len; i += 3, o += 4)
+    {
+        uint32_t v = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+        out[o] = base64_alphabet[(v >> 18) & 0x3F];
+        out[o + 1] = base64_alphabet[(v >> 12) & 0x3F];
+        out[o + 2] = base64_alphabet[(v >> 6) & 0x3F];
+        out[o + 3] = base64_alphabet[v & 0x3F];
+    }
+
+    if (i < len)
+    {
+        uint32_t v = (uint32_t)in[i] << 16;
+        if (i + 1 < len)
+        {
+            v |= (uint32_t)in[i + 1] << 8;
+        }
+
+        out[o] = base64_alphabet[(v >> 18) & 0x3F];
+        out[o + 1] = base64_alphabet[(v >> 12) & 0x3F];
+        out[o + 2] = i + 1 < len ? base64_alphabet[(v >> 6) & 0x3F] : '=';
+        out[o + 3] = '=';
+        o += 4;
+    }
+
+    out[o] = '\0';
+    return o;
+}
+
+size_t codec_base64_decoded_max(size_t len)
+{
+    return len / 4 * 3 + 3;
+}
+
+long codec_base64_decode(const char *in, size_t len, unsigned char *out)
+{
+    const CodecOps *impl = codec_ops();
+
+    if (len % 4 != 0)
+    {
+        return -1;
+    }
+
+    size_t body = len;
+    if (body > 0 && in[body - 1] == '=')
+        body--;
+    if (body > 0 && in[body - 1] == '=')
+        body--;
+
+    size_t i = impl->base64_decode(in, body, out);
+    if (i == (size_t)-1)
+    {
+        return -1;
+    }
+
+    size_t o = i / 4 * 3;
+    for (; i < body; i += 4)
+    {
+        size_t n = body - i < 4 ? body - i : 4;
+        if (n == 1)
+        {
+            return -1;
+        }
+
+        uint32_t v = 0;
+        for (size_t k = 0; k < 4; k++)
+        {
+            unsigned char c = k < n ? base64_values[(unsigned char)in[i + k]] : 0;
+            if (c == 0xFF)
+            {
+                return -1;
+            }
+            v = (v << 6) | c;
+        }
+
+        out[o++] = (unsigned char)(v >> 16);
+        if (n > 2)
+            out[o++] = (unsigned char)(v >> 8);
+        if (n > 3)
+            out[o++] = (unsigned char)v;
+    }
+
+    return (long)o;
+}
+
+long codec_hex_decode(const char *in, size_t len, unsigned char *out)
+{
+    if (len % 2 != 0)
+    {
+        return -1;
+    }
+
+    size_t i = codec_ops()->hex_decode(in, len, out);
+    if (i == (size_t)-1)
+    {
+        return -1;
+    }
+
+    for (; i < len; i += 2)
+    {
+        unsigned char hi = hex_values[(unsigned char)in[i]];
+        unsigned char lo = hex_values[(unsigned char)in[i + 1]];
+        if (hi == 0xFF || lo == 0xFF)
+        {
+            return -1;
+        }
+        out[i / 2] = (unsigned char)((hi << 4) | lo);
+    }
+
+    return (long)(len / 2);
+}
+
+static size_t gcd(size_t a, size_t b)
+{
+    while (b)
+    {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+void codec_xor_keys(unsigned char *data, size_t len,
+                    const unsigned char *const *keys, const size_t *key_lens, int key_count)
+{
+    if (key_count <= 0 || key_count > CODEC_XOR_MAX_KEYS || len == 0)
+    {
+        return;
+    }
+
+    /* The combined keystream repeats with the lcm of the key lengths. */
+    size_t period = 1;
+    for (int k = 0; k < key_count; k++)
+    {
+        if (key_lens[k] == 0)
+        {
+            return;
+        }
+        period = period / gcd(period, key_lens[k]) * key_lens[k];
+        if (period > XOR_MAX_PERIOD)
+        {
+            break;
+        }
+    }
+
+    if (period > XOR_MAX_PERIOD)
+    {
+        size_t pos[CODEC_XOR_MAX_KEYS] = {0};
+        for (size_t i = 0; i < len; i++)
+        {
+            unsigned char s = 0;
+            for (int k = 0; k < key_count; k++)
+            {
+                s ^= keys[k][pos[k]];
+                if (++pos[k] == key_lens[k])
+                    pos[k] = 0;
+            }
+            data[i] ^= s;
+        }
+        return;
+    }
+
+    /* Materialise as many whole periods as fit so the data can be XORed in
+     * long contiguous runs, but no more than the data needs: short inputs
+     * would otherwise pay for a full-size stream on every call. */
+    unsigned char stream[XOR_MAX_PERIOD + XOR_BLOCK];
+    size_t span = sizeof(stream) / period * period;
+    size_t needed = (len + period - 1) / period * period;
+    if (needed < span)
+    {
+        span = needed;
+    }
+
+    /* One period from the keys, then doubled until the span is filled. */
+    memset(stream, 0, period);
+    for (int k = 0; k < key_count; k++)
+    {
+        for (size_t j = 0; j < period; j++)
+        {
+            stream[j] ^= keys[k][j % key_lens[k]];
+        }
+    }
+    for (size_t filled = period; filled < span; filled *= 2)
+    {
+        memcpy(stream + filled, stream, filled < span - filled ? filled : span - filled);
+    }
+
+    const CodecOps *impl = codec_ops();
+    for (size_t i = 0; i < len; i += span)
+    {
+        impl->xor_block(data + i, stream, len - i < span ? len - i : span);
+    }
+
+    OPENSSL_cleanse(stream, span);
+}
@@ -0,0 +1,37 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stddef.h>
+
+/*
+ * Base64, hex and repeating-key XOR kernels shared by the native libraries.
+ * The widest implementation the CPU supports (AVX2, SSSE3 or NEON) is picked
+ * once at first use; every kernel has a scalar fallback with identical
+ * results.
+ */
+
+#define CODEC_XOR_MAX_KEYS 8
+
+/* Length of the padded encoding of len bytes, excluding the terminator. */
+size_t codec_base64_encoded_len(size_t len);
+
+/* Writes padded base64 without line breaks plus a terminating NUL. */
+size_t codec_base64_encode(const unsigned char *in, size_t len, char *out);
+
+/* Upper bound on the decoded size of len characters. */
+size_t codec_base64_decoded_max(size_t len);
+
+/* Decodes padded base64; returns the byte count, or -1 on malformed input. */
+long codec_base64_decode(const char *in, size_t len, unsigned char *out);
+
+/* Decodes an even number of hex digits; returns the byte count or -1. */
+long codec_hex_decode(const char *in, size_t len, unsigned char *out);
+
+/* XORs data in place with every key repeated over its length, in one pass. */
+void codec_xor_keys(unsigned char *data, size_t len,
+                    const unsigned char *const *keys, const size_t *key_lens, int key_count);
+
+/* "avx2", "ssse3", "neon" or "scalar". */
+const char *codec_impl_name(void);
+
+#endif
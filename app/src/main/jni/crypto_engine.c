@@ -0,0 +1,116 @@
+#include <limits.h>
+#include <pthread.h>
+#include <openssl/evp.h>
+#include "crypto_engine.h"
+
+static pthread_once_t engine_once = PTHREAD_ONCE_INIT;
+static pthread_key_t context_key;
+static const EVP_CIPHER *aes_128_cbc;
+
+static void free_context(void *ctx)
+{
+    EVP_CIPHER_CTX_free((EVP_CIPHER_CTX *)ctx);
+}
+
+static void engine_init(void)
+{
+    aes_128_cbc = EVP_aes_128_cbc();
+    pthread_key_create(&context_key, free_context);
+}
+
+static EVP_CIPHER_CTX *thread_context(void)
+{
+    pthread_once(&engine_once, engine_init);
+
+    EVP_CIPHER_CTX *ctx = pthread_getspecific(context_key);
+    if (ctx == NULL)
+    {
+        ctx = EVP_CIPHER_CTX_new();
+        if (ctx != NULL && pthread_setspecific(context_key, ctx) != 0)
+        {
+            EVP_CIPHER_CTX_free(ctx);
+            ctx = NULL;
+        }
+    }
+    return ctx;
+}
+
+size_t crypto_decrypt_bound(size_t in_len)
+{
+    return CRYPTO_DECRYPT_BOUND(in_len);
+}
+
+static long decrypt_with(EVP_CIPHER_CTX *ctx, const unsigned char *in, size_t in_len,
+                         const unsigned char *key, const unsigned char *iv,
+                         unsigned char *out, size_t out_cap)
+{
+    if (in == NULL || out == NULL || in_len == 0 || in_len > (size_t)INT_MAX - CRYPTO_AES_BLOCK_SIZE ||
+        out_cap < crypto_decrypt_bound(in_len))
+    {
+        return -1;
+    }
+
+    /* A context that already holds the cipher only needs a new key and IV. */
+    const EVP_CIPHER *cipher = EVP_CIPHER_CTX_cipher(ctx) == aes_128_cbc ? NULL : aes_128_cbc;
+
+    int len = 0;
+    int total = 0;
+    int ok = EVP_DecryptInit_ex(ctx, cipher, NULL, key, iv) == 1 &&
+             EVP_DecryptUpdate(ctx, out, &len, in, (int)in_len) == 1;
+    total = len;
+    ok = ok && EVP_DecryptFinal_ex(ctx, out + total, &len) == 1;
+
+    if (!ok)
+    {
+        /* Start from a clean context next time rather than trust its state. */
+        EVP_CIPHER_CTX_reset(ctx);
+        return -1;
+    }
+
+    total += len;
+    out[total] = '\0';
+    return total;
+}
+
+long crypto_decrypt(const unsigned char *in, size_t in_len,
+                    const unsigned char *key, const unsigned char *iv,
+                    unsigned char *out, size_t out_cap)
+{
+    EVP_CIPHER_CTX *ctx = thread_context();
+    if (ctx == NULL)
+    {
+        return -1;
+    }
+
+    return decrypt_with(ctx, in, in_len, key, iv, out, out_cap);
+}
+
+int crypto_decrypt_batch(CryptoDecryptJob *jobs, int count)
+{
+    EVP_CIPHER_CTX *ctx = thread_context();
+    int succeeded = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        CryptoDecryptJob *job = &jobs[i];
+        job->out_len = ctx ? decrypt_with(ctx, job->in, job->in_len, job->key, job->iv, job->out, job->out_cap) : -1;
+        if (job->out_len >= 0)
+        {
+            succeeded++;
+        }
+    }
+
+    return succeeded;
+}
+
+void crypto_engine_release_thread(void)
+{
+    pthread_once(&engine_once, engine_init);
+
+    EVP_CIPHER_CTX *ctx = pthread_getspecific(context_key);
+    if (ctx != NULL)
+    {
+        pthread_setspecific(context_key, NULL);
+        EVP_CIPHER_CTX_free(ctx);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef CRYPTO_ENGINE_H
+#define CRYPTO_ENGINE_H
+
+#include <stddef.h>
+
+/*
+ * AES-128-CBC decryption shared by the native libraries. Each thread keeps
+ * one cipher context that is re-keyed per call instead of being allocated
+ * and freed, and plaintext goes into buffers owned by the caller.
+ */
+
+#define CRYPTO_AES_KEY_SIZE 16
+#define CRYPTO_AES_BLOCK_SIZE 16
+
+typedef struct
+{
+    const unsigned char *in;
+    size_t in_len;
+    const unsigned char *key;
+    const unsigned char *iv;
+    unsigned char *out;
+    size_t out_cap;
+
+    /* Set by crypto_decrypt_batch: plaintext length, or -1 on failure. */
+    long out_len;
+} CryptoDecryptJob;
+
+/* Output capacity that always fits the plaintext of in_len bytes plus a NUL. */
+#define CRYPTO_DECRYPT_BOUND(in_len) ((in_len) + CRYPTO_AES_BLOCK_SIZE + 1)
+
+size_t crypto_decrypt_bound(size_t in_len);
+
+/* Decrypts and NUL-terminates into out; returns the plaintext length or -1. */
+long crypto_decrypt(const unsigned char *in, size_t in_len,
+                    const unsigned char *key, const unsigned char *iv,
+                    unsigned char *out, size_t out_cap);
+
+/* Runs every job on the calling thread's context; returns how many succeeded. */
+int crypto_decrypt_batch(CryptoDecryptJob *jobs, int count);
+
+/* Frees the calling thread's context early; it is also freed at thread exit. */
+void crypto_engine_release_thread(void);
+
+#endif
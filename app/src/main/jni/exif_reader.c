@@ -0,0 +1,247 @@
+#include <stdint.h>
+#include <string.h>
+#include "exif_reader.h"
+
+#define TAG_EXIF_IFD_POINTER 0x8769
+#define TAG_USER_COMMENT 0x9286
+
+typedef struct
+{
+    const unsigned char *data;
+    size_t length;
+    int little_endian;
+} TiffView;
+
+void exif_reader_init(ExifReader *reader)
+{
+    reader->length = 0;
+    reader->scan = 2;
+    reader->received = 0;
+    reader->status = EXIF_NEED_MORE;
+    reader->abort_when_done = 0;
+    reader->comment[0] = '\0';
+}
+
+static uint16_t read_be16(const unsigned char *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint16_t tiff_u16(const TiffView *tiff, size_t offset)
+{
+    const unsigned char *p = tiff->data + offset;
+    return tiff->little_endian ? (uint16_t)(p[0] | (p[1] << 8)) : read_be16(p);
+}
+
+static uint32_t tiff_u32(const TiffView *tiff, size_t offset)
+{
+    const unsigned char *p = tiff->data + offset;
+    if (tiff->little_endian)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/* Returns the offset of the 12-byte IFD entry for tag, or 0 if absent. */
+static size_t find_tag(const TiffView *tiff, uint32_t ifd, uint16_t tag)
+{
+    if ((size_t)ifd + 2 > tiff->length)
+    {
+        return 0;
+    }
+
+    uint16_t count = tiff_u16(tiff, ifd);
+    for (uint16_t i = 0; i < count; i++)
+    {
+        size_t entry = (size_t)ifd + 2 + (size_t)i * 12;
+        if (entry + 12 > tiff->length)
+        {
+            return 0;
+        }
+
+        if (tiff_u16(tiff, entry) == tag)
+        {
+            return entry;
+        }
+    }
+
+    return 0;
+}
+
+static void copy_comment(ExifReader *reader, const unsigned char *value, size_t count)
+{
+    /* UserComment starts with an 8-byte character code. */
+    static const char *const codes[] = {"ASCII\0\0\0", "UNICODE\0", "JIS\0\0\0\0\0", "\0\0\0\0\0\0\0\0"};
+    if (count >= 8)
+    {
+        for (size_t i = 0; i < sizeof(codes) / sizeof(codes[0]); i++)
+        {
+            if (memcmp(value, codes[i], 8) == 0)
+            {
+                value += 8;
+                count -= 8;
+                break;
+            }
+        }
+    }
+
+    while (count > 0 && (value[count - 1] == '\0' || value[count - 1] == ' '))
+    {
+        count--;
+    }
+
+    if (count >= EXIF_COMMENT_MAX)
+    {
+        count = EXIF_COMMENT_MAX - 1;
+    }
+
+    memcpy(reader->comment, value, count);
+    reader->comment[count] = '\0';
+}
+
+static int parse_tiff(ExifReader *reader, const unsigned char *data, size_t length)
+{
+    if (length < 8)
+    {
+        return 0;
+    }
+
+    TiffView tiff = {data, length, 0};
+    if (data[0] == 'I' && data[1] == 'I')
+        tiff.little_endian = 1;
+    else if (data[0] != 'M' || data[1] != 'M')
+        return 0;
+
+    if (tiff_u16(&tiff, 2) != 42)
+    {
+        return 0;
+    }
+
+    size_t pointer = find_tag(&tiff, tiff_u32(&tiff, 4), TAG_EXIF_IFD_POINTER);
+    if (!pointer)
+    {
+        return 0;
+    }
+
+    size_t entry = find_tag(&tiff, tiff_u32(&tiff, pointer + 8), TAG_USER_COMMENT);
+    if (!entry)
+    {
+        return 0;
+    }
+
+    uint32_t count = tiff_u32(&tiff, entry + 4);
+    size_t offset = count <= 4 ? entry + 8 : tiff_u32(&tiff, entry + 8);
+    if (offset > length || count > length - offset)
+    {
+        return 0;
+    }
+
+    copy_comment(reader, data + offset, count);
+    return 1;
+}
+
+static ExifStatus scan_segments(ExifReader *reader)
+{
+    const unsigned char *buf = reader->buffer;
+
+    if (reader->length < 2)
+    {
+        return EXIF_NEED_MORE;
+    }
+
+    if (buf[0] != 0xFF || buf[1] != 0xD8)
+    {
+        return EXIF_INVALID;
+    }
+
+    while (reader->scan + 4 <= reader->length)
+    {
+        size_t pos = reader->scan;
+        if (buf[pos] != 0xFF)
+        {
+            return EXIF_INVALID;
+        }
+
+        unsigned char marker = buf[pos + 1];
+        if (marker == 0xFF)
+        {
+            reader->scan++;
+            continue;
+        }
+
+        /* Image data starts at SOS; metadata segments all come before it. */
+        if (marker == 0xDA || marker == 0xD9)
+        {
+            return EXIF_MISSING;
+        }
+
+        size_t segment = read_be16(buf + pos + 2);
+        if (segment < 2)
+        {
+            return EXIF_INVALID;
+        }
+
+        size_t end = pos + 2 + segment;
+        if (end > EXIF_READ_LIMIT)
+        {
+            return EXIF_MISSING;
+        }
+
+        if (marker == 0xE1)
+        {
+            if (end > reader->length)
+            {
+                return EXIF_NEED_MORE;
+            }
+
+            const unsigned char *body = buf + pos + 4;
+            if (segment >= 8 && memcmp(body, "Exif\0\0", 6) == 0 && parse_tiff(reader, body + 6, segment - 8))
+            {
+                return EXIF_FOUND;
+            }
+        }
+
+        reader->scan = end;
+    }
+
+    return reader->length == EXIF_READ_LIMIT ? EXIF_MISSING : EXIF_NEED_MORE;
+}
+
+ExifStatus exif_reader_feed(ExifReader *reader, const void *data, size_t len)
+{
+    reader->received += len;
+
+    if (reader->status != EXIF_NEED_MORE)
+    {
+        return reader->status;
+    }
+
+    size_t room = EXIF_READ_LIMIT - reader->length;
+    if (len > room)
+    {
+        len = room;
+    }
+
+    memcpy(reader->buffer + reader->length, data, len);
+    reader->length += len;
+
+    reader->status = scan_segments(reader);
+    return reader->status;
+}
+
+size_t exif_reader_write_callback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+    size_t realsize = size * nmemb;
+    ExifReader *reader = (ExifReader *)userp;
+
+    /* Past the read limit the server has ignored the Range header, so stop
+     * rather than pull the rest of the image through. */
+    if (exif_reader_feed(reader, contents, realsize) != EXIF_NEED_MORE &&
+        (reader->abort_when_done || reader->received > EXIF_READ_LIMIT))
+    {
+        return 0;
+    }
+
+    return realsize;
+}
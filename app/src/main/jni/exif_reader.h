@@ -0,0 +1,43 @@
+#ifndef EXIF_READER_H
+#define EXIF_READER_H
+
+#include <stddef.h>
+
+/*
+ * Pulls the EXIF UserComment out of the head of a JPEG while it downloads.
+ * Bytes are buffered only until the APP1 segment is complete, so a caller can
+ * stop the transfer (or ask for a byte range) instead of fetching the image.
+ */
+
+#define EXIF_READ_LIMIT 65536
+#define EXIF_COMMENT_MAX 1024
+
+typedef enum
+{
+    EXIF_NEED_MORE = 0,
+    EXIF_FOUND,
+    EXIF_MISSING,
+    EXIF_INVALID
+} ExifStatus;
+
+typedef struct
+{
+    unsigned char buffer[EXIF_READ_LIMIT];
+    size_t length;
+    size_t scan;
+    size_t received;
+    ExifStatus status;
+
+    /* Return 0 from the write callback as soon as the status is known. */
+    int abort_when_done;
+
+    char comment[EXIF_COMMENT_MAX];
+} ExifReader;
+
+void exif_reader_init(ExifReader *reader);
+
+ExifStatus exif_reader_feed(ExifReader *reader, const void *data, size_t len);
+
+size_t exif_reader_write_callback(void *contents, size_t size, size_t nmemb, void *userp);
+
+#endif
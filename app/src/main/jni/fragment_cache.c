@@ -0,0 +1,105 @@
+#include <stdlib.h>
+#include "fragment_cache.h"
+
+const char *fragment_cache_peek(FragmentSlot *slot)
+{
+    if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) == FRAGMENT_READY)
+    {
+        return slot->value;
+    }
+    return NULL;
+}
+
+int fragment_cache_begin(FragmentSlot *slot)
+{
+    if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) == FRAGMENT_READY)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&slot->lock);
+
+    int waited = 0;
+    while (slot->state == FRAGMENT_LOADING)
+    {
+        waited = 1;
+        pthread_cond_wait(&slot->cond, &slot->lock);
+    }
+
+    /* A caller that waited on a failed fetch reports that failure instead of
+     * immediately starting another one. */
+    int leader = !waited && slot->state == FRAGMENT_EMPTY;
+    if (leader)
+    {
+        __atomic_store_n(&slot->state, FRAGMENT_LOADING, __ATOMIC_RELAXED);
+        slot->fetches++;
+    }
+
+    pthread_mutex_unlock(&slot->lock);
+    return leader;
+}
+
+void fragment_cache_publish(FragmentSlot *slot, char *value)
+{
+    pthread_mutex_lock(&slot->lock);
+
+    if (value != NULL && value[0] != '\0')
+    {
+        slot->value = value;
+        __atomic_store_n(&slot->state, FRAGMENT_READY, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        free(value);
+        __atomic_store_n(&slot->state, FRAGMENT_EMPTY, __ATOMIC_RELEASE);
+    }
+
+    pthread_cond_broadcast(&slot->cond);
+    pthread_mutex_unlock(&slot->lock);
+}
+
+long fragment_cache_fetches(FragmentSlot *slot)
+{
+    pthread_mutex_lock(&slot->lock);
+    long fetches = slot->fetches;
+    pthread_mutex_unlock(&slot->lock);
+    return fetches;
+}
+
+void fragment_cache_invalidate(FragmentSlot *slot)
+{
+    pthread_mutex_lock(&slot->lock);
+    if (slot->state == FRAGMENT_READY)
+    {
+        RetiredValue *retired = (RetiredValue *)malloc(sizeof(RetiredValue));
+        if (retired)
+        {
+            __atomic_store_n(&slot->state, FRAGMENT_EMPTY, __ATOMIC_RELEASE);
+            retired->value = slot->value;
+            retired->next = slot->retired;
+            slot->retired = retired;
+            slot->value = NULL;
+        }
+    }
+    pthread_mutex_unlock(&slot->lock);
+}
+
+void fragment_cache_clear(FragmentSlot *slot)
+{
+    pthread_mutex_lock(&slot->lock);
+    if (slot->state == FRAGMENT_READY)
+    {
+        __atomic_store_n(&slot->state, FRAGMENT_EMPTY, __ATOMIC_RELEASE);
+        free(slot->value);
+        slot->value = NULL;
+    }
+
+    while (slot->retired)
+    {
+        RetiredValue *next = slot->retired->next;
+        free(slot->retired->value);
+        free(slot->retired);
+        slot->retired = next;
+    }
+    pthread_mutex_unlock(&slot->lock);
+}
@@ -0,0 +1,54 @@
+#ifndef FRAGMENT_CACHE_H
+#define FRAGMENT_CACHE_H
+
+#include <pthread.h>
+
+/*
+ * One-shot cache slot for a key fragment. The first caller to find a slot
+ * empty becomes the leader and fetches; concurrent callers block until the
+ * leader publishes and share its result (including a failure). Once ready,
+ * reads are a single acquire load with no locking.
+ */
+
+enum
+{
+    FRAGMENT_EMPTY = 0,
+    FRAGMENT_LOADING,
+    FRAGMENT_READY
+};
+
+typedef struct RetiredValue
+{
+    char *value;
+    struct RetiredValue *next;
+} RetiredValue;
+
+typedef struct
+{
+    int state;
+    char *value;
+    RetiredValue *retired;
+    long fetches;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} FragmentSlot;
+
+#define FRAGMENT_SLOT_INITIALIZER {FRAGMENT_EMPTY, NULL, NULL, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER}
+
+const char *fragment_cache_peek(FragmentSlot *slot);
+
+/* Returns 1 if the caller must fetch and then call fragment_cache_publish. */
+int fragment_cache_begin(FragmentSlot *slot);
+
+/* Takes ownership of value; NULL or empty marks the fetch as failed. */
+void fragment_cache_publish(FragmentSlot *slot, char *value);
+
+long fragment_cache_fetches(FragmentSlot *slot);
+
+/* Empties a ready slot so the next caller fetches again. The old value may
+ * still be in use by a lock-free reader, so it is only freed by clear. */
+void fragment_cache_invalidate(FragmentSlot *slot);
+
+void fragment_cache_clear(FragmentSlot *slot);
+
+#endif
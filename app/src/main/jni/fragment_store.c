@@ -0,0 +1,213 @@
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include "fragment_store.h"
+
+#define FRAGMENT_STORE_MAGIC 0x46524731u
+#define FRAGMENT_STORE_TTL_S (24 * 60 * 60L)
+#define FRAGMENT_STORE_MAX_VALUE 4096
+#define FRAGMENT_IV_SIZE 12
+#define FRAGMENT_TAG_SIZE 16
+
+/* Authenticated as AAD so the expiry and slot cannot be swapped or extended. */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t id;
+    uint64_t expires_at;
+} FragmentHeader;
+
+static pthread_mutex_t store_lock = PTHREAD_MUTEX_INITIALIZER;
+static char store_dir[PATH_MAX];
+static unsigned char store_key[FRAGMENT_STORE_KEY_SIZE];
+static int store_ready = 0;
+
+void fragment_store_configure(const char *cache_dir, const unsigned char *key, int key_len)
+{
+    if (key_len != FRAGMENT_STORE_KEY_SIZE)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&store_lock);
+    snprintf(store_dir, sizeof(store_dir), "%s", cache_dir);
+    memcpy(store_key, key, FRAGMENT_STORE_KEY_SIZE);
+    store_ready = 1;
+    pthread_mutex_unlock(&store_lock);
+}
+
+static void fragment_path(char *path, size_t size, int id)
+{
+    snprintf(path, size, "%s/fragment_%d.bin", store_dir, id);
+}
+
+static int gcm_crypt(int encrypt, const FragmentHeader *header, const unsigned char *iv,
+                     const unsigned char *in, int in_len, unsigned char *out, unsigned char *tag)
+{
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx)
+    {
+        return 0;
+    }
+
+    int len = 0;
+    int ok = EVP_CipherInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL, encrypt) == 1 &&
+             EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, FRAGMENT_IV_SIZE, NULL) == 1 &&
+             EVP_CipherInit_ex(ctx, NULL, NULL, store_key, iv, encrypt) == 1 &&
+             EVP_CipherUpdate(ctx, NULL, &len, (const unsigned char *)header, sizeof(FragmentHeader)) == 1 &&
+             EVP_CipherUpdate(ctx, out, &len, in, in_len) == 1;
+
+    if (ok && !encrypt)
+    {
+        ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, FRAGMENT_TAG_SIZE, tag) == 1;
+    }
+
+    ok = ok && EVP_CipherFinal_ex(ctx, out + len, &len) == 1;
+
+    if (ok && encrypt)
+    {
+        ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, FRAGMENT_TAG_SIZE, tag) == 1;
+    }
+
+    EVP_CIPHER_CTX_free(ctx);
+    return ok;
+}
+
+char *fragment_store_load(int id)
+{
+    pthread_mutex_lock(&store_lock);
+    if (!store_ready)
+    {
+        pthread_mutex_unlock(&store_lock);
+        return NULL;
+    }
+
+    char path[PATH_MAX + 32];
+    fragment_path(path, sizeof(path), id);
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+    {
+        pthread_mutex_unlock(&store_lock);
+        return NULL;
+    }
+
+    FragmentHeader header;
+    unsigned char iv[FRAGMENT_IV_SIZE];
+    unsigned char tag[FRAGMENT_TAG_SIZE];
+    uint32_t length = 0;
+    unsigned char sealed[FRAGMENT_STORE_MAX_VALUE];
+    char *result = NULL;
+
+    int ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+             fread(iv, sizeof(iv), 1, fp) == 1 &&
+             fread(tag, sizeof(tag), 1, fp) == 1 &&
+             fread(&length, sizeof(length), 1, fp) == 1 &&
+             header.magic == FRAGMENT_STORE_MAGIC && header.id == (uint32_t)id &&
+             length > 0 && length < FRAGMENT_STORE_MAX_VALUE &&
+             fread(sealed, 1, length, fp) == length;
+    fclose(fp);
+
+    int expired = ok && header.expires_at <= (uint64_t)time(NULL);
+
+    if (ok && !expired)
+    {
+        result = (char *)malloc(length + 1);
+        if (result && gcm_crypt(0, &header, iv, sealed, (int)length, (unsigned char *)result, tag))
+        {
+            result[length] = '\0';
+        }
+        else
+        {
+            free(result);
+            result = NULL;
+        }
+    }
+
+    /* Expired or failed authentication: the file is useless, drop it. */
+    if (!result)
+    {
+        remove(path);
+    }
+
+    pthread_mutex_unlock(&store_lock);
+    return result;
+}
+
+void fragment_store_save(int id, const char *value)
+{
+    size_t length = value ? strlen(value) : 0;
+    if (length == 0 || length >= FRAGMENT_STORE_MAX_VALUE)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&store_lock);
+    if (!store_ready)
+    {
+        pthread_mutex_unlock(&store_lock);
+        return;
+    }
+
+    FragmentHeader header = {FRAGMENT_STORE_MAGIC, (uint32_t)id, (uint64_t)time(NULL) + FRAGMENT_STORE_TTL_S};
+    unsigned char iv[FRAGMENT_IV_SIZE];
+    unsigned char tag[FRAGMENT_TAG_SIZE];
+    unsigned char sealed[FRAGMENT_STORE_MAX_VALUE];
+    uint32_t sealed_len = (uint32_t)length;
+
+    if (RAND_bytes(iv, sizeof(iv)) != 1 ||
+        !gcm_crypt(1, &header, iv, (const unsigned char *)value, (int)length, sealed, tag))
+    {
+        pthread_mutex_unlock(&store_lock);
+        return;
+    }
+
+    char path[PATH_MAX + 32];
+    char tmp_path[PATH_MAX + 40];
+    fragment_path(path, sizeof(path), id);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp)
+    {
+        fwrite(&header, sizeof(header), 1, fp);
+        fwrite(iv, sizeof(iv), 1, fp);
+        fwrite(tag, sizeof(tag), 1, fp);
+        fwrite(&sealed_len, sizeof(sealed_len), 1, fp);
+        fwrite(sealed, 1, sealed_len, fp);
+
+        int ok = fflush(fp) == 0;
+        fclose(fp);
+
+        if (ok)
+        {
+            rename(tmp_path, path);
+        }
+        else
+        {
+            remove(tmp_path);
+        }
+    }
+
+    pthread_mutex_unlock(&store_lock);
+}
+
+void fragment_store_invalidate(void)
+{
+    pthread_mutex_lock(&store_lock);
+    if (store_ready)
+    {
+        char path[PATH_MAX + 32];
+        fragment_path(path, sizeof(path), FRAGMENT_STORE_THIRD);
+        remove(path);
+        fragment_path(path, sizeof(path), FRAGMENT_STORE_FOURTH);
+        remove(path);
+    }
+    pthread_mutex_unlock(&store_lock);
+}
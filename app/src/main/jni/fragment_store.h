@@ -0,0 +1,28 @@
+#ifndef FRAGMENT_STORE_H
+#define FRAGMENT_STORE_H
+
+/*
+ * On-disk copies of the network-derived key fragments, one file per fragment
+ * in the app cache dir. Each file is sealed with AES-256-GCM under a data key
+ * that the Kotlin side keeps wrapped by an AndroidKeyStore key, and carries
+ * an expiry that is authenticated along with the ciphertext.
+ */
+
+#define FRAGMENT_STORE_KEY_SIZE 32
+
+enum
+{
+    FRAGMENT_STORE_THIRD = 3,
+    FRAGMENT_STORE_FOURTH = 4
+};
+
+void fragment_store_configure(const char *cache_dir, const unsigned char *key, int key_len);
+
+/* Returns a malloc'd fragment, or NULL if missing, expired or tampered. */
+char *fragment_store_load(int id);
+
+void fragment_store_save(int id, const char *value);
+
+void fragment_store_invalidate(void);
+
+#endif
@@ -0,0 +1,176 @@
+# Generates fragment_tables.h/.c from fragment_tables.in.
+#
+#   cmake -DINPUT=<fragment_tables.in> -DOUTPUT_DIR=<dir> -P fragment_tables.cmake
+#
+# Every constant is decoded here, so the native code only runs a single AES
+# or XOR pass over a fixed-size array at runtime.
+
+cmake_minimum_required(VERSION 3.18)
+
+set(BASE64_ALPHABET "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/")
+
+function(base64_to_bytes text out)
+    string(REGEX REPLACE "=+$" "" text "${text}")
+    string(LENGTH "${text}" length)
+    math(EXPR last "${length} - 1")
+
+    set(bits 0)
+    set(bit_count 0)
+    set(bytes "")
+    foreach(i RANGE 0 ${last})
+        string(SUBSTRING "${text}" ${i} 1 c)
+        string(FIND "${BASE64_ALPHABET}" "${c}" value)
+        if(value EQUAL -1)
+            message(FATAL_ERROR "Invalid base64 character '${c}'")
+        endif()
+
+        math(EXPR bits "((${bits} << 6) | ${value}) & 0xFFFF")
+        math(EXPR bit_count "${bit_count} + 6")
+        if(bit_count GREATER_EQUAL 8)
+            math(EXPR bit_count "${bit_count} - 8")
+            math(EXPR byte "(${bits} >> ${bit_count}) & 0xFF")
+            list(APPEND bytes ${byte})
+        endif()
+    endforeach()
+
+    set(${out} "${bytes}" PARENT_SCOPE)
+endfunction()
+
+function(hex_to_bytes hex out)
+    string(LENGTH "${hex}" length)
+    math(EXPR odd "${length} % 2")
+    if(length EQUAL 0 OR odd)
+        message(FATAL_ERROR "Hex input must have an even, non-zero length")
+    endif()
+
+    math(EXPR last "${length} - 2")
+    set(bytes "")
+    foreach(i RANGE 0 ${last} 2)
+        string(SUBSTRING "${hex}" ${i} 2 pair)
+        if(NOT pair MATCHES "^[0-9A-Fa-f][0-9A-Fa-f]$")
+            message(FATAL_ERROR "Invalid hex digits '${pair}'")
+        endif()
+        math(EXPR byte "0x${pair}")
+        list(APPEND bytes ${byte})
+    endforeach()
+
+    set(${out} "${bytes}" PARENT_SCOPE)
+endfunction()
+
+function(format_bytes bytes out)
+    set(text "")
+    set(column 0)
+    foreach(byte IN LISTS bytes)
+        math(EXPR hex "${byte}" OUTPUT_FORMAT HEXADECIMAL)
+        string(LENGTH "${hex}" hex_length)
+        if(hex_length EQUAL 3)
+            string(REPLACE "0x" "0x0" hex "${hex}")
+        endif()
+
+        if(column EQUAL 0)
+            string(APPEND text "\n    ")
+        else()
+            string(APPEND text " ")
+        endif()
+        string(APPEND text "${hex},")
+
+        math(EXPR column "(${column} + 1) % 12")
+    endforeach()
+
+    set(${out} "${text}\n" PARENT_SCOPE)
+endfunction()
+
+if(NOT INPUT OR NOT OUTPUT_DIR)
+    message(FATAL_ERROR "INPUT and OUTPUT_DIR must be set")
+endif()
+
+file(STRINGS "${INPUT}" lines)
+file(MAKE_DIRECTORY "${OUTPUT_DIR}")
+
+set(header "/* Generated from fragment_tables.in by fragment_tables.cmake; do not edit. */\n\n")
+string(APPEND header "#ifndef FRAGMENT_TABLES_H\n#define FRAGMENT_TABLES_H\n")
+set(source "/* Generated from fragment_tables.in by fragment_tables.cmake; do not edit. */\n\n")
+string(APPEND source "#include \"fragment_tables.h\"\n")
+
+foreach(line IN LISTS lines)
+    string(STRIP "${line}" line)
+    if(line STREQUAL "" OR line MATCHES "^#")
+        continue()
+    endif()
+
+    string(REGEX REPLACE "[ \t]+" ";" fields "${line}")
+    list(LENGTH fields field_count)
+    if(field_count LESS 3)
+        message(FATAL_ERROR "Malformed entry: ${line}")
+    endif()
+
+    list(GET fields 0 name)
+    list(GET fields 1 kind)
+    list(GET fields 2 data)
+    string(TOUPPER "${name}" upper)
+
+    if(kind STREQUAL "aes")
+        base64_to_bytes("${data}" bytes)
+        list(LENGTH bytes size)
+
+        format_bytes("${bytes}" table)
+        string(APPEND header "\n#define FT_${upper}_SIZE ${size}\n")
+        string(APPEND header "extern const unsigned char ft_${name}[FT_${upper}_SIZE];\n")
+        string(APPEND source "\nconst unsigned char ft_${name}[FT_${upper}_SIZE] = {${table}};\n")
+    elseif(kind STREQUAL "xor")
+        hex_to_bytes("${data}" bytes)
+        list(LENGTH bytes size)
+        math(EXPR last "${size} - 1")
+
+        list(SUBLIST fields 3 -1 keys)
+        if(NOT keys)
+            message(FATAL_ERROR "XOR entry ${name} has no keys")
+        endif()
+
+        foreach(key IN LISTS keys)
+            string(HEX "${key}" key_hex)
+            hex_to_bytes("${key_hex}" key_bytes)
+            list(LENGTH key_bytes key_length)
+
+            set(mixed "")
+            foreach(i RANGE 0 ${last})
+                list(GET bytes ${i} byte)
+                math(EXPR k "${i} % ${key_length}")
+                list(GET key_bytes ${k} key_byte)
+                math(EXPR byte "${byte} ^ ${key_byte}")
+                list(APPEND mixed ${byte})
+            endforeach()
+            set(bytes "${mixed}")
+        endforeach()
+
+        set(masked "")
+        set(mask "")
+        foreach(i RANGE 0 ${last})
+            string(RANDOM LENGTH 2 ALPHABET "0123456789abcdef" pair)
+            math(EXPR mask_byte "0x${pair}")
+            list(GET bytes ${i} byte)
+            math(EXPR byte "${byte} ^ ${mask_byte}")
+            list(APPEND masked ${byte})
+            list(APPEND mask ${mask_byte})
+        endforeach()
+
+        format_bytes("${masked}" masked_table)
+        format_bytes("${mask}" mask_table)
+        string(APPEND header "\n#define FT_${upper}_SIZE ${size}\n")
+        string(APPEND header "/* Writes the ${size} plain bytes plus a NUL terminator. */\n")
+        string(APPEND header "void ft_${name}_decode(unsigned char out[FT_${upper}_SIZE + 1]);\n")
+        string(APPEND source "\nstatic const unsigned char ${name}_masked[FT_${upper}_SIZE] = {${masked_table}};\n")
+        string(APPEND source "\nstatic const unsigned char ${name}_mask[FT_${upper}_SIZE] = {${mask_table}};\n")
+        string(APPEND source "\nvoid ft_${name}_decode(unsigned char out[FT_${upper}_SIZE + 1])\n{\n")
+        string(APPEND source "    for (int i = 0; i < FT_${upper}_SIZE; i++)\n    {\n")
+        string(APPEND source "        out[i] = ${name}_masked[i] ^ ${name}_mask[i];\n    }\n")
+        string(APPEND source "    out[FT_${upper}_SIZE] = '\\0';\n}\n")
+    else()
+        message(FATAL_ERROR "Unknown entry kind '${kind}' for ${name}")
+    endif()
+endforeach()
+
+string(APPEND header "\n#endif\n")
+
+file(WRITE "${OUTPUT_DIR}/fragment_tables.h" "${header}")
+file(WRITE "${OUTPUT_DIR}/fragment_tables.c" "${source}")
@@ -0,0 +1,133 @@
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <openssl/crypto.h>
+#include "fragment_vault.h"
+
+#define VAULT_SIZE 4096
+
+static pthread_mutex_t vault_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char *vault = NULL;
+static size_t vault_used = 0;
+static int vault_locked = 0;
+static const char *slots[VAULT_SLOT_COUNT];
+static int sealed = 0;
+
+int fragment_vault_ready(void)
+{
+    return __atomic_load_n(&sealed, __ATOMIC_ACQUIRE);
+}
+
+void fragment_vault_lock(void)
+{
+    pthread_mutex_lock(&vault_lock);
+}
+
+void fragment_vault_unlock(void)
+{
+    pthread_mutex_unlock(&vault_lock);
+}
+
+static int map_vault(void)
+{
+    if (vault)
+    {
+        return 1;
+    }
+
+    void *region = mmap(NULL, VAULT_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+    {
+        return 0;
+    }
+
+    /* Best effort: a low RLIMIT_MEMLOCK should not disable the vault. */
+    vault_locked = mlock(region, VAULT_SIZE) == 0;
+#ifdef MADV_DONTDUMP
+    madvise(region, VAULT_SIZE, MADV_DONTDUMP);
+#endif
+
+    vault = (unsigned char *)region;
+    vault_used = 0;
+    return 1;
+}
+
+int fragment_vault_store(int slot, const char *value)
+{
+    if (slot < 0 || slot >= VAULT_SLOT_COUNT || value == NULL || sealed || !map_vault())
+    {
+        return 0;
+    }
+
+    size_t length = strlen(value) + 1;
+    if (slots[slot] != NULL || vault_used + length > VAULT_SIZE)
+    {
+        return 0;
+    }
+
+    memcpy(vault + vault_used, value, length);
+    slots[slot] = (const char *)(vault + vault_used);
+    vault_used += length;
+    return 1;
+}
+
+int fragment_vault_seal(void)
+{
+    for (int i = 0; i < VAULT_SLOT_COUNT; i++)
+    {
+        if (slots[i] == NULL)
+        {
+            return 0;
+        }
+    }
+
+    __atomic_store_n(&sealed, 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+void fragment_vault_discard(void)
+{
+    if (sealed)
+    {
+        return;
+    }
+
+    memset(slots, 0, sizeof(slots));
+    if (vault)
+    {
+        OPENSSL_cleanse(vault, vault_used);
+        vault_used = 0;
+    }
+}
+
+const char *fragment_vault_get(int slot)
+{
+    if (!fragment_vault_ready() || slot < 0 || slot >= VAULT_SLOT_COUNT)
+    {
+        return NULL;
+    }
+    return slots[slot];
+}
+
+void fragment_vault_wipe(void)
+{
+    pthread_mutex_lock(&vault_lock);
+
+    __atomic_store_n(&sealed, 0, __ATOMIC_RELEASE);
+    memset(slots, 0, sizeof(slots));
+
+    if (vault)
+    {
+        OPENSSL_cleanse(vault, VAULT_SIZE);
+        if (vault_locked)
+        {
+            munlock(vault, VAULT_SIZE);
+        }
+        munmap(vault, VAULT_SIZE);
+        vault = NULL;
+        vault_used = 0;
+        vault_locked = 0;
+    }
+
+    pthread_mutex_unlock(&vault_lock);
+}
@@ -0,0 +1,39 @@
+#ifndef FRAGMENT_VAULT_H
+#define FRAGMENT_VAULT_H
+
+/*
+ * Locked, non-dumpable memory holding the key fragments that never change
+ * for the life of the process. Fragments are stored once under the vault
+ * lock and sealed; after that, reads are a single acquire load.
+ */
+
+enum
+{
+    VAULT_FIRST = 0,
+    VAULT_SECOND,
+    VAULT_FIFTH,
+    VAULT_SLOT_COUNT
+};
+
+int fragment_vault_ready(void);
+
+void fragment_vault_lock(void);
+
+void fragment_vault_unlock(void);
+
+/* Copies value into the vault; call with the vault lock held. */
+int fragment_vault_store(int slot, const char *value);
+
+/* Publishes the stored fragments once every slot is filled. */
+int fragment_vault_seal(void);
+
+/* Zeroes and clears the slots of a vault that failed to seal, so the next
+ * caller can store from scratch; call with the vault lock held. */
+void fragment_vault_discard(void);
+
+const char *fragment_vault_get(int slot);
+
+/* Zeroes and unmaps the vault. */
+void fragment_vault_wipe(void);
+
+#endif
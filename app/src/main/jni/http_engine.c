@@ -0,0 +1,293 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include "http_engine.h"
+#include "net_runtime.h"
+
+#define ENGINE_POLL_TIMEOUT_MS 1000
+
+typedef struct HttpRequest
+{
+    CURL *curl;
+    http_done_fn on_done;
+    void *user;
+    struct HttpRequest *next;
+} HttpRequest;
+
+typedef struct HttpTimer
+{
+    long due_ms;
+    http_timer_fn fn;
+    void *user;
+    struct HttpTimer *next;
+} HttpTimer;
+
+static pthread_once_t engine_once = PTHREAD_ONCE_INIT;
+static int engine_ready = 0;
+
+static CURLM *multi = NULL;
+static pthread_t engine_thread;
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static HttpRequest *queue_head = NULL;
+static HttpRequest *queue_tail = NULL;
+static HttpTimer *timers = NULL;
+
+static long monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+static HttpRequest *take_queue(void)
+{
+    pthread_mutex_lock(&queue_lock);
+    HttpRequest *head = queue_head;
+    queue_head = NULL;
+    queue_tail = NULL;
+    pthread_mutex_unlock(&queue_lock);
+    return head;
+}
+
+static void add_pending(void)
+{
+    HttpRequest *req = take_queue();
+    while (req)
+    {
+        HttpRequest *next = req->next;
+        req->next = NULL;
+
+        curl_easy_setopt(req->curl, CURLOPT_PRIVATE, req);
+        if (curl_multi_add_handle(multi, req->curl) != CURLM_OK)
+        {
+            req->on_done(req->curl, CURLE_FAILED_INIT, req->user);
+            free(req);
+        }
+
+        req = next;
+    }
+}
+
+static void complete_finished(void)
+{
+    CURLMsg *msg;
+    int left;
+
+    while ((msg = curl_multi_info_read(multi, &left)) != NULL)
+    {
+        if (msg->msg != CURLMSG_DONE)
+        {
+            continue;
+        }
+
+        CURL *curl = msg->easy_handle;
+        CURLcode res = msg->data.result;
+
+        HttpRequest *req = NULL;
+        curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **)&req);
+        curl_multi_remove_handle(multi, curl);
+        net_runtime_record(curl);
+
+        if (req)
+        {
+            req->on_done(curl, res, req->user);
+            free(req);
+        }
+    }
+}
+
+/* Fires due timers and returns how long the loop may sleep. */
+static int run_timers(void)
+{
+    for (;;)
+    {
+        long now = monotonic_ms();
+
+        pthread_mutex_lock(&queue_lock);
+        HttpTimer *timer = timers;
+        if (!timer || timer->due_ms > now)
+        {
+            long wait = timer ? timer->due_ms - now : ENGINE_POLL_TIMEOUT_MS;
+            pthread_mutex_unlock(&queue_lock);
+            return wait < ENGINE_POLL_TIMEOUT_MS ? (int)wait : ENGINE_POLL_TIMEOUT_MS;
+        }
+        timers = timer->next;
+        pthread_mutex_unlock(&queue_lock);
+
+        timer->fn(timer->user);
+        free(timer);
+    }
+}
+
+static void *engine_loop(void *arg)
+{
+    (void)arg;
+    int running = 0;
+
+    for (;;)
+    {
+        int timeout_ms = run_timers();
+        add_pending();
+        curl_multi_perform(multi, &running);
+        complete_finished();
+        curl_multi_poll(multi, NULL, 0, timeout_ms, NULL);
+    }
+
+    return NULL;
+}
+
+static void engine_init_once(void)
+{
+    if (!net_runtime_init())
+    {
+        return;
+    }
+
+    multi = curl_multi_init();
+    if (!multi)
+    {
+        return;
+    }
+
+    if (net_runtime_http2_supported())
+    {
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    if (pthread_create(&engine_thread, &attr, engine_loop, NULL) == 0)
+    {
+        engine_ready = 1;
+    }
+    else
+    {
+        curl_multi_cleanup(multi);
+        multi = NULL;
+    }
+
+    pthread_attr_destroy(&attr);
+}
+
+int http_engine_start(void)
+{
+    pthread_once(&engine_once, engine_init_once);
+    return engine_ready;
+}
+
+int http_engine_on_thread(void)
+{
+    return engine_ready && pthread_equal(engine_thread, pthread_self());
+}
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int done;
+    CURLcode res;
+} BlockingRequest;
+
+static void blocking_done(CURL *curl, CURLcode res, void *user)
+{
+    (void)curl;
+    BlockingRequest *wait = (BlockingRequest *)user;
+
+    pthread_mutex_lock(&wait->lock);
+    wait->res = res;
+    wait->done = 1;
+    pthread_cond_signal(&wait->cond);
+    pthread_mutex_unlock(&wait->lock);
+}
+
+CURLcode http_engine_perform(CURL *curl)
+{
+    if (http_engine_on_thread())
+    {
+        return net_runtime_perform(curl);
+    }
+
+    BlockingRequest wait = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, CURLE_OK};
+    if (!http_engine_submit(curl, blocking_done, &wait))
+    {
+        return net_runtime_perform(curl);
+    }
+
+    pthread_mutex_lock(&wait.lock);
+    while (!wait.done)
+    {
+        pthread_cond_wait(&wait.cond, &wait.lock);
+    }
+    pthread_mutex_unlock(&wait.lock);
+
+    pthread_mutex_destroy(&wait.lock);
+    pthread_cond_destroy(&wait.cond);
+    return wait.res;
+}
+
+int http_engine_submit(CURL *curl, http_done_fn on_done, void *user)
+{
+    if (!curl || !on_done || !http_engine_start())
+    {
+        return 0;
+    }
+
+    HttpRequest *req = (HttpRequest *)calloc(1, sizeof(HttpRequest));
+    if (!req)
+    {
+        return 0;
+    }
+
+    req->curl = curl;
+    req->on_done = on_done;
+    req->user = user;
+
+    pthread_mutex_lock(&queue_lock);
+    if (queue_tail)
+    {
+        queue_tail->next = req;
+    }
+    else
+    {
+        queue_head = req;
+    }
+    queue_tail = req;
+    pthread_mutex_unlock(&queue_lock);
+
+    curl_multi_wakeup(multi);
+    return 1;
+}
+
+int http_engine_schedule(long delay_ms, http_timer_fn fn, void *user)
+{
+    if (!fn || !http_engine_start())
+    {
+        return 0;
+    }
+
+    HttpTimer *timer = (HttpTimer *)calloc(1, sizeof(HttpTimer));
+    if (!timer)
+    {
+        return 0;
+    }
+
+    timer->due_ms = monotonic_ms() + (delay_ms > 0 ? delay_ms : 0);
+    timer->fn = fn;
+    timer->user = user;
+
+    pthread_mutex_lock(&queue_lock);
+    HttpTimer **link = &timers;
+    while (*link && (*link)->due_ms <= timer->due_ms)
+    {
+        link = &(*link)->next;
+    }
+    timer->next = *link;
+    *link = timer;
+    pthread_mutex_unlock(&queue_lock);
+
+    curl_multi_wakeup(multi);
+    return 1;
+}
@@ -0,0 +1,31 @@
+#ifndef HTTP_ENGINE_H
+#define HTTP_ENGINE_H
+
+#include <curl/curl.h>
+
+/*
+ * Single-threaded asynchronous HTTP engine. One dedicated thread drives a
+ * curl_multi poll loop; submitted easy handles complete through on_done,
+ * which is always invoked on the engine thread. The callback owns the
+ * handle again and either resubmits it or hands it back to net_runtime.
+ */
+
+typedef void (*http_done_fn)(CURL *curl, CURLcode res, void *user);
+
+typedef void (*http_timer_fn)(void *user);
+
+int http_engine_start(void);
+
+int http_engine_submit(CURL *curl, http_done_fn on_done, void *user);
+
+int http_engine_on_thread(void);
+
+/* Runs curl on the engine and blocks until it completes, so concurrent
+ * blocking callers share one multi handle (and one HTTP/2 connection).
+ * On the engine thread itself it falls back to a plain easy perform. */
+CURLcode http_engine_perform(CURL *curl);
+
+/* Runs fn on the engine thread once delay_ms has elapsed. */
+int http_engine_schedule(long delay_ms, http_timer_fn fn, void *user);
+
+#endif
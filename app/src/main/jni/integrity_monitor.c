@@ -0,0 +1,273 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <link.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "integrity_monitor.h"
+#include "procfs_scanner.h"
+
+/* Full rescan period, and how often the loaded library count is checked. */
+#define SCAN_INTERVAL_MS 5000
+#define LIBRARY_CHECK_MS 250
+
+#define PROBE_PORT 27042
+#define PROBE_TIMEOUT_MS 50
+
+static const char *const maps_needles[] = {"frida", "gum-js-loop"};
+static pthread_once_t maps_matcher_once = PTHREAD_ONCE_INIT;
+static ProcfsMatcher *maps_matcher;
+
+static pthread_once_t monitor_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t monitor_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t monitor_cond;
+static pthread_t monitor_thread;
+static int monitor_running = 0;
+static int monitor_stopping = 0;
+
+static IntegrityVerdict verdict = INTEGRITY_PENDING;
+
+static long scan_count = 0;
+static long last_scan_us = 0;
+static long max_scan_us = 0;
+static long detection_latency_us = -1;
+
+static long monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+}
+
+static int count_library(struct dl_phdr_info *info, size_t size, void *data)
+{
+    (*(int *)data)++;
+    return 0;
+}
+
+/* Walks the loader's list in memory; no syscalls. */
+static int loaded_library_count(void)
+{
+    int count = 0;
+    dl_iterate_phdr(count_library, &count);
+    return count;
+}
+
+static void build_maps_matcher(void)
+{
+    maps_matcher = procfs_matcher_create(maps_needles, sizeof(maps_needles) / sizeof(maps_needles[0]));
+}
+
+static int stop_at_first_hit(const ProcfsHit *hit, void *user)
+{
+    return 0;
+}
+
+/* One pass over /proc/self/maps matching every needle at once. */
+static int maps_contain_agent(void)
+{
+    pthread_once(&maps_matcher_once, build_maps_matcher);
+    return procfs_scan_path(maps_matcher, "/proc/self/maps", stop_at_first_hit, NULL) > 0;
+}
+
+/* Non-blocking connect to the default frida-server port; loopback answers
+ * almost immediately, and the poll bounds the worst case. */
+static int agent_port_open(void)
+{
+    int sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+    {
+        return 0;
+    }
+
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(PROBE_PORT);
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int open_port = 0;
+    if (connect(sock, (struct sockaddr *)&sa, sizeof(sa)) == 0)
+    {
+        open_port = 1;
+    }
+    else if (errno == EINPROGRESS)
+    {
+        struct pollfd pfd = {sock, POLLOUT, 0};
+        if (poll(&pfd, 1, PROBE_TIMEOUT_MS) == 1)
+        {
+            int err = 0;
+            socklen_t err_len = sizeof(err);
+            open_port = getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &err_len) == 0 && err == 0;
+        }
+    }
+
+    close(sock);
+    return open_port;
+}
+
+static void run_scan(long *last_clean_us)
+{
+    long start = monotonic_us();
+    int compromised = maps_contain_agent() || agent_port_open();
+    long end = monotonic_us();
+
+    pthread_mutex_lock(&monitor_lock);
+    scan_count++;
+    last_scan_us = end - start;
+    if (last_scan_us > max_scan_us)
+    {
+        max_scan_us = last_scan_us;
+    }
+
+    if (compromised)
+    {
+        if (detection_latency_us < 0)
+        {
+            detection_latency_us = *last_clean_us ? end - *last_clean_us : 0;
+        }
+        __atomic_store_n(&verdict, INTEGRITY_COMPROMISED, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        *last_clean_us = end;
+        if (__atomic_load_n(&verdict, __ATOMIC_RELAXED) == INTEGRITY_PENDING)
+        {
+            __atomic_store_n(&verdict, INTEGRITY_CLEAN, __ATOMIC_RELEASE);
+        }
+    }
+
+    pthread_cond_broadcast(&monitor_cond);
+    pthread_mutex_unlock(&monitor_lock);
+}
+
+static void *monitor_loop(void *arg)
+{
+    long last_clean_us = 0;
+    long next_scan_us = 0;
+    int libraries = -1;
+
+    pthread_mutex_lock(&monitor_lock);
+    while (!monitor_stopping)
+    {
+        pthread_mutex_unlock(&monitor_lock);
+
+        int current = loaded_library_count();
+        long now = monotonic_us();
+        if (current != libraries || now >= next_scan_us)
+        {
+            libraries = current;
+            run_scan(&last_clean_us);
+            next_scan_us = monotonic_us() + SCAN_INTERVAL_MS * 1000L;
+        }
+
+        pthread_mutex_lock(&monitor_lock);
+        if (monitor_stopping || __atomic_load_n(&verdict, __ATOMIC_RELAXED) == INTEGRITY_COMPROMISED)
+        {
+            break;
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += LIBRARY_CHECK_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&monitor_cond, &monitor_lock, &deadline);
+    }
+    pthread_mutex_unlock(&monitor_lock);
+
+    return NULL;
+}
+
+static void init_monitor_cond(void)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&monitor_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+void integrity_monitor_start(void)
+{
+    pthread_once(&monitor_once, init_monitor_cond);
+
+    pthread_mutex_lock(&monitor_lock);
+    if (!monitor_running)
+    {
+        monitor_stopping = 0;
+        monitor_running = pthread_create(&monitor_thread, NULL, monitor_loop, NULL) == 0;
+    }
+    pthread_mutex_unlock(&monitor_lock);
+}
+
+void integrity_monitor_stop(void)
+{
+    pthread_mutex_lock(&monitor_lock);
+    if (!monitor_running)
+    {
+        pthread_mutex_unlock(&monitor_lock);
+        return;
+    }
+
+    monitor_stopping = 1;
+    pthread_cond_broadcast(&monitor_cond);
+    pthread_mutex_unlock(&monitor_lock);
+
+    pthread_join(monitor_thread, NULL);
+
+    pthread_mutex_lock(&monitor_lock);
+    monitor_running = 0;
+    pthread_mutex_unlock(&monitor_lock);
+}
+
+IntegrityVerdict integrity_monitor_verdict(void)
+{
+    return __atomic_load_n(&verdict, __ATOMIC_ACQUIRE);
+}
+
+IntegrityVerdict integrity_monitor_await(void)
+{
+    IntegrityVerdict current = integrity_monitor_verdict();
+    if (current != INTEGRITY_PENDING)
+    {
+        return current;
+    }
+
+    pthread_once(&monitor_once, init_monitor_cond);
+
+    pthread_mutex_lock(&monitor_lock);
+    while (monitor_running && !monitor_stopping && integrity_monitor_verdict() == INTEGRITY_PENDING)
+    {
+        pthread_cond_wait(&monitor_cond, &monitor_lock);
+    }
+    int scan_inline = integrity_monitor_verdict() == INTEGRITY_PENDING;
+    pthread_mutex_unlock(&monitor_lock);
+
+    /* No monitor thread to wait for, so scan once on the caller. */
+    if (scan_inline)
+    {
+        long last_clean_us = 0;
+        run_scan(&last_clean_us);
+    }
+
+    return integrity_monitor_verdict();
+}
+
+void integrity_monitor_stats(long stats[4])
+{
+    pthread_mutex_lock(&monitor_lock);
+    stats[0] = scan_count;
+    stats[1] = last_scan_us;
+    stats[2] = max_scan_us;
+    stats[3] = detection_latency_us;
+    pthread_mutex_unlock(&monitor_lock);
+}
@@ -0,0 +1,36 @@
+#ifndef INTEGRITY_MONITOR_H
+#define INTEGRITY_MONITOR_H
+
+/*
+ * Watches the process for instrumentation (Frida agents and their default
+ * server port) on a background thread, so callers only read a published
+ * verdict instead of scanning /proc and probing sockets themselves. Scans
+ * run on a fixed schedule and as soon as the set of loaded libraries changes.
+ */
+
+typedef enum
+{
+    INTEGRITY_PENDING = 0,
+    INTEGRITY_CLEAN,
+    INTEGRITY_COMPROMISED
+} IntegrityVerdict;
+
+/* Starts the monitor thread; later calls are no-ops. */
+void integrity_monitor_start(void);
+
+/* Stops and joins the monitor thread. */
+void integrity_monitor_stop(void);
+
+/* The latest verdict; a single atomic load. A compromised verdict is final. */
+IntegrityVerdict integrity_monitor_verdict(void);
+
+/* Like integrity_monitor_verdict, but waits for the first scan if it has
+ * not finished yet. */
+IntegrityVerdict integrity_monitor_await(void);
+
+/* [scans, last scan cost us, max scan cost us, detection latency us or -1]
+ * Detection latency is measured from the last clean scan to the scan that
+ * found the problem, which bounds how long it went unnoticed. */
+void integrity_monitor_stats(long stats[4]);
+
+#endif
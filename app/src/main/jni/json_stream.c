@@ -0,0 +1,353 @@
+#include <string.h>
+#include "json_stream.h"
+
+void json_stream_init(JsonStream *js)
+{
+    memset(js, 0, sizeof(JsonStream));
+}
+
+JsonField *json_stream_want(JsonStream *js, const char *key)
+{
+    if (js->field_count == JSON_STREAM_MAX_FIELDS)
+    {
+        return NULL;
+    }
+
+    JsonField *field = &js->fields[js->field_count++];
+    field->key = key;
+    js->remaining++;
+    return field;
+}
+
+int json_stream_done(const JsonStream *js)
+{
+    return js->field_count > 0 && js->remaining == 0;
+}
+
+static void append_value(JsonField *field, char c)
+{
+    if (field->length + 1 < JSON_STREAM_VALUE_MAX)
+    {
+        field->value[field->length++] = c;
+        field->value[field->length] = '\0';
+    }
+    else
+    {
+        field->truncated = 1;
+    }
+}
+
+static void complete_field(JsonStream *js, JsonField *field)
+{
+    if (!field->complete)
+    {
+        field->complete = 1;
+        js->remaining--;
+    }
+}
+
+static JsonField *find_field(JsonStream *js, const char *key, size_t len)
+{
+    for (int i = 0; i < js->field_count; i++)
+    {
+        JsonField *field = &js->fields[i];
+        if (field->complete)
+        {
+            continue;
+        }
+
+        if (key == NULL ? field->key == NULL
+                        : field->key != NULL && strlen(field->key) == len && memcmp(field->key, key, len) == 0)
+        {
+            return field;
+        }
+    }
+
+    return NULL;
+}
+
+static int top_is_object(const JsonStream *js)
+{
+    if (js->depth == 0 || js->depth > JSON_STREAM_MAX_DEPTH)
+    {
+        return 0;
+    }
+
+    return (js->containers >> (js->depth - 1)) & 1u;
+}
+
+static void push_container(JsonStream *js, int is_object)
+{
+    if (js->depth < JSON_STREAM_MAX_DEPTH)
+    {
+        if (is_object)
+        {
+            js->containers |= 1u << js->depth;
+        }
+        else
+        {
+            js->containers &= ~(1u << js->depth);
+        }
+    }
+    js->depth++;
+}
+
+static JsonField *take_value_target(JsonStream *js)
+{
+    JsonField *field = js->depth == 0 ? find_field(js, NULL, 0) : js->pending;
+    js->pending = NULL;
+    return field;
+}
+
+static void emit(JsonStream *js, char c)
+{
+    if (js->string_is_key)
+    {
+        if (js->key_length + 1 < JSON_STREAM_KEY_MAX)
+        {
+            js->key[js->key_length++] = c;
+        }
+        else
+        {
+            js->key_overflow = 1;
+        }
+    }
+    else if (js->target)
+    {
+        append_value(js->target, c);
+    }
+}
+
+static void emit_codepoint(JsonStream *js, unsigned int cp)
+{
+    if (cp >= 0xD800 && cp <= 0xDFFF)
+    {
+        cp = 0xFFFD;
+    }
+
+    if (cp < 0x80)
+    {
+        emit(js, (char)cp);
+    }
+    else if (cp < 0x800)
+    {
+        emit(js, (char)(0xC0 | (cp >> 6)));
+        emit(js, (char)(0x80 | (cp & 0x3F)));
+    }
+    else
+    {
+        emit(js, (char)(0xE0 | (cp >> 12)));
+        emit(js, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        emit(js, (char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+static void end_string(JsonStream *js)
+{
+    js->in_string = 0;
+
+    if (js->string_is_key)
+    {
+        js->pending = js->key_overflow ? NULL : find_field(js, js->key, js->key_length);
+        js->expect_key = 0;
+    }
+    else if (js->target)
+    {
+        complete_field(js, js->target);
+        js->target = NULL;
+    }
+}
+
+static void string_char(JsonStream *js, char c)
+{
+    if (js->unicode_digits > 0)
+    {
+        unsigned int digit = 0;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+
+        js->unicode_value = (js->unicode_value << 4) | digit;
+        if (--js->unicode_digits == 0)
+        {
+            emit_codepoint(js, js->unicode_value);
+        }
+        return;
+    }
+
+    if (js->escape)
+    {
+        js->escape = 0;
+        switch (c)
+        {
+        case 'u':
+            js->unicode_digits = 4;
+            js->unicode_value = 0;
+            return;
+        case 'n':
+            c = '\n';
+            break;
+        case 't':
+            c = '\t';
+            break;
+        case 'r':
+            c = '\r';
+            break;
+        case 'b':
+            c = '\b';
+            break;
+        case 'f':
+            c = '\f';
+            break;
+        default:
+            break;
+        }
+        emit(js, c);
+        return;
+    }
+
+    if (c == '\\')
+    {
+        js->escape = 1;
+    }
+    else if (c == '"')
+    {
+        end_string(js);
+    }
+    else
+    {
+        emit(js, c);
+    }
+}
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+int json_stream_feed(JsonStream *js, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len && js->remaining > 0; i++)
+    {
+        char c = data[i];
+
+        if (js->raw_top_level)
+        {
+            append_value(js->target, c);
+            continue;
+        }
+
+        if (js->in_string)
+        {
+            string_char(js, c);
+            continue;
+        }
+
+        if (js->target)
+        {
+            if (is_space(c) || c == ',' || c == '}' || c == ']')
+            {
+                complete_field(js, js->target);
+                js->target = NULL;
+            }
+            else
+            {
+                append_value(js->target, c);
+                continue;
+            }
+        }
+
+        switch (c)
+        {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+        case ':':
+            break;
+        case '"':
+            js->in_string = 1;
+            js->escape = 0;
+            js->unicode_digits = 0;
+            if (top_is_object(js) && js->expect_key)
+            {
+                js->string_is_key = 1;
+                js->key_length = 0;
+                js->key_overflow = 0;
+            }
+            else
+            {
+                js->string_is_key = 0;
+                js->target = take_value_target(js);
+            }
+            break;
+        case ',':
+            js->pending = NULL;
+            js->expect_key = top_is_object(js);
+            break;
+        case '{':
+            push_container(js, 1);
+            js->expect_key = 1;
+            js->pending = NULL;
+            break;
+        case '[':
+            push_container(js, 0);
+            js->expect_key = 0;
+            js->pending = NULL;
+            break;
+        case '}':
+        case ']':
+            if (js->depth > 0)
+            {
+                js->depth--;
+            }
+            js->expect_key = 0;
+            js->pending = NULL;
+            break;
+        default:
+            /* Numbers and literals; at the top level anything else (such
+             * as an unquoted path) is captured verbatim until the end. */
+            js->target = take_value_target(js);
+            if (js->target)
+            {
+                js->raw_top_level = js->depth == 0;
+                append_value(js->target, c);
+            }
+            break;
+        }
+    }
+
+    return json_stream_done(js);
+}
+
+void json_stream_finish(JsonStream *js)
+{
+    if (js->target && !js->in_string)
+    {
+        JsonField *field = js->target;
+        while (field->length > 0 && is_space(field->value[field->length - 1]))
+        {
+            field->value[--field->length] = '\0';
+        }
+
+        complete_field(js, field);
+        js->target = NULL;
+        js->raw_top_level = 0;
+    }
+}
+
+size_t json_stream_write_callback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+    size_t realsize = size * nmemb;
+    JsonStream *js = (JsonStream *)userp;
+
+    if (json_stream_feed(js, (const char *)contents, realsize) && js->abort_when_done)
+    {
+        return 0;
+    }
+
+    return realsize;
+}
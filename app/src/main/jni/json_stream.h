@@ -0,0 +1,66 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stddef.h>
+
+/*
+ * Incremental JSON tokenizer that runs inside a curl write callback and
+ * captures only the fields a caller asked for, so response bodies are never
+ * buffered whole. A field with a NULL key captures a top-level scalar (the
+ * /generate_image response is a bare JSON string).
+ */
+
+#define JSON_STREAM_MAX_FIELDS 4
+#define JSON_STREAM_VALUE_MAX 1024
+#define JSON_STREAM_KEY_MAX 64
+#define JSON_STREAM_MAX_DEPTH 32
+
+typedef struct
+{
+    const char *key;
+    char value[JSON_STREAM_VALUE_MAX];
+    size_t length;
+    int complete;
+    int truncated;
+} JsonField;
+
+typedef struct
+{
+    JsonField fields[JSON_STREAM_MAX_FIELDS];
+    int field_count;
+    int remaining;
+
+    /* Return 0 from the write callback once every field is complete. */
+    int abort_when_done;
+
+    unsigned int containers;
+    int depth;
+    int expect_key;
+    int in_string;
+    int string_is_key;
+    int escape;
+    int unicode_digits;
+    unsigned int unicode_value;
+    int raw_top_level;
+
+    char key[JSON_STREAM_KEY_MAX];
+    size_t key_length;
+    int key_overflow;
+
+    JsonField *pending;
+    JsonField *target;
+} JsonStream;
+
+void json_stream_init(JsonStream *js);
+
+JsonField *json_stream_want(JsonStream *js, const char *key);
+
+int json_stream_feed(JsonStream *js, const char *data, size_t len);
+
+void json_stream_finish(JsonStream *js);
+
+int json_stream_done(const JsonStream *js);
+
+size_t json_stream_write_callback(void *contents, size_t size, size_t nmemb, void *userp);
+
+#endif
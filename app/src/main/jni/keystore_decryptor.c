@@ -2,180 +2,156 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <openssl/evp.h>
-#include <openssl/aes.h>
-#include <openssl/bio.h>
-#include <openssl/buffer.h>
+#include "codec.h"
+#include "crypto_engine.h"
+#include "fragment_tables.h"
 
 char *base64_encode(const unsigned char *input, int length)
 {
-    BIO *bmem, *b64;
-    BUF_MEM *bptr;
-    char *buff;
-
-    b64 = BIO_new(BIO_f_base64());
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-    bmem = BIO_new(BIO_s_mem());
-    b64 = BIO_push(b64, bmem);
-    BIO_write(b64, input, length);
-    BIO_flush(b64);
-    BIO_get_mem_ptr(b64, &bptr);
-
-    buff = (char *)malloc(bptr->length + 1);
-    memcpy(buff, bptr->data, bptr->length);
-    buff[bptr->length] = 0;
-
-    BIO_free_all(b64);
-    return buff;
-}
-
-char *aes_decrypt(const unsigned char *ciphertext, int ciphertext_len,
-                  const unsigned char *key, const unsigned char *iv)
-{
-    EVP_CIPHER_CTX *ctx;
-    int len;
-    int plaintext_len;
-    unsigned char *plaintext = (unsigned char *)malloc(ciphertext_len);
-
-    if (!(ctx = EVP_CIPHER_CTX_new()))
+    char *buff = (char *)malloc(codec_base64_encoded_len(length) + 1);
+    if (buff == NULL)
     {
-        free(plaintext);
         return NULL;
     }
 
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv))
-    {
-        EVP_CIPHER_CTX_free(ctx);
-        free(plaintext);
-        return NULL;
-    }
+    codec_base64_encode(input, length, buff);
+    return buff;
+}
 
-    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len))
-    {
-        EVP_CIPHER_CTX_free(ctx);
-        free(plaintext);
-        return NULL;
-    }
-    plaintext_len = len;
+static const unsigned char second_fragment_key[] = "aieIIiottweninfo";
 
-    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + len, &len))
+/* keyStoreClass may be NULL; FindClass only sees app classes on threads
+ * that entered from Java, so native worker threads pass a cached ref. */
+static int read_first_fragment_key(JNIEnv *env, jclass keyStoreClass, unsigned char *aesKey)
+{
+    if (keyStoreClass == NULL)
     {
-        EVP_CIPHER_CTX_free(ctx);
-        free(plaintext);
-        return NULL;
+        keyStoreClass = (*env)->FindClass(env, "com/example/playground/network/NativeKeyStore");
     }
-    plaintext_len += len;
-
-    EVP_CIPHER_CTX_free(ctx);
-
-    plaintext[plaintext_len] = '\0';
-
-    return (char *)plaintext;
-}
-
-jstring Java_com_example_playground_network_NativeDecryptor_decryptMessage(
-    JNIEnv *env, jobject thiz)
-{
-    jclass keyStoreClass = (*env)->FindClass(env, "com/example/playground/network/NativeKeyStore");
     if (keyStoreClass == NULL)
     {
-        return NULL;
+        return 0;
     }
 
     jfieldID keysFieldID = (*env)->GetStaticFieldID(env, keyStoreClass, "KEYS", "[Ljava/lang/String;");
     if (keysFieldID == NULL)
     {
-        return NULL;
+        return 0;
     }
 
     jobjectArray keysArray = (*env)->GetStaticObjectField(env, keyStoreClass, keysFieldID);
     if (keysArray == NULL)
     {
-        return NULL;
+        return 0;
     }
 
     jstring thirdKeyJString = (jstring)(*env)->GetObjectArrayElement(env, keysArray, 2);
     if (thirdKeyJString == NULL)
     {
-        return NULL;
+        return 0;
     }
 
     const char *thirdKeyStr = (*env)->GetStringUTFChars(env, thirdKeyJString, NULL);
     if (thirdKeyStr == NULL)
     {
-        return NULL;
+        return 0;
     }
 
-    unsigned char aesKey[17];
-    strncpy((char *)aesKey, thirdKeyStr, 16);
-    aesKey[16] = '\0';
+    strncpy((char *)aesKey, thirdKeyStr, CRYPTO_AES_KEY_SIZE);
+    aesKey[CRYPTO_AES_KEY_SIZE] = '\0';
 
     (*env)->ReleaseStringUTFChars(env, thirdKeyJString, thirdKeyStr);
+    return 1;
+}
 
-    unsigned char iv[16];
-    memset(iv, '0', 16);
-
-    const char *encryptedBase64 = "8jPsLCgYQ26vNAXtBTEj3Q==";
-
-    BIO *b64, *bmem;
-    b64 = BIO_new(BIO_f_base64());
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-    bmem = BIO_new_mem_buf(encryptedBase64, -1);
-    bmem = BIO_push(b64, bmem);
-
-    unsigned char encrypted[1024] = {0};
-    int encryptedLen = BIO_read(bmem, encrypted, sizeof(encrypted));
-    BIO_free_all(bmem);
+static int prepare_job(CryptoDecryptJob *job, const unsigned char *encrypted, size_t encrypted_len,
+                       const unsigned char *key, const unsigned char *iv)
+{
+    job->in = encrypted;
+    job->in_len = encrypted_len;
+    job->key = key;
+    job->iv = iv;
+    job->out_cap = CRYPTO_DECRYPT_BOUND(encrypted_len);
+    job->out = (unsigned char *)malloc(job->out_cap);
+    job->out_len = -1;
+    return job->out != NULL;
+}
 
-    if (encryptedLen <= 0)
+jstring Java_com_example_playground_network_NativeDecryptor_decryptMessage(
+    JNIEnv *env, jobject thiz)
+{
+    unsigned char aesKey[CRYPTO_AES_KEY_SIZE + 1];
+    if (!read_first_fragment_key(env, NULL, aesKey))
     {
         return NULL;
     }
 
-    char *decrypted = aes_decrypt(encrypted, encryptedLen, aesKey, iv);
-    if (decrypted == NULL)
+    unsigned char iv[CRYPTO_AES_BLOCK_SIZE];
+    memset(iv, '0', sizeof(iv));
+
+    unsigned char decrypted[CRYPTO_DECRYPT_BOUND(FT_FIRST_FRAGMENT_SIZE)];
+    if (crypto_decrypt(ft_first_fragment, FT_FIRST_FRAGMENT_SIZE, aesKey, iv, decrypted, sizeof(decrypted)) < 0)
     {
         return NULL;
     }
 
-    jstring result = (*env)->NewStringUTF(env, decrypted);
-
-    free(decrypted);
-
-    return result;
+    return (*env)->NewStringUTF(env, (const char *)decrypted);
 }
 
 char *decrypt_second_fragment()
 {
-    const unsigned char key[] = "aieIIiottweninfo";
-
-    unsigned char iv[16];
-    memset(iv, '1', 16);
+    unsigned char iv[CRYPTO_AES_BLOCK_SIZE];
+    memset(iv, '1', sizeof(iv));
 
-    const char *encryptedBase64 = "qGRv/ZNXAKL8L1XOwBTpI+J/opXZC+WtvRAMvqFb4fs=";
+    char *decrypted = (char *)malloc(CRYPTO_DECRYPT_BOUND(FT_SECOND_FRAGMENT_SIZE));
+    if (decrypted == NULL ||
+        crypto_decrypt(ft_second_fragment, FT_SECOND_FRAGMENT_SIZE, second_fragment_key, iv,
+                       (unsigned char *)decrypted, CRYPTO_DECRYPT_BOUND(FT_SECOND_FRAGMENT_SIZE)) < 0)
+    {
+        free(decrypted);
+        return NULL;
+    }
 
-    BIO *b64, *bmem;
-    b64 = BIO_new(BIO_f_base64());
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-    bmem = BIO_new_mem_buf(encryptedBase64, -1);
-    bmem = BIO_push(b64, bmem);
+    return decrypted;
+}
 
-    unsigned char encrypted[1024] = {0};
-    int encryptedLen = BIO_read(bmem, encrypted, sizeof(encrypted));
-    BIO_free_all(bmem);
+/*
+ * Decrypts the first and second fragments in one engine call, reading the
+ * first fragment's key straight from NativeKeyStore instead of going through
+ * a NativeDecryptor instance.
+ */
+int decrypt_leading_fragments(JNIEnv *env, jclass keyStoreClass, char **first, char **second)
+{
+    *first = NULL;
+    *second = NULL;
 
-    if (encryptedLen <= 0)
+    unsigned char firstKey[CRYPTO_AES_KEY_SIZE + 1];
+    if (!read_first_fragment_key(env, keyStoreClass, firstKey))
     {
-        return NULL;
+        return 0;
     }
 
-    char *decrypted = aes_decrypt(encrypted, encryptedLen, key, iv);
-    if (decrypted == NULL)
+    unsigned char firstIv[CRYPTO_AES_BLOCK_SIZE];
+    unsigned char secondIv[CRYPTO_AES_BLOCK_SIZE];
+    memset(firstIv, '0', sizeof(firstIv));
+    memset(secondIv, '1', sizeof(secondIv));
+
+    CryptoDecryptJob jobs[2] = {0};
+
+    int ok = prepare_job(&jobs[0], ft_first_fragment, FT_FIRST_FRAGMENT_SIZE, firstKey, firstIv) &&
+             prepare_job(&jobs[1], ft_second_fragment, FT_SECOND_FRAGMENT_SIZE, second_fragment_key, secondIv) &&
+             crypto_decrypt_batch(jobs, 2) == 2;
+
+    if (!ok)
     {
-        return NULL;
+        free(jobs[0].out);
+        free(jobs[1].out);
+        return 0;
     }
 
-    return decrypted;
+    *first = (char *)jobs[0].out;
+    *second = (char *)jobs[1].out;
+    return 1;
 }
 
 JNIEXPORT jstring JNICALL Java_com_example_playground_network_NativeDecryptor_decryptSecondFragment(
@@ -197,52 +173,12 @@ JNIEXPORT jstring JNICALL Java_com_example_playground_network_NativeDecryptor_de
 
 char *decrypt_fifth_fragment()
 {
-    const char *encrypted_hex = "545C03585254045D520C5306070D565800535B565059060405075457000050535B025D0B5106015E";
-
-    const char *key1 = "4a17f315edc7aa28b1938eaf32d569da85ce14ab";
-    const char *key2 = "f6c8d74b78bd12c5a14df0b4dff7a79b271cc215";
-    const char *key3 = "b35fe102c4da1fb12e749830d5cbe79a4494f2e0";
-
-    size_t encrypted_len = strlen(encrypted_hex) / 2;
-
-    unsigned char *encrypted_data = (unsigned char *)malloc(encrypted_len);
-    if (!encrypted_data)
-    {
-        return NULL;
-    }
-
-    for (size_t i = 0; i < encrypted_len; i++)
-    {
-        sscanf(&encrypted_hex[i * 2], "%2hhx", &encrypted_data[i]);
-    }
-
-    unsigned char *result = (unsigned char *)malloc(encrypted_len + 1);
+    unsigned char *result = (unsigned char *)malloc(FT_FIFTH_FRAGMENT_SIZE + 1);
     if (!result)
     {
-        free(encrypted_data);
         return NULL;
     }
 
-    memcpy(result, encrypted_data, encrypted_len);
-
-    for (size_t i = 0; i < encrypted_len; i++)
-    {
-        result[i] ^= key3[i % strlen(key3)];
-    }
-
-    for (size_t i = 0; i < encrypted_len; i++)
-    {
-        result[i] ^= key2[i % strlen(key2)];
-    }
-
-    for (size_t i = 0; i < encrypted_len; i++)
-    {
-        result[i] ^= key1[i % strlen(key1)];
-    }
-
-    result[encrypted_len] = '\0';
-
-    free(encrypted_data);
-
+    ft_fifth_fragment_decode(result);
     return (char *)result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,354 @@
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "net_runtime.h"
+#include "tls_session_cache.h"
+
+#define NET_POOL_SIZE 8
+
+static pthread_once_t runtime_once = PTHREAD_ONCE_INIT;
+static int runtime_ready = 0;
+static int http2_supported = 0;
+
+static CURLSH *share = NULL;
+static pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static CURL *pool[NET_POOL_SIZE];
+static int pool_count = 0;
+
+/* Android keeps one PEM file per root, named by the pre-1.0 subject hash
+ * that OpenSSL 1.1+ no longer looks up, so CAPATH cannot read them. They
+ * are concatenated into one in-memory bundle instead; the conscrypt APEX
+ * copy is the one kept current on Android 14+. */
+static const char *const system_ca_dirs[] = {
+    "/apex/com.android.conscrypt/cacerts",
+    "/system/etc/security/cacerts"};
+
+static pthread_once_t roots_once = PTHREAD_ONCE_INIT;
+static char *system_roots = NULL;
+static size_t system_roots_len = 0;
+
+static long total_requests = 0;
+static long total_connections = 0;
+static long total_http2_requests = 0;
+static long total_tls_handshake_us = 0;
+static long first_request_us = -1;
+
+static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+    (void)handle;
+    (void)access;
+    (void)userptr;
+    pthread_mutex_lock(&share_locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userptr)
+{
+    (void)handle;
+    (void)userptr;
+    pthread_mutex_unlock(&share_locks[data]);
+}
+
+static void runtime_init_once(void)
+{
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK)
+    {
+        return;
+    }
+
+    curl_version_info_data *info = curl_version_info(CURLVERSION_NOW);
+    http2_supported = info && (info->features & CURL_VERSION_HTTP2) != 0;
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+    {
+        pthread_mutex_init(&share_locks[i], NULL);
+    }
+
+    share = curl_share_init();
+    if (share)
+    {
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    }
+
+    runtime_ready = 1;
+}
+
+int net_runtime_init(void)
+{
+    pthread_once(&runtime_once, runtime_init_once);
+    return runtime_ready;
+}
+
+void net_runtime_configure_cache(const char *cache_dir)
+{
+    tls_session_cache_configure(cache_dir);
+    cert_pin_configure_cache(cache_dir);
+}
+
+void net_runtime_flush_cache(void)
+{
+    tls_session_cache_flush();
+}
+
+/* libcurl builds an SSL_CTX per connection, so the URL being fetched names
+ * the host whose stored ticket the handshake should offer. */
+static CURLcode configure_ssl_ctx(CURL *curl, void *ssl_ctx, void *userptr)
+{
+    CertPin *pin = userptr;
+    if (!pin || !pin->full_handshake)
+    {
+        char *url = NULL;
+        char *host = NULL;
+        CURLU *parsed = curl_url();
+        curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+        if (parsed && url && curl_url_set(parsed, CURLUPART_URL, url, 0) == CURLUE_OK)
+        {
+            curl_url_get(parsed, CURLUPART_HOST, &host, 0);
+        }
+
+        tls_session_cache_attach((SSL_CTX *)ssl_ctx, host);
+        curl_free(host);
+        curl_url_cleanup(parsed);
+    }
+    cert_pin_attach((SSL_CTX *)ssl_ctx, pin);
+    return CURLE_OK;
+}
+
+int net_runtime_http2_supported(void)
+{
+    return net_runtime_init() && http2_supported;
+}
+
+void net_runtime_reset(CURL *curl)
+{
+    curl_easy_reset(curl);
+
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_CTX_FUNCTION, configure_ssl_ctx);
+
+    /* Offer h2 over ALPN and fall back to HTTP/1.1; wait for an existing
+     * connection to multiplex on rather than racing a new one. */
+    if (http2_supported)
+    {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    }
+}
+
+void net_runtime_pin(CURL *curl, CertPin *pin)
+{
+    curl_easy_setopt(curl, CURLOPT_SSL_CTX_DATA, pin);
+}
+
+/* Appends one PEM file and a separating newline; 0 only when out of memory. */
+static int append_file(const char *dir, const char *name, char **buffer, size_t *len, size_t *cap)
+{
+    char path[512];
+    if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)sizeof(path))
+    {
+        return 0;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        /* An unreadable root only drops that root. */
+        return 1;
+    }
+
+    int ok = 1;
+    for (;;)
+    {
+        if (*cap - *len < 4096)
+        {
+            size_t grown = *cap ? *cap * 2 : 256 * 1024;
+            char *next = realloc(*buffer, grown);
+            if (!next)
+            {
+                ok = 0;
+                break;
+            }
+            *buffer = next;
+            *cap = grown;
+        }
+
+        size_t n = fread(*buffer + *len, 1, *cap - *len - 1, file);
+        *len += n;
+        if (n == 0)
+        {
+            break;
+        }
+    }
+    fclose(file);
+
+    if (ok)
+    {
+        (*buffer)[(*len)++] = '\n';
+    }
+    return ok;
+}
+
+static void load_system_roots(void)
+{
+    for (size_t i = 0; i < sizeof(system_ca_dirs) / sizeof(system_ca_dirs[0]) && !system_roots; i++)
+    {
+        DIR *dir = opendir(system_ca_dirs[i]);
+        if (!dir)
+        {
+            continue;
+        }
+
+        char *buffer = NULL;
+        size_t len = 0;
+        size_t cap = 0;
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL)
+        {
+            if (entry->d_name[0] != '.' && !append_file(system_ca_dirs[i], entry->d_name, &buffer, &len, &cap))
+            {
+                break;
+            }
+        }
+        closedir(dir);
+
+        if (buffer && strstr(buffer, "-----BEGIN CERTIFICATE-----"))
+        {
+            system_roots = buffer;
+            system_roots_len = len;
+        }
+        else
+        {
+            free(buffer);
+        }
+    }
+}
+
+int net_runtime_trust_system_roots(CURL *curl)
+{
+    pthread_once(&roots_once, load_system_roots);
+
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    if (!system_roots)
+    {
+        return 0;
+    }
+
+    struct curl_blob blob = {system_roots, system_roots_len, CURL_BLOB_NOCOPY};
+    curl_easy_setopt(curl, CURLOPT_CAINFO_BLOB, &blob);
+    return 1;
+}
+
+CURL *net_runtime_acquire(void)
+{
+    if (!net_runtime_init())
+    {
+        return NULL;
+    }
+
+    CURL *curl = NULL;
+
+    pthread_mutex_lock(&pool_lock);
+    if (pool_count > 0)
+    {
+        curl = pool[--pool_count];
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    if (!curl)
+    {
+        curl = curl_easy_init();
+        if (!curl)
+        {
+            return NULL;
+        }
+
+        if (share)
+        {
+            curl_easy_setopt(curl, CURLOPT_SHARE, share);
+        }
+    }
+
+    net_runtime_reset(curl);
+    return curl;
+}
+
+void net_runtime_record(CURL *curl)
+{
+    long connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+
+    long version = 0;
+    curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &version);
+
+    __atomic_add_fetch(&total_requests, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&total_connections, connects, __ATOMIC_RELAXED);
+    if (version == CURL_HTTP_VERSION_2_0)
+    {
+        __atomic_add_fetch(&total_http2_requests, 1, __ATOMIC_RELAXED);
+    }
+
+    if (connects > 0)
+    {
+        curl_off_t connect_us = 0;
+        curl_off_t appconnect_us = 0;
+        curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect_us);
+        curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appconnect_us);
+        if (appconnect_us > connect_us)
+        {
+            __atomic_add_fetch(&total_tls_handshake_us, (long)(appconnect_us - connect_us), __ATOMIC_RELAXED);
+        }
+    }
+
+    curl_off_t total_us = 0;
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total_us);
+    long unset = -1;
+    __atomic_compare_exchange_n(&first_request_us, &unset, (long)total_us, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+CURLcode net_runtime_perform(CURL *curl)
+{
+    CURLcode res = curl_easy_perform(curl);
+    net_runtime_record(curl);
+    return res;
+}
+
+void net_runtime_release(CURL *curl)
+{
+    if (!curl)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    if (pool_count < NET_POOL_SIZE)
+    {
+        pool[pool_count++] = curl;
+        curl = NULL;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    if (curl)
+    {
+        curl_easy_cleanup(curl);
+    }
+}
+
+void net_runtime_get_stats(NetRuntimeStats *stats)
+{
+    stats->requests = __atomic_load_n(&total_requests, __ATOMIC_RELAXED);
+    stats->connections = __atomic_load_n(&total_connections, __ATOMIC_RELAXED);
+    stats->http2_requests = __atomic_load_n(&total_http2_requests, __ATOMIC_RELAXED);
+    stats->http2_supported = net_runtime_http2_supported();
+    tls_session_cache_counts(&stats->tls_resumed, &stats->tls_full);
+    stats->tls_handshake_us = __atomic_load_n(&total_tls_handshake_us, __ATOMIC_RELAXED);
+    stats->first_request_us = __atomic_load_n(&first_request_us, __ATOMIC_RELAXED);
+}
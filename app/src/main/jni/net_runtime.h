@@ -0,0 +1,53 @@
+#ifndef NET_RUNTIME_H
+#define NET_RUNTIME_H
+
+#include <curl/curl.h>
+#include "cert_pin.h"
+
+/*
+ * Process-wide libcurl runtime. One CURLSH shares DNS, TLS sessions and
+ * connections between every native request, and easy handles are pooled so
+ * warm connections survive across calls.
+ */
+
+typedef struct
+{
+    long requests;
+    long connections;
+    long http2_requests;
+    int http2_supported;
+    long tls_resumed;
+    long tls_full;
+    long tls_handshake_us;
+    long first_request_us;
+} NetRuntimeStats;
+
+int net_runtime_init(void);
+
+int net_runtime_http2_supported(void);
+
+void net_runtime_configure_cache(const char *cache_dir);
+
+/* Writes TLS sessions received since the last flush to the cache dir. */
+void net_runtime_flush_cache(void);
+
+CURL *net_runtime_acquire(void);
+
+void net_runtime_reset(CURL *curl);
+
+/* Checks the intermediate against pin on this handle's next handshake. */
+void net_runtime_pin(CURL *curl, CertPin *pin);
+
+/* Verifies the peer against the device's system roots, for hosts that
+ * have no registered pin; returns 0 if no roots could be read. */
+int net_runtime_trust_system_roots(CURL *curl);
+
+CURLcode net_runtime_perform(CURL *curl);
+
+void net_runtime_record(CURL *curl);
+
+void net_runtime_release(CURL *curl);
+
+void net_runtime_get_stats(NetRuntimeStats *stats);
+
+#endif
@@ -0,0 +1,601 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+#include "procfs_scanner.h"
+
+#define READ_BLOCK 65536
+
+/* Set on transitions that land on a newline or a state with output, so the
+ * scan loop only leaves its fast path for those bytes. */
+#define EDGE_FLAG 0x8000
+#define STATE_MASK 0x7fff
+
+/* The prefilter is used when the patterns have at most this many distinct
+ * two-byte prefixes. */
+#define MAX_LEADS 8
+
+struct ProcfsMatcher
+{
+    /* next[state * 256 + byte], with EDGE_FLAG folded in. */
+    uint16_t *next;
+    /* Patterns ending at each state, including via failure links. */
+    uint64_t *output;
+    unsigned char is_lead[256];
+    /* Two-byte prefixes to look for; empty when any pattern is one byte. */
+    unsigned char lead_first[MAX_LEADS];
+    unsigned char lead_second[MAX_LEADS];
+    int lead_count;
+};
+
+typedef struct
+{
+    const ProcfsMatcher *matcher;
+    procfs_hit_fn fn;
+    void *user;
+
+    int state;
+    uint64_t line_patterns;
+    long line;
+    long hits;
+    int stopped;
+
+    /* Text of the current line carried over from earlier blocks; completed
+     * from the block in hand only when the line is reported. */
+    char text[PROCFS_LINE_MAX];
+    size_t length;
+    int truncated;
+} ScanState;
+
+static int add_lead(ProcfsMatcher *matcher, unsigned char first, unsigned char second)
+{
+    for (int k = 0; k < matcher->lead_count; k++)
+    {
+        if (matcher->lead_first[k] == first && matcher->lead_second[k] == second)
+        {
+            return 1;
+        }
+    }
+    if (matcher->lead_count == MAX_LEADS)
+    {
+        return 0;
+    }
+
+    matcher->lead_first[matcher->lead_count] = first;
+    matcher->lead_second[matcher->lead_count] = second;
+    matcher->lead_count++;
+    return 1;
+}
+
+static void build_prefilter(ProcfsMatcher *matcher, const char *const *patterns, int count)
+{
+    int fits = 1;
+    for (int i = 0; i < count; i++)
+    {
+        const unsigned char *p = (const unsigned char *)patterns[i];
+        fits = fits && p[1] != '\0' && add_lead(matcher, p[0], p[1]);
+        matcher->is_lead[p[0]] = 1;
+    }
+
+    if (!fits)
+    {
+        matcher->lead_count = 0;
+    }
+}
+
+ProcfsMatcher *procfs_matcher_create(const char *const *patterns, int count)
+{
+    if (count <= 0 || count > PROCFS_MAX_PATTERNS)
+    {
+        return NULL;
+    }
+
+    size_t max_states = 1;
+    for (int i = 0; i < count; i++)
+    {
+        size_t len = patterns[i] ? strlen(patterns[i]) : 0;
+        if (len == 0 || memchr(patterns[i], '\n', len) != NULL)
+        {
+            return NULL;
+        }
+        max_states += len;
+    }
+    if (max_states > STATE_MASK)
+    {
+        return NULL;
+    }
+
+    ProcfsMatcher *matcher = calloc(1, sizeof(ProcfsMatcher));
+    int *goto_table = malloc(max_states * 256 * sizeof(int));
+    int *fail = calloc(max_states, sizeof(int));
+    int *queue = malloc(max_states * sizeof(int));
+    if (matcher)
+    {
+        matcher->next = malloc(max_states * 256 * sizeof(uint16_t));
+        matcher->output = calloc(max_states, sizeof(uint64_t));
+    }
+
+    if (!matcher || !goto_table || !fail || !queue || !matcher->next || !matcher->output)
+    {
+        free(goto_table);
+        free(fail);
+        free(queue);
+        procfs_matcher_free(matcher);
+        return NULL;
+    }
+
+    /* Build the trie. */
+    memset(goto_table, -1, max_states * 256 * sizeof(int));
+    int states = 1;
+    for (int i = 0; i < count; i++)
+    {
+        int state = 0;
+        for (const unsigned char *p = (const unsigned char *)patterns[i]; *p; p++)
+        {
+            int *slot = &goto_table[state * 256 + *p];
+            if (*slot < 0)
+            {
+                *slot = states++;
+            }
+            state = *slot;
+        }
+        matcher->output[state] |= 1ULL << i;
+    }
+
+    /* Breadth-first pass resolving failure links into a complete DFA. */
+    int head = 0;
+    int tail = 0;
+    for (int c = 0; c < 256; c++)
+    {
+        int child = goto_table[c];
+        matcher->next[c] = child < 0 ? 0 : (uint16_t)child;
+        if (child >= 0)
+        {
+            queue[tail++] = child;
+        }
+    }
+
+    while (head < tail)
+    {
+        int state = queue[head++];
+        matcher->output[state] |= matcher->output[fail[state]];
+
+        for (int c = 0; c < 256; c++)
+        {
+            int child = goto_table[state * 256 + c];
+            uint16_t fallback = matcher->next[fail[state] * 256 + c];
+            if (child < 0)
+            {
+                matcher->next[state * 256 + c] = fallback;
+            }
+            else
+            {
+                matcher->next[state * 256 + c] = (uint16_t)child;
+                fail[child] = fallback;
+                queue[tail++] = child;
+            }
+        }
+    }
+
+    /* Fold the flag in last, once every output set is final. */
+    for (int i = 0; i < states * 256; i++)
+    {
+        if ((i & 0xff) == '\n')
+        {
+            matcher->next[i] = EDGE_FLAG;
+        }
+        else if (matcher->output[matcher->next[i]])
+        {
+            matcher->next[i] |= EDGE_FLAG;
+        }
+    }
+
+    build_prefilter(matcher, patterns, count);
+
+    free(goto_table);
+    free(fail);
+    free(queue);
+    return matcher;
+}
+
+void procfs_matcher_free(ProcfsMatcher *matcher)
+{
+    if (matcher)
+    {
+        free(matcher->next);
+        free(matcher->output);
+        free(matcher);
+    }
+}
+
+/* Masks hold one or two newlines at most, and the builtin is a library call
+ * on x86 targets without POPCNT. */
+static inline int count_bits(uint64_t mask)
+{
+    int count = 0;
+    for (; mask; mask &= mask - 1)
+    {
+        count++;
+    }
+    return count;
+}
+
+#if defined(__SSE2__) || defined(__aarch64__)
+
+#if defined(__SSE2__)
+typedef __m128i LeadVec;
+#else
+typedef uint8x16_t LeadVec;
+#endif
+
+typedef struct
+{
+    /* Padded to 2, 4 or 8 by repeating the last prefix, so the block loop
+     * can be unrolled for a fixed count. */
+    int count;
+    LeadVec newline;
+    LeadVec first[MAX_LEADS];
+    LeadVec second[MAX_LEADS];
+} Prefilter;
+
+static void load_prefilter(const ProcfsMatcher *matcher, Prefilter *filter)
+{
+    int count = matcher->lead_count;
+    filter->count = count == 0 ? 0 : count <= 2 ? 2 : count <= 4 ? 4 : MAX_LEADS;
+
+    for (int k = 0; k < filter->count; k++)
+    {
+        int lead = k < count ? k : count - 1;
+#if defined(__SSE2__)
+        filter->first[k] = _mm_set1_epi8((char)matcher->lead_first[lead]);
+        filter->second[k] = _mm_set1_epi8((char)matcher->lead_second[lead]);
+#else
+        filter->first[k] = vdupq_n_u8(matcher->lead_first[lead]);
+        filter->second[k] = vdupq_n_u8(matcher->lead_second[lead]);
+#endif
+    }
+#if defined(__SSE2__)
+    filter->newline = _mm_set1_epi8('\n');
+#else
+    filter->newline = vdupq_n_u8('\n');
+#endif
+}
+
+/* Candidate and newline bitmasks for the sixteen positions at p; the NEON
+ * masks carry four bits per position. */
+static inline __attribute__((always_inline)) void block_masks(const Prefilter *filter, int count,
+                                                              const unsigned char *p,
+                                                              uint64_t *candidates, uint64_t *newlines)
+{
+#if defined(__SSE2__)
+    __m128i block = _mm_loadu_si128((const __m128i *)p);
+    __m128i after = _mm_loadu_si128((const __m128i *)(p + 1));
+    __m128i hit = _mm_setzero_si128();
+    for (int k = 0; k < count; k++)
+    {
+        __m128i eq = _mm_cmpeq_epi8(block, filter->first[k]);
+        hit = _mm_or_si128(hit, _mm_and_si128(eq, _mm_cmpeq_epi8(after, filter->second[k])));
+    }
+    *candidates = (unsigned)_mm_movemask_epi8(hit);
+    *newlines = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, filter->newline));
+#else
+    uint8x16_t block = vld1q_u8(p);
+    uint8x16_t after = vld1q_u8(p + 1);
+    uint8x16_t hit = vdupq_n_u8(0);
+    for (int k = 0; k < count; k++)
+    {
+        uint8x16_t eq = vceqq_u8(block, filter->first[k]);
+        hit = vorrq_u8(hit, vandq_u8(eq, vceqq_u8(after, filter->second[k])));
+    }
+    uint8x16_t eol = vceqq_u8(block, filter->newline);
+    *candidates = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)), 0);
+    *newlines = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eol), 4)), 0);
+#endif
+}
+
+#if defined(__SSE2__)
+#define BITS_PER_BYTE 1
+#else
+#define BITS_PER_BYTE 4
+#endif
+
+static inline __attribute__((always_inline)) size_t skip_blocks(const Prefilter *filter, int count,
+                                                                const unsigned char *data, size_t i, size_t len,
+                                                                int stop_at_newline, long *lines, size_t *last_newline)
+{
+    while (i + 17 <= len)
+    {
+        uint64_t candidates;
+        uint64_t newlines;
+        block_masks(filter, count, data + i, &candidates, &newlines);
+
+        if (stop_at_newline)
+        {
+            candidates |= newlines;
+        }
+        if (candidates)
+        {
+            newlines &= (1ULL << __builtin_ctzll(candidates)) - 1;
+        }
+        if (newlines)
+        {
+            *lines += count_bits(newlines) / BITS_PER_BYTE;
+            *last_newline = i + (63 - __builtin_clzll(newlines)) / BITS_PER_BYTE;
+        }
+        if (candidates)
+        {
+            return i + __builtin_ctzll(candidates) / BITS_PER_BYTE;
+        }
+        i += 16;
+    }
+    return i;
+}
+
+#else
+
+typedef struct
+{
+    int count;
+} Prefilter;
+
+static void load_prefilter(const ProcfsMatcher *matcher, Prefilter *filter)
+{
+    filter->count = matcher->lead_count;
+}
+
+#endif
+
+/*
+ * Skips from i to the first position where a pattern may start. Candidates
+ * are checked on their first two bytes sixteen positions at a time; the tail,
+ * and pattern sets with too many prefixes for the vector check, fall back to
+ * a first-byte check, which still beats stepping the automaton on every
+ * byte. Newlines on the way are only counted, unless stop_at_newline is set
+ * because the current line already matched. The number of newlines passed
+ * and the last one's index are returned through lines and last_newline.
+ */
+static size_t skip_to_lead(const ProcfsMatcher *matcher, const Prefilter *filter,
+                           const unsigned char *data, size_t i, size_t len,
+                           int stop_at_newline, long *lines, size_t *last_newline)
+{
+#if defined(__SSE2__) || defined(__aarch64__)
+    switch (filter->count)
+    {
+        case 0:
+            break;
+        case 2:
+            i = skip_blocks(filter, 2, data, i, len, stop_at_newline, lines, last_newline);
+            break;
+        case 4:
+            i = skip_blocks(filter, 4, data, i, len, stop_at_newline, lines, last_newline);
+            break;
+        default:
+            i = skip_blocks(filter, MAX_LEADS, data, i, len, stop_at_newline, lines, last_newline);
+            break;
+    }
+#endif
+
+    for (; i < len; i++)
+    {
+        if (matcher->is_lead[data[i]])
+        {
+            break;
+        }
+        if (data[i] == '\n')
+        {
+            if (stop_at_newline)
+            {
+                break;
+            }
+            (*lines)++;
+            *last_newline = i;
+        }
+    }
+    return i;
+}
+
+static void append_text(ScanState *scan, const char *data, size_t length)
+{
+    size_t room = PROCFS_LINE_MAX - 1 - scan->length;
+    if (length == 0)
+    {
+        return;
+    }
+    if (length > room)
+    {
+        length = room;
+        scan->truncated = 1;
+    }
+    memcpy(scan->text + scan->length, data, length);
+    scan->length += length;
+}
+
+/* Ends the current line, whose in-block part is data[0, length). */
+static void end_line(ScanState *scan, const char *data, size_t length)
+{
+    if (scan->line_patterns && !scan->stopped)
+    {
+        append_text(scan, data, length);
+        scan->text[scan->length] = '\0';
+
+        ProcfsHit hit = {scan->line, scan->line_patterns, scan->text, scan->length, scan->truncated};
+        scan->hits++;
+        if (scan->fn && !scan->fn(&hit, scan->user))
+        {
+            scan->stopped = 1;
+        }
+    }
+
+    scan->line++;
+    scan->state = 0;
+    scan->line_patterns = 0;
+    scan->length = 0;
+    scan->truncated = 0;
+}
+
+static void feed(ScanState *scan, const char *data, size_t length)
+{
+    const ProcfsMatcher *matcher = scan->matcher;
+    const uint16_t *next = matcher->next;
+    const unsigned char *bytes = (const unsigned char *)data;
+
+    Prefilter filter;
+    load_prefilter(matcher, &filter);
+
+    size_t line_start = 0;
+    size_t i = 0;
+    int state = scan->state;
+
+    while (i < length && !scan->stopped)
+    {
+        if (state == 0)
+        {
+            long lines = 0;
+            size_t last_newline = 0;
+            i = skip_to_lead(matcher, &filter, bytes, i, length, scan->line_patterns != 0, &lines, &last_newline);
+
+            /* Lines passed over had no match; only the count matters. */
+            if (lines > 0)
+            {
+                scan->line += lines;
+                scan->length = 0;
+                scan->truncated = 0;
+                line_start = last_newline + 1;
+            }
+            if (i == length)
+            {
+                break;
+            }
+        }
+
+        uint16_t edge = next[state * 256 + bytes[i]];
+        state = edge & STATE_MASK;
+        if (edge & EDGE_FLAG)
+        {
+            if (bytes[i] == '\n')
+            {
+                end_line(scan, data + line_start, i - line_start);
+                line_start = i + 1;
+            }
+            else
+            {
+                scan->line_patterns |= matcher->output[state];
+            }
+        }
+        i++;
+    }
+
+    scan->state = state;
+    if (!scan->stopped)
+    {
+        append_text(scan, data + line_start, length - line_start);
+    }
+}
+
+static void init_scan(ScanState *scan, const ProcfsMatcher *matcher, procfs_hit_fn fn, void *user)
+{
+    memset(scan, 0, offsetof(ScanState, text));
+    scan->matcher = matcher;
+    scan->fn = fn;
+    scan->user = user;
+    scan->line = 1;
+    scan->length = 0;
+    scan->truncated = 0;
+}
+
+static long finish_scan(ScanState *scan)
+{
+    if (scan->length > 0 || scan->line_patterns)
+    {
+        end_line(scan, NULL, 0);
+    }
+    return scan->hits;
+}
+
+long procfs_scan_buffer(const ProcfsMatcher *matcher, const char *data, size_t length, procfs_hit_fn fn, void *user)
+{
+    if (!matcher)
+    {
+        return -1;
+    }
+
+    ScanState *scan = malloc(sizeof(ScanState));
+    if (!scan)
+    {
+        return -1;
+    }
+
+    init_scan(scan, matcher, fn, user);
+    feed(scan, data, length);
+    long hits = finish_scan(scan);
+
+    free(scan);
+    return hits;
+}
+
+long procfs_scan_fd(const ProcfsMatcher *matcher, int fd, procfs_hit_fn fn, void *user)
+{
+    if (!matcher || fd < 0)
+    {
+        return -1;
+    }
+
+    ScanState *scan = malloc(sizeof(ScanState));
+    char *block = malloc(READ_BLOCK);
+    if (!scan || !block)
+    {
+        free(scan);
+        free(block);
+        return -1;
+    }
+
+    init_scan(scan, matcher, fn, user);
+
+    long hits = 0;
+    while (!scan->stopped)
+    {
+        ssize_t n = read(fd, block, READ_BLOCK);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            hits = -1;
+            break;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        feed(scan, block, (size_t)n);
+    }
+
+    if (hits == 0)
+    {
+        hits = finish_scan(scan);
+    }
+
+    free(block);
+    free(scan);
+    return hits;
+}
+
+long procfs_scan_path(const ProcfsMatcher *matcher, const char *path, procfs_hit_fn fn, void *user)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    long hits = procfs_scan_fd(matcher, fd, fn, user);
+    close(fd);
+    return hits;
+}
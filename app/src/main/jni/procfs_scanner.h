@@ -0,0 +1,49 @@
+#ifndef PROCFS_SCANNER_H
+#define PROCFS_SCANNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Multi-pattern line scanner for procfs files such as /proc/self/maps and
+ * /proc/mounts. All patterns are compiled into one Aho-Corasick automaton,
+ * so each byte of the file is looked at once no matter how many patterns
+ * there are, and the file is read in large blocks rather than line by line.
+ * Matching never depends on line length; only the context handed to the
+ * callback is capped at PROCFS_LINE_MAX bytes.
+ */
+
+#define PROCFS_MAX_PATTERNS 64
+#define PROCFS_LINE_MAX 1024
+
+typedef struct ProcfsMatcher ProcfsMatcher;
+
+typedef struct
+{
+    /* 1-based line number within the scanned input. */
+    long line;
+    /* Bit i is set when pattern i occurs somewhere in the line. */
+    uint64_t patterns;
+    /* The line without its newline, NUL-terminated; possibly cut short. */
+    const char *text;
+    size_t length;
+    int truncated;
+} ProcfsHit;
+
+/* Called for every line with at least one match; return 0 to stop. */
+typedef int (*procfs_hit_fn)(const ProcfsHit *hit, void *user);
+
+/* Patterns must be non-empty; returns NULL on bad input or allocation failure. */
+ProcfsMatcher *procfs_matcher_create(const char *const *patterns, int count);
+
+void procfs_matcher_free(ProcfsMatcher *matcher);
+
+/* Each returns the number of matching lines reported (counting the one the
+ * callback stopped on), or -1 if the input could not be read. */
+long procfs_scan_buffer(const ProcfsMatcher *matcher, const char *data, size_t length, procfs_hit_fn fn, void *user);
+
+long procfs_scan_fd(const ProcfsMatcher *matcher, int fd, procfs_hit_fn fn, void *user);
+
+long procfs_scan_path(const ProcfsMatcher *matcher, const char *path, procfs_hit_fn fn, void *user);
+
+#endif
@@ -1,147 +1,405 @@
+#define _GNU_SOURCE
 #include <jni.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <dirent.h>
+#include <sys/wait.h>
 #include <errno.h>
+#include "procfs_scanner.h"
+#include "root_probe.h"
 
-static int check_su_paths() {
-    const char* su_paths[] = {
-        "/system/bin/su",
-        "/system/xbin/su",
-        "/sbin/su",
-        "/system/su",
-        "/system/bin/.ext/.su",
-        "/system/usr/we-need-root/su",
-        "/data/local/xbin/su",
-        "/data/local/bin/su",
-        "/system/sd/xbin/su"
-    };
-    
-    size_t num_paths = sizeof(su_paths) / sizeof(su_paths[0]);
-    
-    for (size_t i = 0; i < num_paths; ++i) {
-        if (access(su_paths[i], F_OK) == 0) {
-            return 1;
-        }
-    }
-    
-    return 0;
+/*
+ * Root checks are ordered by cost. Tier 0 is access()/stat only, tier 1 reads
+ * procfs and system properties, and tier 2 spawns a process. The tier 2 probe
+ * is started as soon as tier 0 comes back clean so it overlaps tier 1, and it
+ * is killed if tier 1 already found root. The verdict is cached per boot.
+ */
+
+#define SU_TIMEOUT_MS 2000
+#define VERDICT_FILE "root_verdict"
+#define BOOT_ID_SIZE 37
+
+enum {
+    TIER_NONE = -1,
+    TIER_PATHS = 0,
+    TIER_SYSTEM = 1,
+    TIER_SPAWN = 2
+};
+
+extern char **environ;
+
+static long last_elapsed_us = 0;
+static long last_cache_hit = 0;
+static long last_tier = TIER_NONE;
+
+static long now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
 }
 
-static int check_mount_points() {
-    FILE* fp = fopen("/proc/mounts", "r");
-    if (fp == NULL) {
+static const char* const root_paths[] = {
+    "/system/bin/su",
+    "/system/xbin/su",
+    "/sbin/su",
+    "/system/su",
+    "/system/bin/.ext/.su",
+    "/system/usr/we-need-root/su",
+    "/data/local/xbin/su",
+    "/data/local/bin/su",
+    "/system/sd/xbin/su",
+    "/system/app/Superuser.apk",
+    "/system/app/SuperSU.apk",
+    "/sbin/.magisk",
+    "/dev/.magisk",
+    "/.magisk"
+};
+
+static const char* const root_packages[] = {
+    "com.noshufou.android.su",
+    "com.koushikdutta.superuser",
+    "eu.chainfire.supersu",
+    "com.topjohnwu.magisk"
+};
+
+static const char* const root_properties[] = {
+    "ro.debuggable=1",
+    "ro.secure=0",
+    "ro.build.tags*=test-keys"
+};
+
+/* A line counts only when both occur in it. */
+static const char* const mount_patterns[] = {
+    "/system",
+    " rw,"
+};
+
+#define MOUNT_PATTERN_ALL 0x3ULL
+
+static pthread_once_t mount_matcher_once = PTHREAD_ONCE_INIT;
+static ProcfsMatcher* mount_matcher;
+
+#define COUNT_OF(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+static int check_root_paths() {
+    return root_probe_batch(NULL, 0, root_paths, COUNT_OF(root_paths), root_packages, COUNT_OF(root_packages)) != 0;
+}
+
+static int is_writable_system_mount(const ProcfsHit* hit, void* user) {
+    if (hit->patterns == MOUNT_PATTERN_ALL) {
+        *(int*)user = 1;
         return 0;
     }
-    
-    char line[512];
+    return 1;
+}
+
+static void build_mount_matcher() {
+    mount_matcher = procfs_matcher_create(mount_patterns, COUNT_OF(mount_patterns));
+}
+
+/* Looks for a /system mount with rw among its options, in one pass. */
+static int check_mount_points() {
+    pthread_once(&mount_matcher_once, build_mount_matcher);
+
     int result = 0;
-    
-    while (fgets(line, sizeof(line), fp) != NULL) {
-        if (strstr(line, "/system") && strstr(line, " rw,") != NULL) {
-            result = 1;
-            break;
-        }
-    }
-    
-    fclose(fp);
+    procfs_scan_path(mount_matcher, "/proc/mounts", is_writable_system_mount, &result);
     return result;
 }
 
-static int check_root_packages_dir() {
-    const char* root_packages[] = {
-        "/data/data/com.noshufou.android.su",
-        "/data/data/com.koushikdutta.superuser",
-        "/data/data/eu.chainfire.supersu",
-        "/data/data/com.topjohnwu.magisk"
-    };
-    
-    size_t num_packages = sizeof(root_packages) / sizeof(root_packages[0]);
-    
-    for (size_t i = 0; i < num_packages; ++i) {
-        if (access(root_packages[i], F_OK) == 0) {
-            return 1;
-        }
-    }
-    
-    return 0;
+/* Reads properties directly instead of spawning getprop. */
+static int check_system_properties() {
+    return root_probe_batch(root_properties, COUNT_OF(root_properties), NULL, 0, NULL, 0) != 0;
 }
 
-static int check_magisk_hide() {
-    if (access("/sbin/.magisk", F_OK) == 0 ||
-        access("/dev/.magisk", F_OK) == 0 ||
-        access("/.magisk", F_OK) == 0) {
+static int check_system_writable() {
+    const char* test_path = "/system/test_root_access";
+    int fd = open(test_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+
+    if (fd >= 0) {
+        close(fd);
+        unlink(test_path);
         return 1;
     }
+
     return 0;
 }
 
-static int check_su_execution() {
-    int result = 0;
-    FILE* pipe = popen("su -c id", "r");
-    
-    if (pipe != NULL) {
-        char buffer[128];
-        
-        if (fgets(buffer, sizeof(buffer), pipe) != NULL) {
-            if (strstr(buffer, "uid=0") != NULL) {
-                result = 1;
+typedef struct {
+    pthread_mutex_t lock;
+    pid_t pid;
+    int cancelled;
+    int result;
+} SpawnProbe;
+
+/* Runs "su -c id" with a deadline; a su that prompts the user or hangs is
+ * killed instead of stalling the check. */
+static void* run_su_probe(void* arg) {
+    SpawnProbe* probe = (SpawnProbe*)arg;
+
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        return NULL;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+
+    char* const argv[] = {"su", "-c", "id", NULL};
+    pid_t pid = -1;
+
+    pthread_mutex_lock(&probe->lock);
+    if (!probe->cancelled && posix_spawnp(&pid, "su", &actions, NULL, argv, environ) == 0) {
+        probe->pid = pid;
+    }
+    pthread_mutex_unlock(&probe->lock);
+
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipe_fds[1]);
+
+    if (pid > 0) {
+        char output[128];
+        size_t used = 0;
+        long deadline = now_us() + SU_TIMEOUT_MS * 1000L;
+
+        while (used < sizeof(output) - 1) {
+            long remaining_ms = (deadline - now_us()) / 1000L;
+            struct pollfd pfd = {pipe_fds[0], POLLIN, 0};
+            if (remaining_ms <= 0 || poll(&pfd, 1, (int)remaining_ms) <= 0) {
+                break;
+            }
+
+            ssize_t n = read(pipe_fds[0], output + used, sizeof(output) - 1 - used);
+            if (n <= 0) {
+                break;
+            }
+            used += (size_t)n;
+            output[used] = '\0';
+
+            if (strstr(output, "uid=0") != NULL) {
+                probe->result = 1;
+                break;
             }
         }
-        
-        pclose(pipe);
+
+        pthread_mutex_lock(&probe->lock);
+        kill(pid, SIGKILL);
+        probe->pid = -1;
+        pthread_mutex_unlock(&probe->lock);
+
+        waitpid(pid, NULL, 0);
     }
-    
-    return result;
+
+    close(pipe_fds[0]);
+    return NULL;
 }
 
-static int check_system_writable() {
-    const char* test_path = "/system/test_root_access";
-    FILE* file = fopen(test_path, "w");
-    
-    if (file != NULL) {
-        fclose(file);
-        unlink(test_path);
-        return 1;
+static void cancel_su_probe(SpawnProbe* probe) {
+    pthread_mutex_lock(&probe->lock);
+    probe->cancelled = 1;
+    if (probe->pid > 0) {
+        kill(probe->pid, SIGKILL);
     }
-    
-    return 0;
+    pthread_mutex_unlock(&probe->lock);
 }
 
-static int is_device_rooted() {
-    if (check_su_paths()) {
-        return 1;
+static int read_boot_id(char boot_id[BOOT_ID_SIZE]) {
+    int fd = open("/proc/sys/kernel/random/boot_id", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
     }
-    
-    if (check_mount_points()) {
-        return 1;
+
+    ssize_t n = read(fd, boot_id, BOOT_ID_SIZE - 1);
+    close(fd);
+    if (n < BOOT_ID_SIZE - 1) {
+        return 0;
     }
-    
-    if (check_root_packages_dir()) {
-        return 1;
+
+    boot_id[BOOT_ID_SIZE - 1] = '\0';
+    return 1;
+}
+
+/* Returns 0 or 1 from a verdict written during this boot, or -1. */
+static int load_cached_verdict(const char* path, const char* boot_id) {
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        return -1;
     }
-    
-    if (check_magisk_hide()) {
-        return 1;
+
+    char cached_boot[BOOT_ID_SIZE];
+    int cached_verdict = -1;
+    if (fscanf(fp, "%36s %d", cached_boot, &cached_verdict) != 2 ||
+        strcmp(cached_boot, boot_id) != 0 ||
+        (cached_verdict != 0 && cached_verdict != 1)) {
+        cached_verdict = -1;
     }
-    
-    if (check_su_execution()) {
-        return 1;
+
+    fclose(fp);
+    return cached_verdict;
+}
+
+static void store_verdict(const char* path, const char* boot_id, int verdict) {
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* fp = fopen(tmp_path, "w");
+    if (fp == NULL) {
+        return;
     }
-    
-    if (check_system_writable()) {
+
+    int ok = fprintf(fp, "%s %d\n", boot_id, verdict) > 0;
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+    }
+}
+
+static int run_checks(int* tier) {
+    *tier = TIER_PATHS;
+    if (check_root_paths()) {
         return 1;
     }
-    
-    return 0;
+
+    SpawnProbe probe = {PTHREAD_MUTEX_INITIALIZER, -1, 0, 0};
+    pthread_t su_thread;
+    int su_started = pthread_create(&su_thread, NULL, run_su_probe, &probe) == 0;
+
+    *tier = TIER_SYSTEM;
+    int rooted = check_mount_points() || check_system_properties() || check_system_writable();
+
+    if (su_started) {
+        if (rooted) {
+            cancel_su_probe(&probe);
+        }
+        pthread_join(su_thread, NULL);
+    }
+
+    if (!rooted && probe.result) {
+        *tier = TIER_SPAWN;
+        rooted = 1;
+    }
+    if (!rooted) {
+        *tier = TIER_NONE;
+    }
+    return rooted;
+}
+
+static int is_device_rooted(const char* cache_dir) {
+    long start = now_us();
+
+    char boot_id[BOOT_ID_SIZE];
+    char path[512];
+    int cacheable = cache_dir != NULL && read_boot_id(boot_id) &&
+                    snprintf(path, sizeof(path), "%s/%s", cache_dir, VERDICT_FILE) < (int)sizeof(path);
+
+    int verdict = cacheable ? load_cached_verdict(path, boot_id) : -1;
+    int tier = TIER_NONE;
+    int cache_hit = verdict >= 0;
+
+    if (!cache_hit) {
+        verdict = run_checks(&tier);
+        if (cacheable) {
+            store_verdict(path, boot_id, verdict);
+        }
+    }
+
+    __atomic_store_n(&last_elapsed_us, now_us() - start, __ATOMIC_RELAXED);
+    __atomic_store_n(&last_cache_hit, (long)cache_hit, __ATOMIC_RELAXED);
+    __atomic_store_n(&last_tier, (long)tier, __ATOMIC_RELAXED);
+    return verdict;
 }
 
 JNIEXPORT jboolean JNICALL
-Java_com_example_playground_util_RootDetectorNative_isDeviceRooted(JNIEnv *env, jobject thiz) {
-    return (jboolean)(is_device_rooted() ? JNI_TRUE : JNI_FALSE);
-} 
\ No newline at end of file
+Java_com_example_playground_util_RootDetectorNative_checkDeviceRooted(JNIEnv *env, jobject thiz, jstring cacheDir) {
+    const char* dir = cacheDir != NULL ? (*env)->GetStringUTFChars(env, cacheDir, NULL) : NULL;
+
+    int rooted = is_device_rooted(dir);
+
+    if (dir != NULL) {
+        (*env)->ReleaseStringUTFChars(env, cacheDir, dir);
+    }
+    return (jboolean)(rooted ? JNI_TRUE : JNI_FALSE);
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_example_playground_util_RootDetectorNative_getCheckStats(JNIEnv *env, jobject thiz) {
+    jlong values[3] = {
+        __atomic_load_n(&last_elapsed_us, __ATOMIC_RELAXED),
+        __atomic_load_n(&last_cache_hit, __ATOMIC_RELAXED),
+        __atomic_load_n(&last_tier, __ATOMIC_RELAXED)
+    };
+
+    jlongArray result = (*env)->NewLongArray(env, 3);
+    if (result != NULL) {
+        (*env)->SetLongArrayRegion(env, result, 0, 3, values);
+    }
+    return result;
+}
+
+static const char** get_string_array(JNIEnv* env, jobjectArray array, jstring* strings, int* count) {
+    *count = array != NULL ? (*env)->GetArrayLength(env, array) : 0;
+    if (*count > ROOT_PROBE_MAX_CHECKS) {
+        *count = ROOT_PROBE_MAX_CHECKS;
+    }
+    if (*count == 0) {
+        return NULL;
+    }
+
+    const char** chars = calloc((size_t)*count, sizeof(char*));
+    for (int i = 0; chars != NULL && i < *count; ++i) {
+        strings[i] = (jstring)(*env)->GetObjectArrayElement(env, array, i);
+        chars[i] = strings[i] != NULL ? (*env)->GetStringUTFChars(env, strings[i], NULL) : NULL;
+        if (chars[i] == NULL) {
+            /* Null entries never match; release_string_array skips them. */
+            if (strings[i] != NULL) {
+                (*env)->DeleteLocalRef(env, strings[i]);
+                strings[i] = NULL;
+            }
+            chars[i] = "";
+        }
+    }
+    return chars;
+}
+
+static void release_string_array(JNIEnv* env, const char** chars, jstring* strings, int count) {
+    for (int i = 0; chars != NULL && i < count; ++i) {
+        if (strings[i] != NULL) {
+            (*env)->ReleaseStringUTFChars(env, strings[i], chars[i]);
+            (*env)->DeleteLocalRef(env, strings[i]);
+        }
+    }
+    free(chars);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_example_playground_util_RootDetectorNative_probe(JNIEnv *env, jobject thiz, jobjectArray properties,
+                                                         jobjectArray paths, jobjectArray packages) {
+    jstring property_strings[ROOT_PROBE_MAX_CHECKS];
+    jstring path_strings[ROOT_PROBE_MAX_CHECKS];
+    jstring package_strings[ROOT_PROBE_MAX_CHECKS];
+    int property_count, path_count, package_count;
+
+    const char** property_chars = get_string_array(env, properties, property_strings, &property_count);
+    const char** path_chars = get_string_array(env, paths, path_strings, &path_count);
+    const char** package_chars = get_string_array(env, packages, package_strings, &package_count);
+
+    uint64_t mask = root_probe_batch(property_chars, property_chars ? property_count : 0,
+                                     path_chars, path_chars ? path_count : 0,
+                                     package_chars, package_chars ? package_count : 0);
+
+    release_string_array(env, property_chars, property_strings, property_count);
+    release_string_array(env, path_chars, path_strings, path_count);
+    release_string_array(env, package_chars, package_strings, package_count);
+    return (jlong)mask;
+}
@@ -0,0 +1,129 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/system_properties.h>
+#include "root_probe.h"
+
+/* Above this many properties one pass over the whole property area is
+ * cheaper than a lookup per name. */
+#define PROPERTY_FOREACH_THRESHOLD 8
+#define PROPERTY_NAME_BUFFER 256
+
+typedef struct {
+    const char* name;
+    size_t name_len;
+    const char* expected;
+    int contains;
+    int matched;
+} PropertyCheck;
+
+typedef struct {
+    PropertyCheck* checks;
+    int count;
+} PropertyScan;
+
+static void parse_property(const char* spec, PropertyCheck* check) {
+    const char* eq = strchr(spec, '=');
+    memset(check, 0, sizeof(*check));
+    if (eq == NULL) {
+        return;
+    }
+
+    check->name = spec;
+    check->name_len = (size_t)(eq - spec);
+    check->expected = eq + 1;
+    if (check->name_len > 0 && spec[check->name_len - 1] == '*') {
+        check->contains = 1;
+        check->name_len--;
+    }
+}
+
+static int value_matches(const PropertyCheck* check, const char* value) {
+    return check->contains ? strstr(value, check->expected) != NULL : strcmp(value, check->expected) == 0;
+}
+
+static void match_property(void* cookie, const char* name, const char* value, uint32_t serial) {
+    PropertyScan* scan = (PropertyScan*)cookie;
+    size_t len = strlen(name);
+
+    for (int i = 0; i < scan->count; ++i) {
+        PropertyCheck* check = &scan->checks[i];
+        if (!check->matched && check->name != NULL && check->name_len == len &&
+            memcmp(check->name, name, len) == 0) {
+            check->matched = value_matches(check, value);
+        }
+    }
+}
+
+static void read_property(const prop_info* pi, void* cookie) {
+    __system_property_read_callback(pi, match_property, cookie);
+}
+
+static void probe_properties(PropertyCheck* checks, int count) {
+    if (count > PROPERTY_FOREACH_THRESHOLD) {
+        PropertyScan scan = {checks, count};
+        __system_property_foreach(read_property, &scan);
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        PropertyCheck* check = &checks[i];
+        if (check->name == NULL || check->name_len >= PROPERTY_NAME_BUFFER) {
+            continue;
+        }
+
+        char name[PROPERTY_NAME_BUFFER];
+        char value[PROP_VALUE_MAX];
+        memcpy(name, check->name, check->name_len);
+        name[check->name_len] = '\0';
+
+        if (__system_property_get(name, value) > 0) {
+            check->matched = value_matches(check, value);
+        }
+    }
+}
+
+uint64_t root_probe_batch(const char* const* properties, int property_count,
+                          const char* const* paths, int path_count,
+                          const char* const* packages, int package_count) {
+    uint64_t mask = 0;
+    int bit = 0;
+
+    if (property_count > ROOT_PROBE_MAX_CHECKS) {
+        property_count = ROOT_PROBE_MAX_CHECKS;
+    }
+
+    PropertyCheck checks[ROOT_PROBE_MAX_CHECKS];
+    for (int i = 0; i < property_count; ++i) {
+        parse_property(properties[i], &checks[i]);
+    }
+    probe_properties(checks, property_count);
+    for (int i = 0; i < property_count; ++i, ++bit) {
+        if (checks[i].matched) {
+            mask |= 1ULL << bit;
+        }
+    }
+
+    for (int i = 0; i < path_count && bit < ROOT_PROBE_MAX_CHECKS; ++i, ++bit) {
+        if (faccessat(AT_FDCWD, paths[i], F_OK, 0) == 0) {
+            mask |= 1ULL << bit;
+        }
+    }
+
+    /* Resolve /data/data once and look each package up relative to it. */
+    int data_fd = package_count > 0 ? open("/data/data", O_PATH | O_DIRECTORY | O_CLOEXEC) : -1;
+    for (int i = 0; i < package_count && bit < ROOT_PROBE_MAX_CHECKS; ++i, ++bit) {
+        struct stat st;
+        if (data_fd >= 0 && strchr(packages[i], '/') == NULL &&
+            fstatat(data_fd, packages[i], &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            mask |= 1ULL << bit;
+        }
+    }
+    if (data_fd >= 0) {
+        close(data_fd);
+    }
+
+    return mask;
+}
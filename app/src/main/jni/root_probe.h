@@ -0,0 +1,22 @@
+#ifndef ROOT_PROBE_H
+#define ROOT_PROBE_H
+
+#include <stdint.h>
+
+/*
+ * Answers a batch of cheap root indicators in one call, without spawning
+ * processes or going through PackageManager. Result bit i is set when the
+ * i-th check matched, counting properties first, then paths, then packages.
+ *
+ * Property checks are "name=value" (exact) or "name*=value" (substring).
+ * Paths are absolute and tested for existence. Packages are tested as
+ * directories under /data/data.
+ */
+
+#define ROOT_PROBE_MAX_CHECKS 64
+
+uint64_t root_probe_batch(const char* const* properties, int property_count,
+                          const char* const* paths, int path_count,
+                          const char* const* packages, int package_count);
+
+#endif
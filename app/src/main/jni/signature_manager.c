@@ -0,0 +1,305 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "http_engine.h"
+#include "json_stream.h"
+#include "net_runtime.h"
+#include "signature_manager.h"
+
+#define SIGNATURE_DEFAULT_TTL_MS (5 * 60 * 1000L)
+#define SIGNATURE_REFRESH_MARGIN_MS (30 * 1000L)
+#define SIGNATURE_IDLE_MS (10 * 60 * 1000L)
+#define SIGNATURE_BACKOFF_MIN_MS 1000L
+#define SIGNATURE_BACKOFF_MAX_MS (60 * 1000L)
+
+typedef struct SignatureWaiter
+{
+    signature_ready_fn fn;
+    void *user;
+    struct SignatureWaiter *next;
+} SignatureWaiter;
+
+typedef struct
+{
+    char auth_header[1024];
+    struct curl_slist *headers;
+    JsonStream response;
+} SignatureFetch;
+
+static pthread_mutex_t sig_lock = PTHREAD_MUTEX_INITIALIZER;
+static char auth_header[1024];
+static char current[JSON_STREAM_VALUE_MAX];
+static int has_current = 0;
+static long expires_at_ms = 0;
+static long last_used_ms = 0;
+static int fetching = 0;
+static int failures = 0;
+static uintptr_t timer_generation = 0;
+static SignatureWaiter *waiters = NULL;
+
+static void (*reject_hook)(void) = NULL;
+
+static long cache_hits = 0;
+static long upstream_fetches = 0;
+static long failed_fetches = 0;
+
+static long monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+static void on_timer(void *user);
+static void on_fetch_done(CURL *curl, CURLcode res, void *user);
+
+/* Only the most recently scheduled timer is live; older ones see a stale
+ * generation and do nothing. */
+static void schedule_locked(long delay_ms)
+{
+    timer_generation++;
+    http_engine_schedule(delay_ms, on_timer, (void *)timer_generation);
+}
+
+static int start_fetch_locked(void)
+{
+    SignatureFetch *fetch = (SignatureFetch *)calloc(1, sizeof(SignatureFetch));
+    CURL *curl = fetch ? net_runtime_acquire() : NULL;
+    if (!curl)
+    {
+        free(fetch);
+        return 0;
+    }
+
+    memcpy(fetch->auth_header, auth_header, sizeof(auth_header));
+    fetch->headers = curl_slist_append(NULL, fetch->auth_header);
+
+    json_stream_init(&fetch->response);
+    json_stream_want(&fetch->response, "signature");
+    json_stream_want(&fetch->response, "expires_in");
+    fetch->response.abort_when_done = net_runtime_http2_supported();
+
+    curl_easy_setopt(curl, CURLOPT_URL, "https://ai.elliottwen.info/auth");
+
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, fetch->headers);
+
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, 0L);
+
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, json_stream_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&fetch->response);
+
+    if (!http_engine_submit(curl, on_fetch_done, fetch))
+    {
+        net_runtime_release(curl);
+        curl_slist_free_all(fetch->headers);
+        free(fetch);
+        return 0;
+    }
+
+    fetching = 1;
+    upstream_fetches++;
+    return 1;
+}
+
+static void notify(SignatureWaiter *list, const char *signature)
+{
+    while (list)
+    {
+        SignatureWaiter *next = list->next;
+        list->fn(signature, list->user);
+        free(list);
+        list = next;
+    }
+}
+
+static void on_fetch_done(CURL *curl, CURLcode res, void *user)
+{
+    SignatureFetch *fetch = (SignatureFetch *)user;
+
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    net_runtime_release(curl);
+    curl_slist_free_all(fetch->headers);
+
+    JsonField *signature = &fetch->response.fields[0];
+    JsonField *expires_in = &fetch->response.fields[1];
+    /* A write error is the early stop once both fields were read. */
+    int finished = res == CURLE_OK || (res == CURLE_WRITE_ERROR && fetch->response.abort_when_done);
+    int ok = finished && status >= 200 && status < 300 &&
+             signature->complete && !signature->truncated && signature->length > 0;
+
+    char result[JSON_STREAM_VALUE_MAX];
+    result[0] = '\0';
+
+    pthread_mutex_lock(&sig_lock);
+    fetching = 0;
+
+    /* The key changed while this fetch was in flight; its result is stale. */
+    int stale = strcmp(fetch->auth_header, auth_header) != 0;
+
+    if (ok && !stale)
+    {
+        long ttl_ms = SIGNATURE_DEFAULT_TTL_MS;
+        if (expires_in->complete)
+        {
+            long seconds = strtol(expires_in->value, NULL, 10);
+            if (seconds > 0)
+            {
+                ttl_ms = seconds * 1000L;
+            }
+        }
+
+        memcpy(current, signature->value, signature->length + 1);
+        memcpy(result, current, sizeof(result));
+        has_current = 1;
+        expires_at_ms = monotonic_ms() + ttl_ms;
+        failures = 0;
+
+        long refresh_in = ttl_ms > 2 * SIGNATURE_REFRESH_MARGIN_MS ? ttl_ms - SIGNATURE_REFRESH_MARGIN_MS : ttl_ms / 2;
+        schedule_locked(refresh_in);
+    }
+    else if (!stale)
+    {
+        failed_fetches++;
+        failures++;
+
+        long backoff = SIGNATURE_BACKOFF_MIN_MS;
+        for (int i = 1; i < failures && backoff < SIGNATURE_BACKOFF_MAX_MS; i++)
+        {
+            backoff *= 2;
+        }
+        if (backoff > SIGNATURE_BACKOFF_MAX_MS)
+        {
+            backoff = SIGNATURE_BACKOFF_MAX_MS;
+        }
+        schedule_locked(backoff);
+    }
+
+    SignatureWaiter *list = waiters;
+    waiters = NULL;
+
+    if (stale && list)
+    {
+        /* Waiters queued for the new key; fetch for them now. */
+        waiters = list;
+        list = NULL;
+        if (!start_fetch_locked())
+        {
+            list = waiters;
+            waiters = NULL;
+        }
+    }
+    pthread_mutex_unlock(&sig_lock);
+
+    free(fetch);
+
+    if ((status == 401 || status == 403) && !stale && reject_hook)
+    {
+        reject_hook();
+    }
+
+    notify(list, result[0] ? result : NULL);
+}
+
+static void on_timer(void *user)
+{
+    pthread_mutex_lock(&sig_lock);
+
+    int live = (uintptr_t)user == timer_generation;
+    int in_use = monotonic_ms() - last_used_ms < SIGNATURE_IDLE_MS;
+
+    /* Let an idle signature lapse instead of refreshing it forever. */
+    if (live && in_use && !fetching && auth_header[0] != '\0')
+    {
+        start_fetch_locked();
+    }
+
+    pthread_mutex_unlock(&sig_lock);
+}
+
+void signature_manager_acquire(const char *api_key, signature_ready_fn fn, void *user)
+{
+    char header[sizeof(auth_header)];
+    snprintf(header, sizeof(header), "Authorization: %s", api_key);
+
+    char cached[JSON_STREAM_VALUE_MAX];
+    cached[0] = '\0';
+
+    pthread_mutex_lock(&sig_lock);
+
+    long now = monotonic_ms();
+    last_used_ms = now;
+
+    if (strcmp(header, auth_header) != 0)
+    {
+        memcpy(auth_header, header, sizeof(auth_header));
+        has_current = 0;
+        failures = 0;
+    }
+
+    if (has_current && now < expires_at_ms)
+    {
+        memcpy(cached, current, sizeof(cached));
+        cache_hits++;
+    }
+    else
+    {
+        SignatureWaiter *waiter = (SignatureWaiter *)calloc(1, sizeof(SignatureWaiter));
+        if (waiter)
+        {
+            waiter->fn = fn;
+            waiter->user = user;
+            waiter->next = waiters;
+            waiters = waiter;
+
+            if (!fetching && !start_fetch_locked())
+            {
+                waiters = waiter->next;
+                free(waiter);
+                waiter = NULL;
+            }
+        }
+
+        if (waiter)
+        {
+            pthread_mutex_unlock(&sig_lock);
+            return;
+        }
+    }
+
+    pthread_mutex_unlock(&sig_lock);
+    fn(cached[0] ? cached : NULL, user);
+}
+
+void signature_manager_set_reject_hook(void (*hook)(void))
+{
+    pthread_mutex_lock(&sig_lock);
+    reject_hook = hook;
+    pthread_mutex_unlock(&sig_lock);
+}
+
+void signature_manager_invalidate(const char *signature)
+{
+    pthread_mutex_lock(&sig_lock);
+    if (has_current && strcmp(current, signature) == 0)
+    {
+        has_current = 0;
+    }
+    pthread_mutex_unlock(&sig_lock);
+}
+
+void signature_manager_stats(long stats[3])
+{
+    pthread_mutex_lock(&sig_lock);
+    stats[0] = cache_hits;
+    stats[1] = upstream_fetches;
+    stats[2] = failed_fetches;
+    pthread_mutex_unlock(&sig_lock);
+}
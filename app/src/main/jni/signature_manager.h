@@ -0,0 +1,25 @@
+#ifndef SIGNATURE_MANAGER_H
+#define SIGNATURE_MANAGER_H
+
+/*
+ * Caches the /auth signature for the combined key and keeps it fresh in the
+ * background while it is in use, so a generation can go straight to
+ * /generate_image. Failed refreshes are retried with exponential backoff.
+ */
+
+typedef void (*signature_ready_fn)(const char *signature, void *user);
+
+/* Calls fn with the signature (NULL on failure), either right away on the
+ * calling thread when a valid one is cached, or later on the engine thread. */
+void signature_manager_acquire(const char *api_key, signature_ready_fn fn, void *user);
+
+/* Drops signature if it is still the cached one, e.g. after a 401. */
+void signature_manager_invalidate(const char *signature);
+
+/* Called on the engine thread when /auth rejects the key outright. */
+void signature_manager_set_reject_hook(void (*hook)(void));
+
+/* [cache hits, upstream fetches, failed fetches] */
+void signature_manager_stats(long stats[3]);
+
+#endif
@@ -0,0 +1,320 @@
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tls_session_cache.h"
+
+#define TLS_CACHE_MAX_ENTRIES 8
+#define TLS_CACHE_MAGIC 0x544c5332u
+#define TLS_CACHE_FILE "tls_sessions.bin"
+#define TLS_CACHE_MAX_DER 8192
+
+typedef int (*new_session_fn)(SSL *ssl, SSL_SESSION *session);
+
+typedef struct
+{
+    char host[256];
+    SSL_SESSION *session;
+} CachedSession;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static CachedSession entries[TLS_CACHE_MAX_ENTRIES];
+static int entry_count = 0;
+static char cache_path[PATH_MAX];
+
+static int dirty = 0;
+
+static pthread_once_t index_once = PTHREAD_ONCE_INIT;
+static int prev_cb_index = -1;
+static int offer_index = -1;
+
+static long resumed_handshakes = 0;
+static long full_handshakes = 0;
+
+static void free_offer(void *parent, void *ptr, CRYPTO_EX_DATA *ad, int idx, long argl, void *argp)
+{
+    (void)parent;
+    (void)ad;
+    (void)idx;
+    (void)argl;
+    (void)argp;
+    SSL_SESSION_free((SSL_SESSION *)ptr);
+}
+
+/* OpenSSL runs ex_data constructors at the end of SSL_new, after SSL_clear
+ * and before libcurl looks up its in-memory cache or starts the handshake,
+ * so the restored ticket is in place before the ClientHello is built. A
+ * fresher session libcurl holds still replaces it. */
+static void offer_session(void *parent, void *ptr, CRYPTO_EX_DATA *ad, int idx, long argl, void *argp)
+{
+    (void)ptr;
+    (void)ad;
+    (void)idx;
+    (void)argl;
+    (void)argp;
+
+    SSL *ssl = (SSL *)parent;
+    SSL_SESSION *offer = (SSL_SESSION *)SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), offer_index);
+    if (offer && !SSL_is_server(ssl))
+    {
+        SSL_set_session(ssl, offer);
+    }
+}
+
+static void init_index(void)
+{
+    prev_cb_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+    offer_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, free_offer);
+    /* The slot itself stays empty; only its constructor is wanted. */
+    SSL_get_ex_new_index(0, NULL, offer_session, NULL, NULL);
+}
+
+static int session_usable(SSL_SESSION *session)
+{
+    if (!session || !SSL_SESSION_is_resumable(session))
+    {
+        return 0;
+    }
+
+    long expires = SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session);
+    return (long)time(NULL) < expires;
+}
+
+static void store_locked(const char *host, SSL_SESSION *session)
+{
+    int slot = -1;
+    for (int i = 0; i < entry_count; i++)
+    {
+        if (strcmp(entries[i].host, host) == 0)
+        {
+            slot = i;
+            break;
+        }
+    }
+
+    if (slot < 0)
+    {
+        if (entry_count == TLS_CACHE_MAX_ENTRIES)
+        {
+            SSL_SESSION_free(entries[0].session);
+            memmove(&entries[0], &entries[1], sizeof(CachedSession) * (TLS_CACHE_MAX_ENTRIES - 1));
+            entry_count--;
+        }
+        slot = entry_count++;
+        snprintf(entries[slot].host, sizeof(entries[slot].host), "%s", host);
+    }
+    else
+    {
+        SSL_SESSION_free(entries[slot].session);
+    }
+
+    SSL_SESSION_up_ref(session);
+    entries[slot].session = session;
+}
+
+static void save_locked(void)
+{
+    if (cache_path[0] == '\0')
+    {
+        return;
+    }
+
+    char tmp_path[PATH_MAX + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache_path);
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp)
+    {
+        return;
+    }
+
+    uint32_t header[2] = {TLS_CACHE_MAGIC, 0};
+    for (int i = 0; i < entry_count; i++)
+    {
+        if (session_usable(entries[i].session))
+        {
+            header[1]++;
+        }
+    }
+    fwrite(header, sizeof(header), 1, fp);
+
+    for (int i = 0; i < entry_count; i++)
+    {
+        if (!session_usable(entries[i].session))
+        {
+            continue;
+        }
+
+        int der_len = i2d_SSL_SESSION(entries[i].session, NULL);
+        if (der_len <= 0 || der_len > TLS_CACHE_MAX_DER)
+        {
+            der_len = 0;
+        }
+
+        unsigned char der[TLS_CACHE_MAX_DER];
+        unsigned char *p = der;
+        if (der_len > 0)
+        {
+            i2d_SSL_SESSION(entries[i].session, &p);
+        }
+
+        uint32_t lengths[2] = {(uint32_t)strlen(entries[i].host), (uint32_t)der_len};
+        fwrite(lengths, sizeof(lengths), 1, fp);
+        fwrite(entries[i].host, 1, lengths[0], fp);
+        fwrite(der, 1, lengths[1], fp);
+    }
+
+    int ok = fflush(fp) == 0;
+    fclose(fp);
+
+    if (ok)
+    {
+        rename(tmp_path, cache_path);
+    }
+    else
+    {
+        remove(tmp_path);
+    }
+}
+
+static void load_locked(void)
+{
+    FILE *fp = fopen(cache_path, "rb");
+    if (!fp)
+    {
+        return;
+    }
+
+    uint32_t header[2];
+    if (fread(header, sizeof(header), 1, fp) != 1 || header[0] != TLS_CACHE_MAGIC)
+    {
+        fclose(fp);
+        return;
+    }
+
+    for (uint32_t n = 0; n < header[1]; n++)
+    {
+        uint32_t lengths[2];
+        if (fread(lengths, sizeof(lengths), 1, fp) != 1 ||
+            lengths[0] >= sizeof(entries[0].host) || lengths[1] > TLS_CACHE_MAX_DER)
+        {
+            break;
+        }
+
+        char host[256];
+        unsigned char der[TLS_CACHE_MAX_DER];
+        if (fread(host, 1, lengths[0], fp) != lengths[0] || fread(der, 1, lengths[1], fp) != lengths[1])
+        {
+            break;
+        }
+        host[lengths[0]] = '\0';
+
+        const unsigned char *p = der;
+        SSL_SESSION *session = d2i_SSL_SESSION(NULL, &p, lengths[1]);
+        if (session_usable(session))
+        {
+            store_locked(host, session);
+        }
+        SSL_SESSION_free(session);
+    }
+
+    fclose(fp);
+}
+
+void tls_session_cache_configure(const char *cache_dir)
+{
+    pthread_mutex_lock(&cache_lock);
+    snprintf(cache_path, sizeof(cache_path), "%s/%s", cache_dir, TLS_CACHE_FILE);
+    load_locked();
+    pthread_mutex_unlock(&cache_lock);
+}
+
+static int on_new_session(SSL *ssl, SSL_SESSION *session)
+{
+    const char *host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (host && SSL_SESSION_is_resumable(session))
+    {
+        pthread_mutex_lock(&cache_lock);
+        store_locked(host, session);
+        dirty = 1;
+        pthread_mutex_unlock(&cache_lock);
+    }
+
+    new_session_fn prev = (new_session_fn)SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), prev_cb_index);
+    return prev ? prev(ssl, session) : 0;
+}
+
+static void on_info(const SSL *ssl, int where, int ret)
+{
+    (void)ret;
+    if (where & SSL_CB_HANDSHAKE_DONE)
+    {
+        if (SSL_session_reused((SSL *)ssl))
+        {
+            __atomic_add_fetch(&resumed_handshakes, 1, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            __atomic_add_fetch(&full_handshakes, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/* Returns a new reference to the stored session for host, or NULL. */
+static SSL_SESSION *find_session(const char *host)
+{
+    SSL_SESSION *found = NULL;
+
+    pthread_mutex_lock(&cache_lock);
+    for (int i = 0; i < entry_count; i++)
+    {
+        if (strcmp(entries[i].host, host) == 0 && session_usable(entries[i].session))
+        {
+            found = entries[i].session;
+            SSL_SESSION_up_ref(found);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    return found;
+}
+
+void tls_session_cache_attach(SSL_CTX *ctx, const char *host)
+{
+    pthread_once(&index_once, init_index);
+
+    SSL_SESSION *offer = host ? find_session(host) : NULL;
+    SSL_SESSION_free((SSL_SESSION *)SSL_CTX_get_ex_data(ctx, offer_index));
+    SSL_CTX_set_ex_data(ctx, offer_index, offer);
+
+    new_session_fn prev = SSL_CTX_sess_get_new_cb(ctx);
+    if (prev != on_new_session)
+    {
+        SSL_CTX_set_ex_data(ctx, prev_cb_index, (void *)prev);
+    }
+
+    SSL_CTX_set_session_cache_mode(ctx, SSL_CTX_get_session_cache_mode(ctx) | SSL_SESS_CACHE_CLIENT);
+    SSL_CTX_sess_set_new_cb(ctx, on_new_session);
+    SSL_CTX_set_info_callback(ctx, on_info);
+}
+
+void tls_session_cache_flush(void)
+{
+    pthread_mutex_lock(&cache_lock);
+    if (dirty)
+    {
+        save_locked();
+        dirty = 0;
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+void tls_session_cache_counts(long *resumed, long *full)
+{
+    *resumed = __atomic_load_n(&resumed_handshakes, __ATOMIC_RELAXED);
+    *full = __atomic_load_n(&full_handshakes, __ATOMIC_RELAXED);
+}
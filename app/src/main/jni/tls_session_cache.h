@@ -0,0 +1,26 @@
+#ifndef TLS_SESSION_CACHE_H
+#define TLS_SESSION_CACHE_H
+
+#include <openssl/ssl.h>
+
+/*
+ * Client TLS session tickets persisted to the app cache dir so the first
+ * handshake after a process restart can resume instead of running a full
+ * handshake. Sessions are keyed by SNI host name.
+ *
+ * New tickets only update memory; tls_session_cache_flush writes them out,
+ * so a server issuing several tickets per connection costs no disk I/O on
+ * the thread that runs the handshake.
+ */
+
+void tls_session_cache_configure(const char *cache_dir);
+
+/* ctx belongs to one connection to host; its handshake offers the ticket
+ * stored for host, if any. host may be NULL. */
+void tls_session_cache_attach(SSL_CTX *ctx, const char *host);
+
+void tls_session_cache_flush(void);
+
+void tls_session_cache_counts(long *resumed, long *full);
+
+#endif